@@ -1,74 +1,145 @@
 #include "algorithm.h"
 
+/*Lane each of the MSG_TYPES goes in, for each of the GHS_POLICIES (FIFO has no
+lanes at all)*/
+uint8_t policy_lanes[NUM_POLICIES][LANES_MAX] = {
+  {0, 0, 0, 0, 0, 0, 0, 0},
+  {2, 0, 2, 1, 1, 1, 1, 2},
+  {2, 1, 2, 0, 0, 1, 1, 2}
+};
+
 void ghs (struct node *node) {
-  uint8_t inmsg[50];
   struct node_data node_data;
 
   /*print edge information, for clarity's sake*/
   print_edges(node->neighs, node->log);
 
+  node_data.options = node->algo_opts;
+  node_data.replay = 0;
+  find_mst(node, &node_data);
+
+  /*after node has finished running, print its output (the status of its edges)
+  to the global log*/
+  output(node, &node_data);
+}
+
+void find_mst(struct node *node, struct node_data *ndata) {
+  uint8_t inmsg[50];
+  uint64_t stamp, waited = 0, cycles = 0;
+  uint32_t len;
+
+  /*replays have to go in the order they were recorded, anything else may
+  sort its messages into lanes*/
+  uint8_t policy = (ndata->options & GHS_POLICY) >> GHS_POLICY_SHIFT;
+  ndata->lanes = NULL;
+  if (policy != POLICY_FIFO && policy < NUM_POLICIES && !ndata->replay) {
+    ndata->lanes = init_lanes(policy_lanes[policy]);
+  }
+
+  /*histograms are allocated once and for all, so measuring never allocates*/
+  ndata->deferred = 0;
+  ndata->deferrals = 0;
+  ndata->hists = NULL;
+  if (ndata->options & GHS_HISTOGRAMS) {
+    ndata->hists = calloc(HIST_METRICS, sizeof(*ndata->hists));
+    stamp_queue(node->queue);
+  }
+  ndata->record = NULL;
+  if (ndata->options & GHS_RECORD) {
+    ndata->record = open_recording(node);
+  }
+
   /*we 'wake up' every node by default*/
-  wakeup(node, &node_data);
+  wakeup(node, ndata);
 
-  /*main infinite loop, read from message queue and react appropriately*/
-  uint8_t run = 1;
+  /*main infinite loop, read from message queue and react appropriately. Nodes
+  with no neighbours will never get any messages, and are done already*/
+  uint8_t run = (ndata->num_neighs > 0);
   while(run) {
-    /*nothing to do when there are no messages to process*/
-    if (is_empty(node->queue)) {
-      continue;
+    /*a replay that runs dry will never get any more messages*/
+    if (ndata->replay && is_empty(node->queue)) {
+      fprintf(stderr, "Node %d ran out of recorded messages!\n", node->id);
+      break;
     }
 
-    /*process first message in the queue*/
+    /*nothing to do when there are no messages to process, so wait for one*/
     memset(inmsg, 0, 50);
-    dequeue(node->queue, inmsg);
+    if (ndata->lanes != NULL) {
+      /*whatever arrived meanwhile may go ahead of what's already in the lanes*/
+      if (lanes_empty(ndata->lanes)) {
+        wait_queue(node->queue);
+      }
+      fill_lanes(ndata->lanes, node->queue);
+      len = dequeue_lanes(ndata->lanes, inmsg, &stamp);
+    }
+    else {
+      /*process first message in the queue*/
+      wait_queue(node->queue);
+      len = dequeue(node->queue, inmsg, &stamp);
+    }
+    if (ndata->record != NULL) {
+      record_msg(ndata->record, inmsg, len);
+    }
+    if (ndata->hists != NULL) {
+      waited = queue_clock() - stamp;
+    }
 
     /*Retrieve information about which link the message came from beforehand.
     This is very hacky and should have been externalized to a function, but
     since we can't return both the socket and index of the edge at the same
-    time, and we need to find out the edge's status using its index...*/
+    time, and we need to find out the edge's status using its index... Edges
+    are identified by the sender's ID, since weights may be repeated*/
     struct edge *link = node->neighs->head;
-    uint16_t i, inweight = (inmsg[1] << 8) | inmsg[2];
-    uint8_t sock;
-    for (i = 0; i < node_data.num_neighs; i++) {
-      if (link->weight == inweight) {
+    uint16_t i, sender = (inmsg[1] << 8) | inmsg[2];
+    uint32_t sock = 0;
+    for (i = 0; i < ndata->num_neighs; i++) {
+      if (link->neigh == sender) {
         sock = link->sock;
         break;
       }
       link = link->next;
     }
 
+    /*whatever the message, keep what it says about the sender's fragment*/
+    if (i < ndata->num_neighs) {
+      learn_frag(ndata, i, inmsg);
+    }
+
     /*react based on incoming message type*/
     uint8_t msg_type = inmsg[0];
+    if (ndata->hists != NULL) {
+      cycles = cycle_count();
+    }
     switch(msg_type) {
       case MSG_CONNECT: {
-        process_connect(node, &node_data, i, sock, inmsg);
+        process_connect(node, ndata, i, sock, inmsg);
         break;
       }
       case MSG_INITIATE: {
-        process_initiate(node, &node_data, i, sock, inmsg);
+        process_initiate(node, ndata, i, sock, inmsg);
         break;
       }
       case MSG_TEST: {
-        process_test(node, &node_data, i, sock, inmsg);
+        process_test(node, ndata, i, sock, inmsg);
         break;
       }
       case MSG_ACCEPT: {
-        process_accept(node, &node_data, i, sock, inmsg);
+        process_accept(node, ndata, i, sock, inmsg);
         break;
       }
       case MSG_REJECT: {
-        process_reject(node, &node_data, i, inmsg);
+        process_reject(node, ndata, i, inmsg);
         break;
       }
       case MSG_REPORT: {
         /*node should terminate execution based on report's return value*/
-        if (process_report(node, &node_data, i, sock, inmsg)) {
+        if (process_report(node, ndata, i, sock, inmsg)) {
             run = 0;
         }
         break;
       }
       case MSG_CHGROOT: {
-        changeroot(node, &node_data);
+        changeroot(node, ndata);
         break;
       }
       default: {
@@ -76,11 +147,41 @@ void ghs (struct node *node) {
         break;
       }
     }
+
+    /*anything we don't know goes in the last histogram*/
+    if (ndata->hists != NULL) {
+      uint8_t type = (msg_type < HIST_TYPES) ? msg_type : HIST_TYPES - 1;
+      hist_add(&ndata->hists[HIST_HANDLER][type], cycle_count() - cycles);
+      hist_add(&ndata->hists[HIST_RESIDENCE][type], waited);
+    }
+
+    /*messages that were put back in the queue can't be handled just yet, so
+    give whoever can change that a chance to run (nobody, when replaying).
+    Parked ones wait for the node to handle something else instead, which it
+    just did, unless this one was parked too*/
+    if (ndata->deferred) {
+      ndata->deferred = 0;
+      if (!ndata->replay && ndata->lanes == NULL) {
+        backoff(node);
+      }
+    }
+    else if (ndata->lanes != NULL) {
+      unpark_msgs(ndata->lanes);
+    }
   }
 
-  /*after node has finished running, print its output (the status of its edges)
-  to the global log*/
-  output(node, &node_data);
+  /*anything left was for a fragment that's done by now*/
+  if (ndata->lanes != NULL) {
+    free_lanes(ndata->lanes);
+    ndata->lanes = NULL;
+  }
+
+  record_phase(node, ndata, PHASE_DONE);
+  dump_histograms(node, ndata);
+  if (ndata->record != NULL) {
+    fclose(ndata->record);
+    ndata->record = NULL;
+  }
 }
 
 void process_connect(struct node *node, struct node_data *ndata,
@@ -88,14 +189,14 @@ void process_connect(struct node *node, struct node_data *ndata,
 
   uint8_t inlevel, outmsg[50];
   char logmsg[60];
-  uint16_t inweight;
+  struct edge_key inkey;
 
   /*retrieve message data*/
   inlevel = msg[3];
-  inweight = (msg[1] << 8) | msg[2];
+  inkey = incoming_key(node, msg);
 
-  snprintf(logmsg, 60, "Received CONNECT msg, lvl: %d, weight: %d",
-                                                            inlevel, inweight);
+  snprintf(logmsg, 60, "Received CONNECT msg, lvl: %d, w: %" PRIweight,
+                                                      inlevel, inkey.weight);
   log_msg(logmsg, node->log);
 
   /*received connect from lower level, sender node's fragment can be absorbed*/
@@ -105,9 +206,9 @@ void process_connect(struct node *node, struct node_data *ndata,
 
     /*send INITIATE message and log it*/
     uint8_t len;
-    len = create_msg(MSG_INITIATE, inweight, ndata->level, ndata->frag_id,
+    len = create_msg(MSG_INITIATE, node->id, ndata->level, ndata->frag_id,
                                                         ndata->state, outmsg);
-    send(edge_sock, outmsg, len, 0);
+    send_msg(node, edge_sock, outmsg, len);
     snprintf(logmsg, 60, "Sending INITIATE message to absorbable fragment!");
     log_msg(logmsg, node->log);
 
@@ -122,16 +223,15 @@ void process_connect(struct node *node, struct node_data *ndata,
     snprintf(logmsg, 60, "Cannot respond yet, delaying response!");
     log_msg(logmsg, node->log);
     /*place message at end of queue, CONNECT messages always have len 4*/
-    enqueue(node->queue, msg, 4);
-    sleep(1);
+    defer(node, ndata, msg, 4);
   }
 
   /*only case left is a merge, so we send the INITIATE message with next level*/
   else {
     uint8_t len;
-    len = create_msg(MSG_INITIATE, inweight, (ndata->level)+1, inweight,
+    len = create_msg(MSG_INITIATE, node->id, (ndata->level)+1, inkey,
                                                             NODE_FIND, outmsg);
-    send(edge_sock, outmsg, len, 0);
+    send_msg(node, edge_sock, outmsg, len);
     snprintf(logmsg, 60, "Sending INITIATE message to ADVANCE LEVEL!");
     log_msg(logmsg, node->log);
   }
@@ -140,18 +240,17 @@ void process_connect(struct node *node, struct node_data *ndata,
 void process_initiate(struct node *node, struct node_data *ndata,
                         uint16_t edge_index, uint32_t edge_sock, uint8_t *msg) {
   uint8_t inlevel, instate, outmsg[50];
-  uint16_t inweight, infrag;
+  struct edge_key infrag;
   char logmsg[60];
 
   /*retrieve message data*/
   inlevel = msg[3];
   instate = msg[4];
-  inweight = (msg[1] << 8) | msg[2];
-  infrag = (msg[5] << 8) | msg[6];
+  infrag = get_key(&msg[5]);
 
   /*log message arrival and its parameters*/
-  snprintf(logmsg, 60, "Received INITIATE message. Lvl: %d, F: %d, St: %d",
-                                                    inlevel, infrag, instate);
+  snprintf(logmsg, 60, "Got INITIATE. Lvl: %d, F: %" PRIweight ", St: %d",
+                                            inlevel, infrag.weight, instate);
   log_msg(logmsg, node->log);
 
   /*node is advancing level, update node data to match new level and fragment*/
@@ -160,14 +259,14 @@ void process_initiate(struct node *node, struct node_data *ndata,
   ndata->state = instate;
   ndata->edge_status[edge_index] = EDGE_BRANCH;
   ndata->in_branch = edge_index;
-  ndata->branch_wt = inweight;
   ndata->branch_sock = edge_sock;
   ndata->best_edge = -1;
-  ndata->best_weight = ~0;
+  ndata->best_key = max_key();
+  record_phase(node, ndata, PHASE_INITIATE);
 
   /*log level advancement in the global log*/
-  snprintf(logmsg, 60, "Node %d is ADVANCING to level %d in fragment %d!",
-                                        node->id, ndata->level, ndata->frag_id);
+  snprintf(logmsg, 60, "Node %d: ADVANCING to level %d, F: %" PRIweight "!",
+                                        node->id, ndata->level, infrag.weight);
   log_msg(logmsg, node->globallog);
 
   /*now for each MST neighbour (edge is BRANCH), who isn't the node who just
@@ -180,11 +279,11 @@ void process_initiate(struct node *node, struct node_data *ndata,
     }
 
     uint8_t len;
-    len=create_msg(MSG_INITIATE, link->weight,inlevel, infrag, instate, outmsg);
+    len = create_msg(MSG_INITIATE, node->id, inlevel, infrag, instate, outmsg);
 
     /*propagate INITIATE forward, and log*/
-    send(link->sock, outmsg, len, 0);
-    snprintf(logmsg, 60, "Propagating INITIATE message on edge with weight %d",
+    send_msg(node, link->sock, outmsg, len);
+    snprintf(logmsg, 60, "Propagating INITIATE, edge weight %" PRIweight,
                                                                   link->weight);
     log_msg(logmsg, node->log);
 
@@ -203,17 +302,18 @@ void process_initiate(struct node *node, struct node_data *ndata,
 void process_test(struct node *node,struct node_data *ndata,uint16_t edge_index,
                                             uint32_t edge_sock, uint8_t *msg) {
     char logmsg[60];
-    uint16_t inweight, infrag;
+    weight_t inweight;
+    struct edge_key infrag;
     uint8_t inlevel, outmsg[50];
 
     /*retrieve message data*/
-    inweight = (msg[1] << 8) | msg[2];
+    inweight = incoming_key(node, msg).weight;
     inlevel = msg[3];
-    infrag = (msg[4] << 8) | msg[5];
+    infrag = get_key(&msg[4]);
 
     /*log message arrival*/
-    snprintf(logmsg, 60, "Received TEST msg. W: %d, L: %d, F: %d", inweight,
-                                                            inlevel, infrag);
+    snprintf(logmsg, 60, "Received TEST msg. L: %d, F: %" PRIweight, inlevel,
+                                                                infrag.weight);
     log_msg(logmsg, node->log);
 
     /*If sender is at higher level, we don't know if we are in the same fragment
@@ -221,18 +321,30 @@ void process_test(struct node *node,struct node_data *ndata,uint16_t edge_index,
     if (inlevel > ndata->level) {
         snprintf(logmsg, 60, "Sender has higher level, delaying response!");
         log_msg(logmsg, node->log);
-        /*place message at the end of the queue, TEST messages have length 6*/
-        enqueue(node->queue, msg, 6);
-        sleep(1);
+        /*place message at the end of the queue, TEST messages carry a level
+        and a key*/
+        defer(node, ndata, msg, 4 + KEY_LEN);
+    }
+
+    /*Sender is outside our fragment and at our level, and we're testing the
+    same edge. The lean variant takes its TEST as the ACCEPT it would send us,
+    and it will do the same with ours, so nobody sends an ACCEPT*/
+    else if ((ndata->options & GHS_LEAN) && probing(ndata, edge_index) &&
+              inlevel == ndata->level &&
+              compare_keys(infrag, ndata->frag_id) != 0) {
+        snprintf(logmsg, 60, "Crossing TESTs, taking it as an ACCEPT!");
+        log_msg(logmsg, node->log);
+        process_accept(node, ndata, edge_index, edge_sock, msg);
     }
 
     /*Sender is outside our fragment and lower/equal level, send ACCEPT*/
-    else if (infrag != ndata->frag_id) {
-        snprintf(logmsg, 60, "Sending ACCEPT msg on edge with weight %d",
+    else if (compare_keys(infrag, ndata->frag_id) != 0) {
+        snprintf(logmsg, 60, "Sending ACCEPT on edge with weight %" PRIweight,
                                                                     inweight);
         log_msg(logmsg, node->log);
-        uint8_t len = create_msg(MSG_ACCEPT, inweight, 0, 0, 0, outmsg);
-        send(edge_sock, outmsg, len, 0);
+        uint8_t len = create_msg(MSG_ACCEPT, node->id, 0, max_key(), 0,
+                                                                      outmsg);
+        send_msg(node, edge_sock, outmsg, len);
     }
 
     /*Only other possibility is an invalid edge (leads to same fragment), so we
@@ -245,18 +357,26 @@ void process_test(struct node *node,struct node_data *ndata,uint16_t edge_index,
             ndata->edge_status[edge_index] = EDGE_REJECT;
         }
 
-        if (ndata->test_edge != edge_index) {
+        if (!probing(ndata, edge_index)) {
             snprintf(logmsg, 60, "Sending REJECT msg on tested edge!");
             log_msg(logmsg, node->log);
 
-            uint8_t len = create_msg(MSG_REJECT, inweight, 0, 0, 0, outmsg);
-            send(edge_sock, outmsg, len, 0);
+            uint8_t len = create_msg(MSG_REJECT, node->id, 0, max_key(), 0,
+                                                                      outmsg);
+            send_msg(node, edge_sock, outmsg, len);
         }
 
         else {
             snprintf(logmsg, 60, "Rejecting TEST edge, no need to report!");
             log_msg(logmsg, node->log);
-            test(node, ndata);
+            /*the other end won't answer our probe either, so this is its
+            answer (a speculating node may well have reported already)*/
+            if (ndata->options & GHS_SPECULATE) {
+                answer_probe(node, ndata, edge_index, 0);
+            }
+            else {
+                test(node, ndata);
+            }
         }
     }
 }
@@ -264,22 +384,29 @@ void process_test(struct node *node,struct node_data *ndata,uint16_t edge_index,
 void process_accept(struct node *node, struct node_data *ndata,
                         uint16_t edge_index, uint32_t edge_sock, uint8_t *msg) {
     char logmsg[60];
-    uint16_t inweight;
+    struct edge_key inkey;
 
     /*retrieve message data*/
-    inweight = (msg[1] << 8) | msg[2];
+    inkey = incoming_key(node, msg);
 
     /*log message arrival*/
-    snprintf(logmsg, 60, "Received ACCEPT on edge with weight %d", inweight);
+    snprintf(logmsg, 60, "Received ACCEPT on edge with weight %" PRIweight,
+                                                                  inkey.weight);
     log_msg(logmsg, node->log);
 
+    /*speculating nodes may still be waiting on lighter edges*/
+    if (ndata->options & GHS_SPECULATE) {
+        answer_probe(node, ndata, edge_index, 1);
+        return;
+    }
+
     /*edge was accepted, we don't need test_edge anymore for this level*/
     ndata->test_edge = -1;
 
     /*if new best edge, update it*/
-    if (inweight < ndata->best_weight) {
+    if (compare_keys(inkey, ndata->best_key) < 0) {
         ndata->best_edge = edge_index;
-        ndata->best_weight = inweight;
+        ndata->best_key = inkey;
         ndata->best_sock = edge_sock;
     }
 
@@ -290,15 +417,21 @@ void process_accept(struct node *node, struct node_data *ndata,
 void process_reject(struct node *node, struct node_data *ndata,
                                             uint16_t edge_index, uint8_t *msg) {
     char logmsg[60];
-    uint16_t inweight;
+    weight_t inweight;
 
     /*retrieve edge weight, for logging*/
-    inweight = (msg[1] << 8) | msg[2];
+    inweight = incoming_key(node, msg).weight;
 
     /*log message arrival*/
-    snprintf(logmsg, 60, "Received REJECT on edge with weight %d!", inweight);
+    snprintf(logmsg, 60, "Received REJECT on edge with weight %" PRIweight "!",
+                                                                      inweight);
     log_msg(logmsg, node->log);
 
+    if (ndata->options & GHS_SPECULATE) {
+        answer_probe(node, ndata, edge_index, 0);
+        return;
+    }
+
     /*update edge status to REJECT if necessary, and begin testing other edges*/
     if (ndata->edge_status[edge_index] == EDGE_UNKNOWN) {
         ndata->edge_status[edge_index] = EDGE_REJECT;
@@ -310,25 +443,27 @@ void process_reject(struct node *node, struct node_data *ndata,
 uint8_t process_report(struct node *node, struct node_data *ndata,
                         uint16_t edge_index, uint32_t edge_sock, uint8_t *msg) {
     char logmsg[60];
-    uint16_t reported_weight, max_wt;
+    struct edge_key reported, max;
 
     /*retrieve message data*/
-    reported_weight = (msg[3] << 8) | msg[4];
-    max_wt = (uint16_t) ~0;
+    reported = get_key(&msg[3]);
+    max = max_key();
 
     /*log message arrival*/
-    snprintf(logmsg,60,"Received REPORT msg with LWOE cost %d",reported_weight);
+    snprintf(logmsg, 60, "Received REPORT msg with LWOE cost %" PRIweight,
+                                                              reported.weight);
     log_msg(logmsg, node->log);
 
     /*it's a regular neighbour reporting to us*/
     if (edge_index != ndata->in_branch) {
         ndata->fcount -= 1;
         /*if new best edge, update it*/
-        if (reported_weight < ndata->best_weight) {
-            snprintf(logmsg,60,"Found new LWOE w/ weight %d!", reported_weight);
+        if (compare_keys(reported, ndata->best_key) < 0) {
+            snprintf(logmsg, 60, "Found new LWOE w/ weight %" PRIweight "!",
+                                                              reported.weight);
             log_msg(logmsg, node->log);
 
-            ndata->best_weight = reported_weight;
+            ndata->best_key = reported;
             ndata->best_edge = edge_index;
             ndata->best_sock = edge_sock;
         }
@@ -341,20 +476,20 @@ uint8_t process_report(struct node *node, struct node_data *ndata,
         snprintf(logmsg, 60, "Delaying response to REPORT message!");
         log_msg(logmsg, node->log);
         /*place message back into the end of the queue*/
-        enqueue(node->queue, msg, 5);
-        sleep(1);
+        defer(node, ndata, msg, 3 + KEY_LEN);
     }
 
     /*received a weight that is higher than current candidate, means we found
     LWOE already, and can start changeroot immediately*/
-    else if (reported_weight > ndata->best_weight) {
+    else if (compare_keys(reported, ndata->best_key) > 0) {
         snprintf(logmsg, 60, "Found LWOE, calling CHANGEROOT procedure!");
         log_msg(logmsg, node->log);
         changeroot(node, ndata);
     }
 
     /*if incoming edge has 'infinite' weight, the algorithm is done!*/
-    else if (reported_weight == max_wt && ndata->best_weight == max_wt) {
+    else if (compare_keys(reported, max) == 0 &&
+                                    compare_keys(ndata->best_key, max) == 0) {
         /*this is a hacky way to force termination for other nodes: we send them
         report messages with maximum weight, so they are notified the algorithm
         has finished as well*/
@@ -363,8 +498,8 @@ uint8_t process_report(struct node *node, struct node_data *ndata,
         for (i = 0; i < ndata->num_neighs; i++) {
           if (ndata->edge_status[i] == EDGE_BRANCH && i != ndata->in_branch) {
             uint8_t outmsg[50];
-            uint8_t len=create_msg(MSG_REPORT,link->weight,0,ndata->best_weight,0,outmsg);
-            send(link->sock, outmsg, len, 0);
+            uint8_t len=create_msg(MSG_REPORT,node->id,0,ndata->best_key,0,outmsg);
+            send_msg(node, link->sock, outmsg, len);
           }
           link = link->next;
         }
@@ -380,6 +515,7 @@ void changeroot(struct node *node, struct node_data *ndata) {
 
     snprintf(logmsg, 60, "Beginning CHANGEROOT procedure!");
     log_msg(logmsg, node->log);
+    record_phase(node, ndata, PHASE_CHGROOT);
 
     /*our best edge is already in the MST, so we're not the new root, pass the
     changeroot message forward*/
@@ -387,8 +523,9 @@ void changeroot(struct node *node, struct node_data *ndata) {
         snprintf(logmsg, 60, "Passing CHGEROOT message forward!");
         log_msg(logmsg, node->log);
 
-        uint8_t len = create_msg(MSG_CHGROOT, 0, 0, 0, 0, outmsg);
-        send(ndata->best_sock, outmsg, len, 0);
+        uint8_t len = create_msg(MSG_CHGROOT, node->id, 0, max_key(), 0,
+                                                                      outmsg);
+        send_msg(node, ndata->best_sock, outmsg, len);
     }
 
     /*we are the new ROOT! Send CONNECT to the other fragment*/
@@ -398,10 +535,12 @@ void changeroot(struct node *node, struct node_data *ndata) {
         log_msg(logmsg, node->log);
 
         uint8_t len;
-        len=create_msg(MSG_CONNECT,ndata->best_weight,ndata->level,0,0,outmsg);
-        send(ndata->best_sock, outmsg, len, 0);
+        len = create_msg(MSG_CONNECT, node->id, ndata->level, max_key(), 0,
+                                                                      outmsg);
+        send_msg(node, ndata->best_sock, outmsg, len);
 
         ndata->edge_status[ndata->best_edge] = EDGE_BRANCH;
+        record_phase(node, ndata, PHASE_CONNECT);
     }
 }
 
@@ -410,28 +549,65 @@ void wakeup(struct node *node, struct node_data *data) {
   char logmsg[60];
 
   /*Initialize node's data. All nodes start at state FOUND, with level, fcount
-  and fragment id 0. All edges begin as UNKNOWN. We also keep track of the
-  node's number of neighbours, which is a bit redundant but whatever*/
+  and fragment id 0, and no edge being tested. All edges begin as UNKNOWN. We
+  also keep track of the node's number of neighbours, which is a bit redundant
+  but whatever*/
   data->state = NODE_FOUND;
   data->level = 0;
   data->fcount = 0;
-  data->frag_id = 0;
+  data->frag_id = make_key(0, 0, 0);
   data->num_neighs = node->neighs->num;
+  data->test_edge = -1;
   data->edge_status = (uint8_t*) malloc(data->num_neighs*sizeof(uint8_t));
   memset(data->edge_status, EDGE_UNKNOWN, data->num_neighs);
+  init_edge_arrays(&data->arrays, node->neighs);
 
-  /*at wakeup we haven't touched any edges yet, so lowest is first in the list*/
-  struct edge *lowest = node->neighs->head;
+  /*speculating nodes start out testing a single edge at a time, like GHS*/
+  data->probes = NULL;
+  data->window = 1;
+  if (data->options & GHS_SPECULATE) {
+    data->probes = calloc(data->num_neighs, sizeof(struct probe));
+  }
+
+  /*we don't know anything about our neighbours' fragments yet*/
+  uint16_t i;
+  data->avoided = 0;
+  data->neigh_frags = malloc(data->num_neighs*sizeof(struct neigh_frag));
+  for (i = 0; i < data->num_neighs; i++) {
+    data->neigh_frags[i].level = 0;
+    data->neigh_frags[i].frag = max_key();
+  }
+
+  /*nodes their worker put in a fragment already know their first edges*/
+  if (node->seed != NULL && node->seed->level > 0) {
+    seed_fragment(node, data);
+    return;
+  }
+
+  /*at wakeup we haven't touched any edges yet, so every edge is a candidate*/
+  int32_t lowest = lightest_edge(data->arrays.weights, data->edge_status,
+                                                data->num_neighs, EDGE_UNKNOWN);
+
+  /*a node with no neighbours is a whole tree already, with nobody to connect
+  to (find_mst() doesn't wait on it)*/
+  if (lowest == -1) {
+    snprintf(logmsg, 60, "No neighbours, nothing to connect to!");
+    log_msg(logmsg, node->log);
+    return;
+  }
 
   /*log lowest cost edge, and update its status*/
-  data->edge_status[0] = EDGE_BRANCH;
-  snprintf(logmsg, 60, "My lowest edge has weight %d", lowest->weight);
+  data->edge_status[lowest] = EDGE_BRANCH;
+  snprintf(logmsg, 60, "My lowest edge has weight %" PRIweight,
+                                                data->arrays.weights[lowest]);
   log_msg(logmsg, node->log);
 
   /*send lowest edge neighbour a CONNECT message*/
   uint8_t msg_len;
-  msg_len = create_msg(MSG_CONNECT, lowest->weight, data->level, 0, 0, outmsg);
-  send(lowest->sock, outmsg, msg_len, 0);
+  msg_len = create_msg(MSG_CONNECT, node->id, data->level, max_key(), 0,
+                                                                      outmsg);
+  send_msg(node, data->arrays.socks[lowest], outmsg, msg_len);
+  record_phase(node, data, PHASE_CONNECT);
 
   /*and log the send event*/
   snprintf(logmsg, 60, "Sending CONNECT message with level %d to lowest edge!",
@@ -439,6 +615,37 @@ void wakeup(struct node *node, struct node_data *data) {
   log_msg(logmsg, node->log);
 }
 
+void seed_fragment(struct node *node, struct node_data *data) {
+  struct seed *seed = node->seed;
+  struct edge *link;
+  uint8_t outmsg[50];
+  char logmsg[60];
+  uint16_t i, j;
+
+  for (i = 0, link = node->neighs->head; i < data->num_neighs;
+                                                      i++, link = link->next) {
+    for (j = 0; j < seed->num_inside; j++) {
+      if (link->neigh == seed->inside[j]) {
+        data->edge_status[i] = (j < seed->num_branches) ? EDGE_BRANCH
+                                                        : EDGE_REJECT;
+      }
+    }
+
+    /*the core's ends merge their fragment into being*/
+    if (link->neigh == seed->core) {
+      uint8_t len;
+      struct edge_key core = make_key(link->weight, node->id, link->neigh);
+      len = create_msg(MSG_INITIATE, node->id, seed->level, core, NODE_FIND,
+                                                                      outmsg);
+      send_msg(node, link->sock, outmsg, len);
+    }
+  }
+
+  snprintf(logmsg, 60, "Starting in a fragment, level %d, %d branches!",
+                                            seed->level, seed->num_branches);
+  log_msg(logmsg, node->log);
+}
+
 void test(struct node *node, struct node_data *ndata) {
     char logmsg[60];
     uint8_t outmsg[50];
@@ -446,28 +653,35 @@ void test(struct node *node, struct node_data *ndata) {
     snprintf(logmsg, 60, "Running TEST procedure to find LWOE!");
     log_msg(logmsg, node->log);
 
-    /*Iterate over the node's edges, storing the lowest weight edge that hasn't
-    been classified as REJECT or BRANCH*/
-    ndata->test_edge = -1;
-    uint16_t i, edge_weight;
-    uint32_t sock;
-    struct edge *link = node->neighs->head;
-    for (i = 0; i < ndata->num_neighs; i++, link = link->next) {
-        if (ndata->edge_status[i] == EDGE_UNKNOWN) {
-            ndata->test_edge = i;
-            edge_weight = link->weight;
-            sock = link->sock;
-            break;
-        }
+    if (ndata->options & GHS_SPECULATE) {
+        speculate(node, ndata);
+        return;
     }
 
+    /*Find the lowest weight edge that hasn't been classified as REJECT or
+    BRANCH, skipping (and rejecting) the ones to neighbours we know are in our
+    fragment, since there's no need to ask them*/
+    int32_t i;
+    weight_t *weights = ndata->arrays.weights;
+    while ((i = lightest_edge(weights, ndata->edge_status, ndata->num_neighs,
+                          EDGE_UNKNOWN)) != -1 && known_internal(ndata, i)) {
+        ndata->edge_status[i] = EDGE_REJECT;
+        ndata->avoided++;
+        snprintf(logmsg, 60, "Edge with weight %" PRIweight " is internal!",
+                                                                  weights[i]);
+        log_msg(logmsg, node->log);
+    }
+    ndata->test_edge = i;
+    weight_t edge_weight = (i != -1) ? weights[i] : 0;
+    uint32_t sock = (i != -1) ? ndata->arrays.socks[i] : 0;
+
     /*Found a candidate edge, send test message across it.*/
     if (ndata->test_edge != -1) {
         uint8_t len;
-        len = create_msg(MSG_TEST, edge_weight, ndata->level, ndata->frag_id,
+        len = create_msg(MSG_TEST, node->id, ndata->level, ndata->frag_id,
                                                                     0, outmsg);
-        send(sock, outmsg, len, 0);
-        snprintf(logmsg, 60, "Sending TEST message on edge with weight %d",
+        send_msg(node, sock, outmsg, len);
+        snprintf(logmsg, 60, "Sending TEST on edge with weight %" PRIweight,
                                                                 edge_weight);
         log_msg(logmsg, node->log);
     }
@@ -488,15 +702,183 @@ void report(struct node *node, struct node_data *ndata) {
     if (ndata->fcount == 0 && ndata->test_edge == -1) {
         /*we finished the discovery phase, move on to state FOUND*/
         ndata->state = NODE_FOUND;
+        record_phase(node, ndata, PHASE_REPORT);
 
         /*log beginning of report procedure*/
         snprintf(logmsg, 60, "Node %d has begun reporting LWOE!", node->id);
         log_msg(logmsg, node->log);
 
         /*send report message to 'parent' in the MST*/
-        uint8_t len=create_msg(MSG_REPORT, ndata->branch_wt, 0,
-                                                ndata->best_weight, 0, outmsg);
-        send(ndata->branch_sock, outmsg, len, 0);
+        uint8_t len=create_msg(MSG_REPORT, node->id, 0, ndata->best_key, 0,
+                                                                      outmsg);
+        send_msg(node, ndata->branch_sock, outmsg, len);
+    }
+}
+
+void speculate(struct node *node, struct node_data *ndata) {
+    char logmsg[60];
+    uint8_t outmsg[50], len, in_flight = 0;
+    uint16_t i;
+    struct edge *link;
+
+    /*count the probes still waiting on an answer*/
+    for (i = 0; i < ndata->num_neighs; i++) {
+        if (ndata->edge_status[i] == EDGE_UNKNOWN &&
+                                  ndata->probes[i].state == PROBE_SENT) {
+            in_flight++;
+        }
+    }
+
+    /*Walk the candidate edges from the lightest. The first one accepted at
+    this level is our LWOE, but only once nothing lighter is pending, and while
+    walking we send TESTs on the edges nobody has probed yet, up to the window.
+    test_edge ends up on the lightest edge we're still waiting on*/
+    ndata->test_edge = -1;
+    link = node->neighs->head;
+    for (i = 0; i < ndata->num_neighs; i++, link = link->next) {
+        struct probe *probe = &ndata->probes[i];
+
+        /*no need to ask neighbours we know are in our fragment*/
+        if (ndata->edge_status[i] == EDGE_UNKNOWN &&
+                      probe->state != PROBE_SENT && known_internal(ndata, i)) {
+            ndata->edge_status[i] = EDGE_REJECT;
+            ndata->avoided++;
+            snprintf(logmsg, 60, "Edge with weight %" PRIweight " is internal!",
+                                                                  link->weight);
+            log_msg(logmsg, node->log);
+        }
+
+        if (ndata->edge_status[i] != EDGE_UNKNOWN) {
+            continue;
+        }
+
+        if (probe->state == PROBE_ACCEPTED && probe->level == ndata->level) {
+            if (ndata->test_edge != -1) {
+                break;
+            }
+
+            /*nothing lighter left, this is it*/
+            struct edge_key key = make_key(link->weight, node->id, link->neigh);
+            if (compare_keys(key, ndata->best_key) < 0) {
+                ndata->best_edge = i;
+                ndata->best_key = key;
+                ndata->best_sock = link->sock;
+            }
+            snprintf(logmsg, 60, "Lightest probe accepted, window was %d!",
+                                                                ndata->window);
+            log_msg(logmsg, node->log);
+
+            /*the probes past the LWOE were wasted, so don't send as many*/
+            ndata->window = (ndata->window > 1) ? ndata->window / 2 : 1;
+            report(node, ndata);
+            return;
+        }
+
+        if (probe->state == PROBE_SENT) {
+            if (ndata->test_edge == -1) {
+                ndata->test_edge = i;
+            }
+            continue;
+        }
+
+        /*never probed, or accepted at a lower level, which tells us nothing*/
+        if (in_flight >= ndata->window) {
+            if (ndata->test_edge == -1) {
+                ndata->test_edge = i;
+            }
+            break;
+        }
+        len = create_msg(MSG_TEST, node->id, ndata->level, ndata->frag_id, 0,
+                                                                      outmsg);
+        send_msg(node, link->sock, outmsg, len);
+        probe->state = PROBE_SENT;
+        probe->level = ndata->level;
+        in_flight++;
+        if (ndata->test_edge == -1) {
+            ndata->test_edge = i;
+        }
+        snprintf(logmsg, 60, "Sending TEST on edge with weight %" PRIweight,
+                                                                  link->weight);
+        log_msg(logmsg, node->log);
+    }
+
+    /*No candidate edge left, report back to 'parent'*/
+    if (ndata->test_edge == -1) {
+        snprintf(logmsg, 60, "No candidate edge, reporting!");
+        log_msg(logmsg, node->log);
+        report(node, ndata);
+    }
+}
+
+void answer_probe(struct node *node, struct node_data *ndata,
+                                      uint16_t edge_index, uint8_t accepted) {
+    struct probe *probe = &ndata->probes[edge_index];
+
+    /*the other end already learned the edge is internal from our own TEST*/
+    if (probe->state != PROBE_SENT) {
+        return;
+    }
+
+    /*an ACCEPT only holds for the level we sent the TEST at, a REJECT holds for
+    good*/
+    if (accepted) {
+        probe->state = (probe->level == ndata->level) ? PROBE_ACCEPTED
+                                                      : PROBE_NONE;
+    }
+    else {
+        if (ndata->edge_status[edge_index] == EDGE_UNKNOWN) {
+            ndata->edge_status[edge_index] = EDGE_REJECT;
+        }
+        probe->state = PROBE_NONE;
+        widen_window(ndata);
+    }
+
+    /*if we're still looking for our LWOE, see if this settled it*/
+    if (ndata->test_edge != -1) {
+        speculate(node, ndata);
+    }
+}
+
+uint8_t probing(struct node_data *ndata, uint16_t edge_index) {
+    if (ndata->options & GHS_SPECULATE) {
+        return ndata->probes[edge_index].state == PROBE_SENT &&
+                          ndata->probes[edge_index].level == ndata->level;
+    }
+    return ndata->test_edge == edge_index;
+}
+
+void learn_frag(struct node_data *ndata, uint16_t edge_index, uint8_t *msg) {
+    struct neigh_frag *known = &ndata->neigh_frags[edge_index];
+    uint8_t inlevel;
+    struct edge_key infrag;
+
+    /*only TESTs and INITIATEs carry the sender's fragment*/
+    if (msg[0] == MSG_TEST) {
+        inlevel = msg[3];
+        infrag = get_key(&msg[4]);
+    }
+    else if (msg[0] == MSG_INITIATE) {
+        inlevel = msg[3];
+        infrag = get_key(&msg[5]);
+    }
+    else {
+        return;
+    }
+
+    if (compare_keys(known->frag, max_key()) == 0 || inlevel >= known->level) {
+        known->level = inlevel;
+        known->frag = infrag;
+    }
+}
+
+uint8_t known_internal(struct node_data *ndata, uint16_t edge_index) {
+    return compare_keys(ndata->neigh_frags[edge_index].frag,
+                                                      ndata->frag_id) == 0;
+}
+
+void widen_window(struct node_data *ndata) {
+    if (ndata->window < SPEC_MAX_WINDOW) {
+        ndata->window *= 2;
     }
 }
 
@@ -507,29 +889,103 @@ void output (struct node *node, struct node_data *ndata) {
   snprintf(logmsg, 60, "Node %d is reporting its BRANCH edges!", node->id);
   log_msg(logmsg, node->globallog);
 
-  /*initialize report string*/
-  char *ptr = logmsg;
-  ptr += snprintf(logmsg, 60, "Node %d: ", node->id);
+  /*initialize report string, with room for every edge (they're at most
+  WEIGHT_DIGITS long each), since well connected nodes won't fit in a regular
+  log message*/
+  char *report = malloc(16 + (WEIGHT_DIGITS + 1)*ndata->num_neighs);
+  char *ptr = report;
+  ptr += sprintf(report, "Node %d: ", node->id);
 
   /*go through edges, appending their status*/
   uint16_t i;
   struct edge *link = node->neighs->head;
   for (i = 0; i < ndata->num_neighs; i++) {
     if (ndata->edge_status[i] == EDGE_BRANCH) {
-      ptr += snprintf(ptr,10,"%d ",link->weight);
+      ptr += sprintf(ptr, "%" PRIweight " ", link->weight);
+      report_edge(node, link->neigh, link->weight);
     }
     link = link->next;
   }
   /*print final GHS algorithm log message for the node*/
-  log_msg(logmsg, node->globallog);
+  log_msg(report, node->globallog);
+  free(report);
+
+  /*let the parent know how many TESTs we saved, if any*/
+  if (ndata->avoided) {
+    write_result(node->results, RESULT_AVOIDED, node->id, &ndata->avoided,
+                                                      sizeof(ndata->avoided));
+  }
+  if (ndata->deferrals) {
+    write_result(node->results, RESULT_DEFERRED, node->id, &ndata->deferrals,
+                                                    sizeof(ndata->deferrals));
+  }
 
   /*free its edge status array, which is the only dynamically allocated struct-
-  ture we malloc for each node in the algorithm implementation*/
+  ture we malloc for each node in the algorithm implementation (along with the
+  edge arrays, and the probes when speculating)*/
   free(ndata->edge_status);
+  free_edge_arrays(&ndata->arrays);
+  free(ndata->probes);
+  free(ndata->neigh_frags);
 }
 
-uint8_t create_msg(uint8_t type, uint16_t weight, uint8_t level, uint16_t frag,
-                                            uint8_t state, uint8_t *buffer) {
+void record_phase(struct node *node, struct node_data *ndata, uint8_t event) {
+  struct result_phase phase;
+
+  if (!(ndata->options & GHS_TIMELINE)) {
+    return;
+  }
+
+  phase.time = mono_time();
+  phase.frag = ndata->frag_id.weight;
+  phase.frag_lo = ndata->frag_id.lo;
+  phase.frag_hi = ndata->frag_id.hi;
+  phase.node = node->id;
+  phase.event = event;
+  phase.level = ndata->level;
+  phase.state = ndata->state;
+  write_result(node->results, RESULT_PHASE, node->id, &phase, sizeof(phase));
+}
+
+void defer(struct node *node, struct node_data *ndata, uint8_t *msg,
+                                                                uint32_t len) {
+  if (ndata->lanes != NULL) {
+    park_msg(ndata->lanes, msg, len, queue_stamp(node->queue));
+  }
+  else if (!ndata->replay) {
+    enqueue(node->queue, msg, len);
+  }
+  ndata->deferred = 1;
+  ndata->deferrals++;
+}
+
+void dump_histograms(struct node *node, struct node_data *ndata) {
+  struct result_histogram rec;
+  uint8_t metric, type;
+
+  if (ndata->hists == NULL) {
+    return;
+  }
+
+  for (metric = 0; metric < HIST_METRICS; metric++) {
+    for (type = 0; type < HIST_TYPES; type++) {
+      if (ndata->hists[metric][type].count == 0) {
+        continue;
+      }
+      rec.metric = metric;
+      rec.type = type;
+      rec.hist = ndata->hists[metric][type];
+      write_result(node->results, RESULT_HISTOGRAM, node->id, &rec,
+                                                                sizeof(rec));
+    }
+  }
+
+  free(ndata->hists);
+  ndata->hists = NULL;
+}
+
+uint8_t create_msg(uint8_t type, uint16_t sender, uint8_t level,
+                    struct edge_key frag, uint8_t state, uint8_t *buffer) {
 
   /*avoid messing with invalid pointers*/
   if (buffer == NULL) {
@@ -538,11 +994,12 @@ uint8_t create_msg(uint8_t type, uint16_t weight, uint8_t level, uint16_t frag,
 
   uint8_t msg_len;
 
-  /*all messages share the first three bytes, for msg type and weight. All
-  messages piggyback edge weight so the receiving node can identify the edge*/
+  /*all messages share the first three bytes, for msg type and sender. All
+  messages piggyback the sender's ID so the receiving node can identify the
+  edge, which the weight alone can't do when weights are repeated*/
   buffer[0] = type;
-  buffer[1] = (weight >> 8) & 0xFF;
-  buffer[2] = weight & 0xFF;
+  buffer[1] = (sender >> 8) & 0xFF;
+  buffer[2] = sender & 0xFF;
   msg_len = 3;
 
   /*fill out message content based on type*/
@@ -557,17 +1014,13 @@ uint8_t create_msg(uint8_t type, uint16_t weight, uint8_t level, uint16_t frag,
     case MSG_INITIATE: {
       buffer[3] = level;
       buffer[4] = state;
-      buffer[5] = (frag >> 8) & 0xFF;
-      buffer[6] = frag & 0xFF;
-      msg_len += 4;
+      msg_len += 2 + put_key(&buffer[5], frag);
       break;
     }
     /*TEST messages piggyback fragment level and edge*/
     case MSG_TEST: {
         buffer[3] = level;
-        buffer[4] = (frag >> 8) & 0xFF;
-        buffer[5] = frag & 0xFF;
-        msg_len += 3;
+        msg_len += 1 + put_key(&buffer[4], frag);
         break;
     }
     /*ACCEPT and REJECT messages don't have any additional info. Neither does
@@ -577,11 +1030,9 @@ uint8_t create_msg(uint8_t type, uint16_t weight, uint8_t level, uint16_t frag,
     case MSG_CHGROOT: {
         break;
     }
-    /*REPORT messages add on the reported weight in the fragment field*/
+    /*REPORT messages add on the reported edge in the fragment field*/
     case MSG_REPORT: {
-        buffer[3] = (frag >> 8) & 0xFF;
-        buffer[4] = frag & 0xFF;
-        msg_len += 2;
+        msg_len += put_key(&buffer[3], frag);
         break;
     }
     /*Unknown message ID, something went very wrong...*/
@@ -592,3 +1043,57 @@ uint8_t create_msg(uint8_t type, uint16_t weight, uint8_t level, uint16_t frag,
   }
   return msg_len;
 }
+
+struct edge_key make_key(weight_t weight, uint8_t a, uint8_t b) {
+  struct edge_key key;
+
+  key.weight = weight;
+  key.lo = (a < b) ? a : b;
+  key.hi = (a < b) ? b : a;
+  return key;
+}
+
+struct edge_key max_key() {
+  return make_key(WEIGHT_MAX, 0xFF, 0xFF);
+}
+
+int8_t compare_keys(struct edge_key k1, struct edge_key k2) {
+  if (k1.weight != k2.weight) {
+    return (k1.weight < k2.weight) ? -1 : 1;
+  }
+  if (k1.lo != k2.lo) {
+    return (k1.lo < k2.lo) ? -1 : 1;
+  }
+  if (k1.hi != k2.hi) {
+    return (k1.hi < k2.hi) ? -1 : 1;
+  }
+  return 0;
+}
+
+struct edge_key incoming_key(struct node *node, uint8_t *msg) {
+  uint16_t sender = (msg[1] << 8) | msg[2];
+  struct edge *link = find_neigh(node->neighs, sender);
+
+  /*messages only ever come from neighbours, but better safe than sorry*/
+  if (link == NULL) {
+    return max_key();
+  }
+  return make_key(link->weight, node->id, sender);
+}
+
+uint8_t put_key(uint8_t *buffer, struct edge_key key) {
+  uint8_t len = put_weight(buffer, key.weight);
+
+  buffer[len++] = key.lo;
+  buffer[len++] = key.hi;
+  return len;
+}
+
+struct edge_key get_key(uint8_t *buffer) {
+  struct edge_key key;
+
+  key.weight = get_weight(buffer);
+  key.lo = buffer[WEIGHT_LEN];
+  key.hi = buffer[WEIGHT_LEN + 1];
+  return key;
+}
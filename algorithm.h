@@ -11,6 +11,26 @@ sent to it through a function pointer.*/
 
 #include "node.h"       /*can't run an algorithm without some guinea pigs*/
 #include "neighlist.h"  /*the guinea pigs need to know the other guinea pigs*/
+#include "weight.h"     /*and how much it costs to talk to them*/
+#include "histogram.h"  /*and how long it takes*/
+#include "record.h"     /*and in which order*/
+#include "edgearrays.h" /*and which of them is the cheapest*/
+#include "lanes.h"      /*and whom to listen to first*/
+#include "contract.h"   /*and who they're already with*/
+
+/*GHS needs every edge to have a distinct weight, so rather than the weight
+alone, edges are compared by their key: the weight, then the lowest endpoint ID,
+then the highest one. Two edges never share both endpoints, so keys are unique
+even when weights aren't. Neighbour lists are sorted by weight and then by
+neighbour ID, which for a given node is the same order as the keys'.*/
+struct edge_key {
+  weight_t weight;
+  uint8_t lo;
+  uint8_t hi;
+};
+
+/*Length of an edge key in a message*/
+#define KEY_LEN (WEIGHT_LEN + 2)
 
 /*For the GHS algorithm, we need to embed some additional data onto nodes. Since
 we want to keep the node implementation isolated from the algorithm itself, we
@@ -21,30 +41,149 @@ Here's a brief description of the data we store for each node:
   state       -> the node's current state amongst {FIND, FOUND}
   level       -> the node's current fragment level
   fcount      -> the count of neighbours still not reported to this node
-  frag_id     -> weight of the edge that identifies the node's current fragment
+  frag_id     -> key of the edge that identifies the node's current fragment
   num_neighs  -> number of neighbours the node has
   edge_status -> array that keeps track of each of the node's edges' status
+  arrays      -> the node's edges, in arrays indexed like edge_status
   in_branch   -> stores the node's parent in the MST
-  branch_wt   -> weight of the 'parent' edge, so neighbour can ID it
   branch_sock -> stores a reference to the in-branch edge's socket
   test_edge   -> the node's current best candidate edge, which is being tested
   best_edge   -> index of the node's edge that leads to best frag edge
-  best_weight -> weight of best_edge, which is minimum outgoing weight
-  best_sock   -> tracks the socket for the node's best_edge*/
+  best_key    -> key of best_edge, which is the minimum outgoing edge
+  best_sock   -> tracks the socket for the node's best_edge
+  options     -> the GHS_OPTIONS the node runs with
+  deferred    -> whether the last message handled was put back in the queue
+  deferrals   -> how many messages the node put back in the queue (or parked)
+  lanes       -> the lanes the node sorts its messages into, unless it handles
+                 them in the order they arrive (see GHS_POLICIES)
+  hists       -> the node's histograms, by HIST_METRICS and message type (only
+                 allocated when the node keeps them)
+  record      -> the node's recording, if it's being recorded
+  replay      -> whether the node's messages come from a recording
+  probes      -> the TEST sent on each edge, if any (only allocated for the
+                 speculative variant)
+  window      -> how many TESTs the speculative variant may have in flight
+  neigh_frags -> the last fragment each neighbour was known to be in
+  avoided     -> how many TESTs the node didn't send, thanks to neigh_frags*/
 struct node_data {
   uint8_t state;
   uint8_t level;
   uint8_t fcount;
-  uint8_t frag_id;
+  struct edge_key frag_id;
   uint16_t num_neighs;
   uint8_t *edge_status;
+  struct edge_arrays arrays;
   uint8_t in_branch;
-  uint16_t branch_wt;
   uint32_t branch_sock;
   int16_t test_edge;
   int16_t best_edge;
-  uint16_t best_weight;
+  struct edge_key best_key;
   uint32_t best_sock;
+  uint8_t options;
+  uint8_t deferred;
+  uint32_t deferrals;
+  struct lanes *lanes;
+  struct histogram (*hists)[HIST_TYPES];
+  FILE *record;
+  uint8_t replay;
+  struct probe *probes;
+  uint8_t window;
+  struct neigh_frag *neigh_frags;
+  uint32_t avoided;
+};
+
+/*Options a node runs GHS with, which it gets from the command line through
+node->algo_opts. These are flags, so a node can measure any combination of
+things, but it only runs one variant of GHS:
+  TIMELINE   -> report every change of level, state or fragment to the parent
+                as it happens, so it can build a timeline of the run
+  HISTOGRAMS -> keep histograms of how long each type of message waits in the
+                queue and how long it takes to handle, and send them to the
+                parent when done
+  RECORD     -> write every message dequeued to the node's recording, so the
+                run can be replayed (see record.h)
+  LEAN       -> run the variant that saves on ACCEPTs. Textbook GHS already
+                combines two TESTs crossing on an edge inside a fragment: both
+                ends reject the edge without answering, and both ends always
+                mark a rejected edge, whoever sent the REJECT. This variant
+                also combines TESTs crossing on an edge between two fragments
+                at the same level. Each end would answer the other's TEST with
+                an ACCEPT, but the TEST itself already says as much, since a
+                node's level and fragment can't change while its test is
+                pending. So each end takes the other's TEST as an ACCEPT, and
+                neither sends one
+  SPECULATE  -> run the variant that tests several edges at once, see
+                speculate()
+  CONTRACT   -> start from the fragment the node's worker put it in, rather
+                than on its own (see contract.h). Only partitioned workers do,
+                and the node's seed says which fragment it is
+Whatever the variant, the two bits of GHS_POLICY say in which order the node
+handles its messages, as one of the GHS_POLICIES*/
+enum GHS_OPTIONS {
+  GHS_TIMELINE = 1,
+  GHS_HISTOGRAMS = 2,
+  GHS_RECORD = 4,
+  GHS_LEAN = 8,
+  GHS_SPECULATE = 16,
+  GHS_CONTRACT = 128
+};
+
+/*Where the policy goes in the GHS_OPTIONS*/
+#define GHS_POLICY_SHIFT 5
+#define GHS_POLICY (3 << GHS_POLICY_SHIFT)
+
+/*Orders a node can handle its messages in. Messages the node can't act on yet
+are deferred in any of them, and handled again later.
+  FIFO    -> in the order they arrive. Deferred messages go back at the end of
+             the queue, and the node backs off before handling the next one
+  PRIO    -> INITIATEs first, then REPORTs, CHGROOTs, ACCEPTs and REJECTs, and
+             CONNECTs and TESTs last, which are the ones most often deferred.
+             Deferred messages are parked until the node handles some other
+             message, so it never backs off (see lanes.h)
+  ANSWERS -> same as PRIO, but with ACCEPTs and REJECTs first, so the node's
+             own search for its LWOE is over as soon as it can be
+Either way, messages from the same neighbour are handled in the order they
+arrived, deferred ones aside, as they are in FIFO*/
+enum GHS_POLICIES {
+  POLICY_FIFO = 0,
+  POLICY_PRIO,
+  POLICY_ANSWERS,
+  NUM_POLICIES
+};
+
+/*Options that change what nodes do, rather than what they measure*/
+#define GHS_VARIANTS (GHS_LEAN | GHS_SPECULATE)
+
+/*Most TESTs the speculative variant has in flight at once*/
+#define SPEC_MAX_WINDOW 16
+
+/*What the speculative variant knows about the TEST it sent on an edge:
+  state -> one of PROBE_STATES
+  level -> the node's level when it was sent. Answers to TESTs from an earlier
+           level still arrive, but only REJECTs mean anything by then*/
+struct probe {
+  uint8_t state;
+  uint8_t level;
+};
+
+/*What a node last heard about a neighbour's fragment, from the TEST and
+INITIATE messages it sent us (the only ones that carry it). Fragments only ever
+grow, until they merge into a fragment with a new ID, so a neighbour that was
+in the fragment we're in now is still in it, and the edge to it can be rejected
+without a TEST. Neighbours we know nothing about have a frag of max_key()
+  level -> the neighbour's level at the time
+  frag  -> the neighbour's fragment at the time*/
+struct neigh_frag {
+  uint8_t level;
+  struct edge_key frag;
+};
+
+/*A TEST sent on an edge is either not there (never sent, or already answered
+with a REJECT), still waiting for an answer, or answered with an ACCEPT*/
+enum PROBE_STATES {
+  PROBE_NONE = 0,
+  PROBE_SENT,
+  PROBE_ACCEPTED
 };
 
 /*Edges can be in one of three states: REJECT (not part of MSG), UNKNOWN (unde-
@@ -80,9 +219,19 @@ enum NODE_STATES {
 
 /*Entry point for the GHS algorithm. Initializes additional data structures for
 each node (edge status and whatnot), performs the level 0 behaviour, and runs
-the main loop that reacts to messages received*/
+the main loop that reacts to messages received. The node's algo_opts are the
+GHS_OPTIONS it runs with*/
 void ghs(struct node *node);
 
+/*Runs GHS on the node until it terminates, leaving the node's final state
+(edge status, parent edge and so on) in ndata. The edge status array (and the
+probes) are only freed by output(). ndata->options and ndata->replay have to be
+set by the caller. Nodes being replayed stop once they run out of recorded
+messages, and always handle them in the order they were recorded, whatever
+their policy. Messages the handlers put back in the queue are only backed off
+from here, so the time spent backing off isn't counted as handling them*/
+void find_mst(struct node *node, struct node_data *ndata);
+
 /*Processes an incoming CONNECT message, reacting appropriately depending on
 the incoming node's level, ID and whatnot*/
 void process_connect(struct node *node, struct node_data *ndata,
@@ -127,9 +276,18 @@ fragment boundaries to create new fragment.*/
 void changeroot(struct node *node, struct node_data *ndata);
 
 /*Performs each node's level 0 'wakeup' behaviour, where they find their lowest
-weight edge, and send a CONNECT message through that edge*/
+weight edge, and send a CONNECT message through that edge. Nodes that start in
+a fragment of their worker's skip that, see seed_fragment()*/
 void wakeup(struct node *node, struct node_data *data);
 
+/*Starts the node in the fragment its worker found for it: its edges in the
+fragment's tree are BRANCH already, its other edges inside the fragment REJECT,
+and if it's at either end of the core, it sends
+the other end an INITIATE for the fragment's level, named after the core, just
+as if two fragments one level below had merged over it. Both ends do, so from
+then on the fragment runs its first search for an LWOE as any other would*/
+void seed_fragment(struct node *node, struct node_data *data);
+
 /*Picks out the node's lowest cost edges which have not been rejected or inclu-
 ded in the MST yet, and queries the node on the other end to find out if the
 edge leads to outside the node's current fragment or not. Eventually either
@@ -137,6 +295,40 @@ picks the node's next candidate edge, or finds out that all of the node's edges
 have already been rejected or included in the MST.*/
 void test(struct node *node, struct node_data *ndata);
 
+/*test() for the speculative variant. Rather than testing one edge at a time,
+and waiting for each answer before moving on to the next, the node keeps TESTs
+in flight on up to window of its lightest unknown edges. The lightest edge that
+gets an ACCEPT is the node's LWOE, as soon as every lighter edge got a REJECT,
+whatever happens to the heavier ones. The window starts at a single edge, like
+textbook GHS, doubles with every REJECT, since that's when testing one edge at
+a time costs round trips, and halves whenever an LWOE is found. This is called
+again after every answer, until the LWOE is found (or there's no edge left), at
+which point test_edge becomes -1. Until then, test_edge is the lightest edge
+still unresolved.*/
+void speculate(struct node *node, struct node_data *ndata);
+
+/*Records the answer to the TEST the speculative variant sent on the given
+edge, and carries on with the search if it isn't over yet*/
+void answer_probe(struct node *node, struct node_data *ndata,
+                                      uint16_t edge_index, uint8_t accepted);
+
+/*Returns 1 if the node is waiting for the answer to a TEST it sent on the given
+edge at its current level, 0 otherwise*/
+uint8_t probing(struct node_data *ndata, uint16_t edge_index);
+
+/*Updates what the node knows about the fragment of the neighbour on the given
+edge, if the message carries it. Messages that were put back in the queue come
+around again, so older news never overwrites newer*/
+void learn_frag(struct node_data *ndata, uint16_t edge_index, uint8_t *msg);
+
+/*Returns 1 if the neighbour on the given edge is known to be in the node's own
+fragment, in which case the edge can be rejected right away, 0 otherwise*/
+uint8_t known_internal(struct node_data *ndata, uint16_t edge_index);
+
+/*Doubles the number of TESTs a speculating node keeps in flight, up to
+SPEC_MAX_WINDOW*/
+void widen_window(struct node_data *ndata);
+
 /*Reports the node's LWOE to its 'parent' in the MST, effectively ending its
 discovery phase. Now it waits to either be elected the new core, or to be sent
 into a new discovery phase, by receiving an INITIATE message from the next
@@ -145,13 +337,49 @@ void report(struct node *node, struct node_data *ndata);
 
 /*Performs a node's "final report". This means after finishing the algorithm
 execution, each node must print the weight of its BRANCH edges to the global
-log, so we can see if the algorithm did, in fact, build the MST :)*/
+log, so we can see if the algorithm did, in fact, build the MST :)
+The edges are also reported to the parent, if it is collecting results.*/
 void output (struct node *node, struct node_data *ndata);
 
+/*Reports the node's current level, state and fragment to the parent, as of
+the given PHASE_EVENTS event, if the node is keeping a timeline*/
+void record_phase(struct node *node, struct node_data *ndata, uint8_t event);
+
+/*Puts a message the node can't handle yet back in its queue, and has the main
+loop back off once the handler is done. Nodes with lanes park it instead, and
+don't back off. Replayed nodes don't put anything back, since their recording
+already says when the message was dequeued again*/
+void defer(struct node *node, struct node_data *ndata, uint8_t *msg,
+                                                                uint32_t len);
+
+/*Sends the node's non-empty histograms to the parent, one record each, and
+frees them. Does nothing if the node doesn't keep histograms*/
+void dump_histograms(struct node *node, struct node_data *ndata);
+
 /*Creates a message of the specified type, placing its content in the buffer
-provided in the input. Returns the length of the created message, in bytes.
-Returns 0 if message creation failed.*/
-uint8_t create_msg(uint8_t type, uint16_t weight, uint8_t level, uint16_t frag,
-                                                uint8_t state, uint8_t *buffer);
+provided in the input. The sender's ID goes in every message, so the receiver
+knows which edge it came through. Returns the length of the created message, in
+bytes. Returns 0 if message creation failed.*/
+uint8_t create_msg(uint8_t type, uint16_t sender, uint8_t level,
+                  struct edge_key frag, uint8_t state, uint8_t *buffer);
+
+/*Returns the key of the edge between nodes a and b, with the given weight*/
+struct edge_key make_key(weight_t weight, uint8_t a, uint8_t b);
+
+/*Returns the key that is heavier than every edge's, meaning "no edge"*/
+struct edge_key max_key();
+
+/*Compares two edge keys, returning a negative number if k1 is lighter, a
+positive one if it's heavier, and 0 if they are the same edge*/
+int8_t compare_keys(struct edge_key k1, struct edge_key k2);
+
+/*Returns the key of the edge an incoming message arrived on*/
+struct edge_key incoming_key(struct node *node, uint8_t *msg);
+
+/*Writes an edge key into a message buffer, returning its length*/
+uint8_t put_key(uint8_t *buffer, struct edge_key key);
+
+/*Reads an edge key from a message buffer*/
+struct edge_key get_key(uint8_t *buffer);
 
 #endif /* ALGORITHM_H */
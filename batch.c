@@ -0,0 +1,284 @@
+#include "batch.h"
+
+uint8_t read_graph(FILE *stream, struct batch_graph *batch, uint32_t *index) {
+  struct ghs_graph *graph = &batch->graph;
+  char line[128], token[32];
+  int32_t n, m, u, v, i;
+  weight_t w;
+  const char *reason;
+
+  while (1) {
+    /*skip to the next graph's header*/
+    do {
+      if (fgets(line, sizeof(line), stream) == NULL) {
+        return 0;
+      }
+    } while (line[0] == '#' || line[0] == '\n');
+    if (sscanf(line, "%d %d", &n, &m) != 2 || n < 0 || m < 0) {
+      fprintf(stderr, "Malformed graph header: %s", line);
+      return 0;
+    }
+
+    batch->index = (*index)++;
+    graph->num_nodes = n;
+    graph->num_edges = 0;
+    reason = NULL;
+    for (i = 0; i < m; i++) {
+      do {
+        if (fgets(line, sizeof(line), stream) == NULL) {
+          fprintf(stderr, "Graph %u ends too soon!\n", batch->index);
+          return 0;
+        }
+      } while (line[0] == '#' || line[0] == '\n');
+      if (sscanf(line, "%d %d %31s", &u, &v, token) != 3) {
+        fprintf(stderr, "Malformed edge in graph %u: %s", batch->index, line);
+        return 0;
+      }
+
+      /*keep reading the rest of a bad graph, so we can skip it*/
+      if (u < 0 || v < 0 || !parse_weight(token, &w) ||
+                                              !ghs_add_edge(graph, u, v, w)) {
+        reason = "bad edge";
+      }
+    }
+
+    /*GHS needs a graph without repeated edges, anything else would just leave
+    a worker hanging. Repeated weights are fine, ties are broken by the
+    endpoints' IDs, and so are graphs in pieces, which get a spanning forest*/
+    if (reason == NULL && (reason = ghs_check_graph(graph)) == NULL) {
+      return 1;
+    }
+    fprintf(stderr, "Skipping graph %u: %s!\n", batch->index, reason);
+  }
+}
+
+uint8_t run_batch(FILE *stream, uint8_t workers, char *outfile, uint8_t binary,
+                                                              FILE *globallog) {
+  struct batch_graph batch;
+  struct batch_reply reply;
+  struct ghs_edge *edges = NULL;
+  struct pollfd fds[workers];
+  int32_t socks[workers], fd_pair[2];
+  uint8_t busy[workers], dead[workers], more = 1, ret = 1;
+  uint32_t index = 0, graphs = 0, failed = 0, outstanding = 0;
+  char logmsg[60];
+  FILE *out = NULL;
+  int32_t k, j, pid = -1;
+
+  /*fork the pool, each worker gets a stream socket for graphs and results*/
+  for (k = 0; k < workers; k++) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd_pair) == -1) {
+      fprintf(stderr, "Error when creating socket pair!\n");
+      workers = k;
+      ret = 0;
+      break;
+    }
+    if ((pid = fork()) == 0) {
+      /*the other workers' sockets are none of our business*/
+      for (j = 0; j < k; j++) {
+        close(socks[j]);
+      }
+      close(fd_pair[0]);
+      ret = run_batch_worker(fd_pair[1]);
+      close(fd_pair[1]);
+      break;
+    }
+    close(fd_pair[1]);
+    socks[k] = fd_pair[0];
+    fds[k].fd = fd_pair[0];
+    fds[k].events = POLLIN;
+    busy[k] = 0;
+    dead[k] = 0;
+  }
+  if (pid == 0) {
+    return ret;
+  }
+
+  /*only open the output now, so the workers don't inherit any of it*/
+  if (outfile != NULL && (out = fopen(outfile, binary ? "wb" : "w")) == NULL) {
+    fprintf(stderr, "Could not open %s for writing!\n", outfile);
+    ret = 0;
+  }
+  if (out != NULL && !binary) {
+    fprintf(out, "graph,u,v,weight\n");
+  }
+
+  /*keep every worker busy, handing out the next graph as soon as one is done.
+  Graphs that were read but never answered, because their worker died, count as
+  failed, and dead workers don't get any more of them*/
+  memset(&batch, 0, sizeof(batch));
+  double start = mono_time();
+  while (1) {
+    for (k = 0; k < workers && more; k++) {
+      if (busy[k] || dead[k] || !(more = read_graph(stream, &batch, &index))) {
+        continue;
+      }
+      if (!send_graph(socks[k], &batch)) {
+        fprintf(stderr, "Worker %d died!\n", k);
+        dead[k] = 1;
+        failed++;
+        ret = 0;
+        continue;
+      }
+      busy[k] = 1;
+      outstanding++;
+    }
+    if (outstanding == 0) {
+      break;
+    }
+
+    for (k = 0; k < workers; k++) {
+      fds[k].events = busy[k] ? POLLIN : 0;
+    }
+    if (poll(fds, workers, -1) < 0) {
+      fprintf(stderr, "Lost track of the workers!\n");
+      failed += outstanding;
+      ret = 0;
+      break;
+    }
+
+    for (k = 0; k < workers; k++) {
+      if (!busy[k] || !(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) {
+        continue;
+      }
+
+      busy[k] = 0;
+      outstanding--;
+      if (!read_full(socks[k], &reply, sizeof(reply))) {
+        fprintf(stderr, "Worker %d died!\n", k);
+        dead[k] = 1;
+        failed++;
+        ret = 0;
+        continue;
+      }
+      edges = realloc(edges, (reply.num_edges + 1)*sizeof(struct ghs_edge));
+      if (!read_full(socks[k], edges, reply.num_edges*sizeof(struct ghs_edge))) {
+        fprintf(stderr, "Worker %d died!\n", k);
+        dead[k] = 1;
+        failed++;
+        ret = 0;
+        continue;
+      }
+
+      /*a spanning tree has exactly n-1 edges, and both ends agree on all of
+      them. A forest has one edge less per tree*/
+      graphs++;
+      if (reply.mismatched ||
+                          reply.num_edges + reply.trees != reply.num_nodes) {
+        fprintf(stderr, "WARNING: graph %u has %u MST edges for %u nodes, %u "
+                        "reported by a single endpoint!\n", reply.index,
+                        reply.num_edges, reply.num_nodes, reply.mismatched);
+        failed++;
+      }
+      if (out != NULL) {
+        write_batch_mst(out, binary, &reply, edges);
+      }
+    }
+  }
+  double secs = mono_time() - start;
+
+  /*out of graphs, let the workers go*/
+  for (k = 0; k < workers; k++) {
+    shutdown(socks[k], SHUT_WR);
+  }
+  int32_t status = 0;
+  while (wait(&status) > 0) {}
+  for (k = 0; k < workers; k++) {
+    close(socks[k]);
+  }
+
+  snprintf(logmsg, 60, "%u graphs in %.3fs (%.1f graphs/s)", graphs, secs,
+                                                secs > 0 ? graphs / secs : 0.0);
+  log_msg(logmsg, globallog);
+  printf("Batch: %s, %d workers, %u failed\n", logmsg, workers, failed);
+
+  if (out != NULL) {
+    fclose(out);
+  }
+  free(batch.graph.edges);
+  free(edges);
+  return ret && !failed;
+}
+
+uint8_t run_batch_worker(int32_t sock) {
+  struct ghs_runner *runner;
+  struct batch_graph batch;
+  struct batch_reply reply;
+  struct ghs_mst mst;
+  uint32_t header[3];
+
+  if ((runner = ghs_init_runner()) == NULL) {
+    fprintf(stderr, "Could not set up a batch worker!\n");
+    return 0;
+  }
+
+  memset(&batch, 0, sizeof(batch));
+  while (read_full(sock, header, sizeof(header))) {
+    batch.index = header[0];
+    batch.graph.num_nodes = header[1];
+    batch.graph.num_edges = header[2];
+    if (batch.graph.num_edges > batch.graph.max_edges) {
+      batch.graph.max_edges = batch.graph.num_edges;
+      batch.graph.edges = realloc(batch.graph.edges,
+                          batch.graph.max_edges*sizeof(struct ghs_edge));
+    }
+    if (!read_full(sock, batch.graph.edges,
+                          batch.graph.num_edges*sizeof(struct ghs_edge))) {
+      break;
+    }
+
+    /*the parent only sends graphs that passed ghs_check_graph*/
+    if (!ghs_run(runner, &batch.graph, NULL, &mst)) {
+      break;
+    }
+
+    reply.index = batch.index;
+    reply.num_nodes = mst.num_nodes;
+    reply.trees = mst.trees;
+    reply.num_edges = mst.num_edges;
+    reply.done = mst.done;
+    reply.mismatched = mst.mismatched;
+    reply.total = mst.total;
+    reply.secs = mst.secs;
+    if (!write_full(sock, &reply, sizeof(reply)) || !write_full(sock,
+                      mst.edges, mst.num_edges*sizeof(struct ghs_edge))) {
+      ghs_free_mst(&mst);
+      break;
+    }
+    ghs_free_mst(&mst);
+  }
+
+  ghs_free_runner(runner);
+  free(batch.graph.edges);
+  return 1;
+}
+
+uint8_t send_graph(int32_t sock, struct batch_graph *batch) {
+  uint32_t header[3] = {batch->index, batch->graph.num_nodes,
+                                                    batch->graph.num_edges};
+
+  return write_full(sock, header, sizeof(header)) &&
+         write_full(sock, batch->graph.edges,
+                    batch->graph.num_edges*sizeof(struct ghs_edge));
+}
+
+void write_batch_mst(FILE *out, uint8_t binary, struct batch_reply *reply,
+                                                      struct ghs_edge *edges) {
+  uint32_t i;
+
+  if (binary) {
+    fwrite(&reply->index, sizeof(uint32_t), 1, out);
+    fwrite(&reply->num_edges, sizeof(uint32_t), 1, out);
+    for (i = 0; i < reply->num_edges; i++) {
+      fwrite(&edges[i].u, sizeof(uint32_t), 1, out);
+      fwrite(&edges[i].v, sizeof(uint32_t), 1, out);
+      fwrite(&edges[i].weight, sizeof(weight_t), 1, out);
+    }
+    return;
+  }
+
+  for (i = 0; i < reply->num_edges; i++) {
+    fprintf(out, "%u,%u,%u,%" PRIweight "\n", reply->index, edges[i].u,
+                                                edges[i].v, edges[i].weight);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/*This file implements the batch mode, for computing the MSTs of many (usually
+small) graphs in a row. Setting up a network from scratch for every graph means
+creating every channel and forking every node, which takes far longer than GHS
+itself on a small graph. Instead, the parent forks a pool of worker processes
+once, and hands each of them a graph at a time, as soon as it's done with the
+previous one. Each worker hosts a whole graph, with every node running in a
+thread, like a partitioned worker that has the network all to itself. Workers
+hold on to their nodes, message queues and results pipe, which are simply reset
+for every graph. Nodes in batch mode don't log anything, and don't add any
+artificial delays, since all we care about here is throughput.
+
+Workers run their graphs through libghs, each of them with a runner of its own.
+
+Graphs are read from a text stream, as the number of nodes and edges on a line,
+followed by a "u v weight" line for each edge. Lines starting with '#' are
+ignored.*/
+
+#include <stdio.h>      /*reading graphs and writing MSTs*/
+#include <stdint.h>     /*sized integers for the wire format*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*memsets*/
+#include <unistd.h>     /*forks, pipes and reads*/
+#include <poll.h>       /*the parent waits on every worker at once*/
+#include <sys/wait.h>   /*reaping the pool*/
+#include <sys/socket.h> /*talking to the pool*/
+
+#include "libghs.h"     /*workers run graphs as a library user would*/
+#include "results.h"    /*reading and writing the wire format*/
+#include "node.h"       /*logging what the pool is up to*/
+
+/*A graph, as read from the input and sent to the workers.
+  index -> position of the graph in the input, starting from 0
+  graph -> the graph itself*/
+struct batch_graph {
+  uint32_t index;
+  struct ghs_graph graph;
+};
+
+/*Header of the summary a worker sends back for each graph, followed by the
+MST edges themselves*/
+struct batch_reply {
+  uint32_t index;
+  uint32_t num_nodes;
+  uint32_t trees;
+  uint32_t num_edges;
+  uint32_t done;
+  uint32_t mismatched;
+  weight_sum_t total;
+  double secs;
+};
+
+/*Reads the next graph from the given stream. Graphs GHS can't handle (too
+large, or with repeated edges) are skipped with a warning, but
+still take up an index. Returns 1 if a graph was read, 0 at the end of the
+stream or on a malformed graph*/
+uint8_t read_graph(FILE *stream, struct batch_graph *batch, uint32_t *index);
+
+/*Runs the batch mode: forks the given number of workers, feeds them the graphs
+in the given stream, and reports how many graphs per second they got through.
+The MST of each graph is written to outfile, if one is given, either as CSV
+("graph,u,v,weight" lines) or as binary (the graph's index and number of edges,
+followed by u, v and weight for each edge, the IDs as native 32-bit integers and
+the weight as a native weight_t).
+Returns 1 on success, 0 otherwise*/
+uint8_t run_batch(FILE *stream, uint8_t workers, char *outfile, uint8_t binary,
+                                                              FILE *globallog);
+
+/*Runs a single worker of the pool, computing the MST of every graph that
+arrives on the given socket and sending the results back through it, until the
+parent closes it. Returns 1 on success, 0 otherwise*/
+uint8_t run_batch_worker(int32_t sock);
+
+/*Sends a graph to a worker through the given socket. Returns 0 on failure*/
+uint8_t send_graph(int32_t sock, struct batch_graph *batch);
+
+/*Writes the MST of a single graph to the output file*/
+void write_batch_mst(FILE *out, uint8_t binary, struct batch_reply *reply,
+                                                      struct ghs_edge *edges);
+
+#endif /* BATCH_H */
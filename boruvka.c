@@ -0,0 +1,602 @@
+#include "boruvka.h"
+
+struct boruvka *init_boruvka(struct bsp_engine *engine, int32_t results,
+                                                              FILE *globallog) {
+  struct boruvka *bor;
+  uint32_t i;
+
+  bor = malloc(sizeof(struct boruvka));
+  bor->vertices = malloc(engine->num_vertices*sizeof(struct boruvka_vertex));
+  bor->results = results;
+  bor->globallog = globallog;
+
+  /*every vertex starts out as a fragment of its own*/
+  for (i = 0; i < engine->num_vertices; i++) {
+    struct boruvka_vertex *vtx = &bor->vertices[i];
+    vtx->stage = BOR_ANNOUNCE;
+    vtx->frag = i;
+    vtx->phases = 0;
+    vtx->edge_status = calloc(engine->offsets[i + 1] - engine->offsets[i] + 1,
+                                                              sizeof(uint8_t));
+    vtx->best = max_key();
+    vtx->own_best = max_key();
+    vtx->own_edge = -1;
+    vtx->join_edge = -1;
+  }
+
+  return bor;
+}
+
+void boruvka_step(struct bsp_thread *thread, uint32_t vertex,
+                                      struct bsp_msg *msgs, uint32_t num_msgs) {
+  struct bsp_engine *engine = thread->engine;
+  struct boruvka *bor = (struct boruvka*) engine->algo;
+  struct boruvka_vertex *vtx = &bor->vertices[vertex];
+  struct node_edge *edges = &engine->adj[engine->offsets[vertex]];
+  uint8_t outmsg[BSP_MAX_MSG];
+  int32_t from = -1;
+  uint32_t i;
+
+  switch (vtx->stage) {
+    case BOR_CHOOSE: {
+      /*every BASIC neighbour told us its fragment, so we know which of them
+      are outgoing, and which never will be again*/
+      vtx->own_best = max_key();
+      vtx->own_edge = -1;
+      for (i = 0; i < num_msgs; i++) {
+        uint32_t e = msgs[i].edge;
+        if (msgs[i].data[1] == vtx->frag) {
+          vtx->edge_status[e] = BOR_EDGE_INTERNAL;
+          continue;
+        }
+        struct edge_key key = make_key(edges[e].weight, vertex, edges[e].neigh);
+        if (compare_keys(key, vtx->own_best) < 0) {
+          vtx->own_best = key;
+          vtx->own_edge = e;
+        }
+      }
+
+      /*vertices without an outgoing edge have nothing to tell the others*/
+      vtx->best = vtx->own_best;
+      if (vtx->own_edge != -1) {
+        outmsg[0] = BOR_MIN;
+        uint8_t len = 1 + put_key(outmsg + 1, vtx->best);
+        boruvka_flood(thread, vertex, BOR_EDGE_BRANCH, -1, outmsg, len);
+      }
+      vtx->stage = BOR_MIN_FLOOD;
+      break;
+    }
+    case BOR_MIN_FLOOD: {
+      /*a round with no messages anywhere means every fragment's minimum has
+      reached all of its vertices*/
+      if (engine->delivered == 0) {
+        if (compare_keys(vtx->best, max_key()) == 0) {
+          boruvka_finish(thread, vertex);
+          break;
+        }
+
+        /*only the owner of the minimum does anything about it*/
+        vtx->join_edge = -1;
+        if (vtx->own_edge != -1 && compare_keys(vtx->best, vtx->own_best) == 0) {
+          vtx->join_edge = vtx->own_edge;
+          vtx->edge_status[vtx->join_edge] = BOR_EDGE_BRANCH;
+          outmsg[0] = BOR_JOIN;
+          outmsg[1] = vtx->frag;
+          bsp_send(thread, vertex, vtx->join_edge, outmsg, 2);
+        }
+        vtx->stage = BOR_MERGE;
+        break;
+      }
+
+      /*otherwise pass on anything lighter than what we knew of*/
+      for (i = 0; i < num_msgs; i++) {
+        struct edge_key key = get_key(msgs[i].data + 1);
+        if (compare_keys(key, vtx->best) < 0) {
+          vtx->best = key;
+          from = msgs[i].edge;
+        }
+      }
+      if (from != -1) {
+        outmsg[0] = BOR_MIN;
+        uint8_t len = 1 + put_key(outmsg + 1, vtx->best);
+        boruvka_flood(thread, vertex, BOR_EDGE_BRANCH, from, outmsg, len);
+      }
+      break;
+    }
+    case BOR_MERGE: {
+      /*once the new names stop spreading, the phase is over*/
+      if (engine->delivered == 0) {
+        vtx->phases++;
+        boruvka_announce(thread, vertex);
+        break;
+      }
+
+      /*JOINs make new BRANCH edges, and bring the name of the fragment on the
+      other end, which is just as good as an ID*/
+      uint8_t old_frag = vtx->frag;
+      for (i = 0; i < num_msgs; i++) {
+        if (msgs[i].data[0] == BOR_JOIN) {
+          vtx->edge_status[msgs[i].edge] = BOR_EDGE_BRANCH;
+        }
+        if (msgs[i].data[1] < vtx->frag) {
+          vtx->frag = msgs[i].data[1];
+          from = msgs[i].edge;
+        }
+      }
+
+      /*a lower name goes everywhere in the fragment but where it came from. If
+      ours is still the lowest, only those who JOINed us with a higher name
+      need to hear it, unless they'd already heard it from us*/
+      outmsg[0] = BOR_ID;
+      outmsg[1] = vtx->frag;
+      if (vtx->frag != old_frag) {
+        boruvka_flood(thread, vertex, BOR_EDGE_BRANCH, from, outmsg, 2);
+        break;
+      }
+      for (i = 0; i < num_msgs; i++) {
+        if (msgs[i].data[0] == BOR_JOIN && msgs[i].data[1] > vtx->frag &&
+                                (int32_t) msgs[i].edge != vtx->join_edge) {
+          bsp_send(thread, vertex, msgs[i].edge, outmsg, 2);
+        }
+      }
+      break;
+    }
+    case BOR_DONE: {
+      /*nobody talks to a finished component*/
+      bsp_halt(thread, vertex);
+      break;
+    }
+    case BOR_ANNOUNCE: {
+      boruvka_announce(thread, vertex);
+      break;
+    }
+  }
+}
+
+void boruvka_announce(struct bsp_thread *thread, uint32_t vertex) {
+  struct bsp_engine *engine = thread->engine;
+  struct boruvka *bor = (struct boruvka*) engine->algo;
+  uint8_t msg[2] = {BOR_FRAG, bor->vertices[vertex].frag};
+
+  /*tell every neighbour that may still be outside our fragment who we are*/
+  boruvka_flood(thread, vertex, BOR_EDGE_BASIC, -1, msg, 2);
+  bor->vertices[vertex].stage = BOR_CHOOSE;
+
+  /*with nothing to announce to, the vertex is alone in the graph*/
+  if (engine->offsets[vertex + 1] == engine->offsets[vertex]) {
+    boruvka_finish(thread, vertex);
+  }
+}
+
+void boruvka_flood(struct bsp_thread *thread, uint32_t vertex, uint8_t status,
+                                  int32_t skip, uint8_t *msg, uint32_t len) {
+  struct bsp_engine *engine = thread->engine;
+  struct boruvka *bor = (struct boruvka*) engine->algo;
+  uint8_t *edge_status = bor->vertices[vertex].edge_status;
+  uint32_t num_edges = engine->offsets[vertex + 1] - engine->offsets[vertex];
+  uint32_t i;
+
+  for (i = 0; i < num_edges; i++) {
+    if (edge_status[i] == status && (int32_t) i != skip) {
+      bsp_send(thread, vertex, i, msg, len);
+    }
+  }
+}
+
+void boruvka_finish(struct bsp_thread *thread, uint32_t vertex) {
+  struct bsp_engine *engine = thread->engine;
+  struct boruvka *bor = (struct boruvka*) engine->algo;
+  struct boruvka_vertex *vtx = &bor->vertices[vertex];
+  struct node_edge *edges = &engine->adj[engine->offsets[vertex]];
+  uint32_t num_edges = engine->offsets[vertex + 1] - engine->offsets[vertex];
+  struct result_edge edge;
+  char logmsg[60];
+  uint32_t i;
+
+  for (i = 0; i < num_edges; i++) {
+    if (vtx->edge_status[i] == BOR_EDGE_BRANCH) {
+      edge.neigh = edges[i].neigh;
+      edge.weight = edges[i].weight;
+      write_result(bor->results, RESULT_EDGE, vertex, &edge, sizeof(edge));
+    }
+  }
+  write_result(bor->results, RESULT_DONE, vertex, NULL, 0);
+
+  snprintf(logmsg, 60, "Vertex %u is done after %u phases!", vertex,
+                                                                vtx->phases);
+  log_msg(logmsg, bor->globallog);
+  vtx->stage = BOR_DONE;
+  bsp_halt(thread, vertex);
+}
+
+void free_boruvka(struct boruvka *bor, struct bsp_engine *engine) {
+  uint32_t i;
+
+  for (i = 0; i < engine->num_vertices; i++) {
+    free(bor->vertices[i].edge_status);
+  }
+  free(bor->vertices);
+  free(bor);
+}
+
+void boruvka(struct node *node) {
+  struct boruvka_node bdata;
+  uint8_t inmsg[50], outmsg[50];
+  uint64_t stamp;
+  char logmsg[60];
+  uint16_t i;
+
+  print_edges(node->neighs, node->log);
+
+  /*every node starts out as a fragment of its own at phase 0, whose lightest
+  outgoing edge is simply its lightest edge*/
+  bdata.state = NODE_FOUND;
+  bdata.phase = 0;
+  bdata.fcount = 0;
+  bdata.searching = 0;
+  bdata.done = 0;
+  bdata.frag = make_key(0, node->id, node->id);
+  for (i = 0; i < BOR_MAX_PHASES; i++) {
+    bdata.frags[i] = max_key();
+  }
+  bdata.frags[0] = bdata.frag;
+  bdata.num_neighs = node->neighs->num;
+  bdata.edge_status = malloc(bdata.num_neighs*sizeof(uint8_t));
+  memset(bdata.edge_status, EDGE_UNKNOWN, bdata.num_neighs);
+  init_edge_arrays(&bdata.arrays, node->neighs);
+  bdata.neigh_frags = malloc(bdata.num_neighs*sizeof(struct neigh_frag));
+  for (i = 0; i < bdata.num_neighs; i++) {
+    bdata.neigh_frags[i].level = 0;
+    bdata.neigh_frags[i].frag = max_key();
+  }
+  bdata.in_branch = -1;
+  bdata.branch_sock = 0;
+  bdata.best_edge = 0;
+  bdata.best_key = max_key();
+  bdata.best_sock = 0;
+  bdata.deferred = 0;
+
+  /*a node with no neighbours is a whole tree already*/
+  if (bdata.num_neighs == 0) {
+    bdata.done = 1;
+  }
+  else {
+    bdata.best_sock = node->neighs->head->sock;
+    bdata.edge_status[0] = EDGE_BRANCH;
+    uint8_t len = create_msg(MSG_CONNECT, node->id, 0, max_key(), 0, outmsg);
+    send_msg(node, node->neighs->head->sock, outmsg, len);
+    snprintf(logmsg, 60, "Sending CONNECT with phase 0 to lowest edge!");
+    log_msg(logmsg, node->log);
+  }
+
+  while (!bdata.done) {
+    wait_queue(node->queue);
+    memset(inmsg, 0, 50);
+    dequeue(node->queue, inmsg, &stamp);
+
+    /*edges are identified by the sender's ID, as in GHS*/
+    struct edge *link = node->neighs->head;
+    uint16_t sender = (inmsg[1] << 8) | inmsg[2];
+    uint32_t sock = 0;
+    for (i = 0; i < bdata.num_neighs; i++, link = link->next) {
+      if (link->neigh == sender) {
+        sock = link->sock;
+        break;
+      }
+    }
+    if (i == bdata.num_neighs) {
+      fprintf(stderr, "Node %d got a message from a stranger!\n", node->id);
+      continue;
+    }
+
+    switch (inmsg[0]) {
+      case MSG_CONNECT: {
+        bor_connect(node, &bdata, i, sock, inmsg);
+        break;
+      }
+      case MSG_INITIATE: {
+        bor_initiate(node, &bdata, i, sock, inmsg);
+        break;
+      }
+      case MSG_TEST: {
+        bor_test(node, &bdata, i, inmsg);
+        break;
+      }
+      case MSG_REPORT: {
+        bor_report(node, &bdata, i, sock, inmsg);
+        break;
+      }
+      case MSG_CHGROOT: {
+        bor_changeroot(node, &bdata);
+        break;
+      }
+      default: {
+        fprintf(stderr, "Invalid message type at arrival!\n");
+        break;
+      }
+    }
+
+    /*same as GHS, give whoever we're waiting for a chance to run*/
+    if (bdata.deferred) {
+      bdata.deferred = 0;
+      backoff(node);
+    }
+  }
+
+  bor_output(node, &bdata);
+}
+
+void bor_connect(struct node *node, struct boruvka_node *bdata,
+                        uint16_t edge_index, uint32_t edge_sock, uint8_t *msg) {
+  uint8_t inphase = msg[3], outmsg[50], len;
+  char logmsg[60];
+
+  snprintf(logmsg, 60, "Received CONNECT with phase %d", inphase);
+  log_msg(logmsg, node->log);
+
+  /*a fragment behind us joins whatever we're doing*/
+  if (inphase < bdata->phase) {
+    bdata->edge_status[edge_index] = EDGE_BRANCH;
+    len = create_msg(MSG_INITIATE, node->id, bdata->phase, bdata->frag,
+                                                        bdata->state, outmsg);
+    send_msg(node, edge_sock, outmsg, len);
+    if (bdata->state == NODE_FIND) {
+      bdata->fcount++;
+    }
+    snprintf(logmsg, 60, "Absorbing fragment from phase %d!", inphase);
+    log_msg(logmsg, node->log);
+
+    /*our search may well have been waiting on them to catch up*/
+    if (bdata->searching) {
+      bor_search(node, bdata);
+    }
+  }
+
+  /*both fragments picked this edge, the endpoint with the highest ID takes
+  the merged fragment into the next phase*/
+  else if (bdata->edge_status[edge_index] == EDGE_BRANCH) {
+    if (node->id > ((msg[1] << 8) | msg[2])) {
+      struct edge_key core = incoming_key(node, msg);
+      snprintf(logmsg, 60, "Merging, starting phase %d!", bdata->phase + 1);
+      log_msg(logmsg, node->log);
+      bor_enter(node, bdata, bdata->phase + 1, core, NODE_FIND, -1, 0);
+    }
+  }
+
+  /*someone at our phase picked us, but we picked someone else: they'll be
+  absorbed once we're done merging*/
+  else {
+    snprintf(logmsg, 60, "Cannot respond yet, delaying CONNECT!");
+    log_msg(logmsg, node->log);
+    enqueue(node->queue, msg, 4);
+    bdata->deferred = 1;
+  }
+}
+
+void bor_initiate(struct node *node, struct boruvka_node *bdata,
+                        uint16_t edge_index, uint32_t edge_sock, uint8_t *msg) {
+  uint8_t inphase = msg[3], instate = msg[4];
+  struct edge_key infrag = get_key(&msg[5]);
+
+  bor_enter(node, bdata, inphase, infrag, instate, edge_index, edge_sock);
+}
+
+void bor_test(struct node *node, struct boruvka_node *bdata,
+                                            uint16_t edge_index, uint8_t *msg) {
+  struct neigh_frag *known = &bdata->neigh_frags[edge_index];
+  uint8_t inphase = msg[3];
+
+  /*phases only go up, but TESTs may still arrive out of order*/
+  if (inphase >= known->level) {
+    known->level = inphase;
+    known->frag = get_key(&msg[4]);
+  }
+
+  /*a neighbour that was ever in our fragment may have stopped looking before
+  it got to this edge, and won't TEST it again. So we find out here, rather
+  than when our search gets to it*/
+  if (bdata->edge_status[edge_index] == EDGE_UNKNOWN &&
+                                            bor_internal(bdata, edge_index)) {
+    bdata->edge_status[edge_index] = EDGE_REJECT;
+  }
+
+  if (bdata->searching) {
+    bor_search(node, bdata);
+  }
+}
+
+void bor_report(struct node *node, struct boruvka_node *bdata,
+                        uint16_t edge_index, uint32_t edge_sock, uint8_t *msg) {
+  struct edge_key reported = get_key(&msg[3]);
+  char logmsg[60];
+
+  /*roots never REPORT to their children, unless it's all over*/
+  if (edge_index == bdata->in_branch) {
+    bor_finish(node, bdata);
+    return;
+  }
+
+  snprintf(logmsg, 60, "Received REPORT with LWOE cost %" PRIweight,
+                                                              reported.weight);
+  log_msg(logmsg, node->log);
+  bdata->fcount--;
+  if (compare_keys(reported, bdata->best_key) < 0) {
+    bdata->best_key = reported;
+    bdata->best_edge = edge_index;
+    bdata->best_sock = edge_sock;
+  }
+  bor_report_up(node, bdata);
+}
+
+void bor_enter(struct node *node, struct boruvka_node *bdata, uint8_t phase,
+      struct edge_key frag, uint8_t state, int16_t from, uint32_t from_sock) {
+  uint8_t outmsg[50], len;
+  char logmsg[60];
+  uint16_t i;
+
+  bdata->phase = phase;
+  bdata->frag = frag;
+  bdata->frags[phase] = frag;
+  bdata->state = state;
+  bdata->in_branch = from;
+  bdata->branch_sock = from_sock;
+  bdata->best_edge = -1;
+  bdata->best_key = max_key();
+  if (from != -1) {
+    bdata->edge_status[from] = EDGE_BRANCH;
+  }
+
+  snprintf(logmsg, 60, "Node %d: ADVANCING to phase %d, F: %" PRIweight "!",
+                                                node->id, phase, frag.weight);
+  log_msg(logmsg, node->globallog);
+
+  /*the rest of the fragment follows us into the phase, and TESTs go out to
+  everyone who may be outside of it. Neighbours waiting on our phase need our
+  TEST even when we're not searching ourselves, and even when we already know
+  they're in our fragment, since they may not know it yet*/
+  struct edge *link = node->neighs->head;
+  len = create_msg(MSG_INITIATE, node->id, phase, frag, state, outmsg);
+  for (i = 0; i < bdata->num_neighs; i++, link = link->next) {
+    if (bdata->edge_status[i] == EDGE_BRANCH && i != from) {
+      send_msg(node, link->sock, outmsg, len);
+      if (state == NODE_FIND) {
+        bdata->fcount++;
+      }
+    }
+  }
+  link = node->neighs->head;
+  len = create_msg(MSG_TEST, node->id, phase, frag, 0, outmsg);
+  for (i = 0; i < bdata->num_neighs; i++, link = link->next) {
+    if (bdata->edge_status[i] == EDGE_UNKNOWN) {
+      send_msg(node, link->sock, outmsg, len);
+    }
+  }
+
+  if (state == NODE_FIND) {
+    bdata->searching = 1;
+    bor_search(node, bdata);
+  }
+}
+
+void bor_search(struct node *node, struct boruvka_node *bdata) {
+  struct edge_arrays *arrays = &bdata->arrays;
+  struct neigh_frag *known;
+  char logmsg[60];
+  int32_t i;
+
+  while ((i = lightest_edge(arrays->weights, bdata->edge_status,
+                                bdata->num_neighs, EDGE_UNKNOWN)) != -1) {
+    /*in our fragment, and there to stay*/
+    if (bor_internal(bdata, i)) {
+      bdata->edge_status[i] = EDGE_REJECT;
+      continue;
+    }
+
+    /*can't tell yet, and heavier edges don't matter until we can*/
+    known = &bdata->neigh_frags[i];
+    if (known->level < bdata->phase) {
+      return;
+    }
+
+    /*outside, so this is our lightest outgoing edge*/
+    struct edge_key key = make_key(arrays->weights[i], node->id,
+                                                            arrays->neighs[i]);
+    snprintf(logmsg, 60, "My LWOE has weight %" PRIweight, arrays->weights[i]);
+    log_msg(logmsg, node->log);
+    if (compare_keys(key, bdata->best_key) < 0) {
+      bdata->best_key = key;
+      bdata->best_edge = i;
+      bdata->best_sock = arrays->socks[i];
+    }
+    break;
+  }
+
+  bdata->searching = 0;
+  bor_report_up(node, bdata);
+}
+
+uint8_t bor_internal(struct boruvka_node *bdata, uint16_t edge_index) {
+  struct neigh_frag *known = &bdata->neigh_frags[edge_index];
+
+  return known->level <= bdata->phase &&
+                  compare_keys(known->frag, bdata->frags[known->level]) == 0;
+}
+
+void bor_report_up(struct node *node, struct boruvka_node *bdata) {
+  uint8_t outmsg[50], len;
+  char logmsg[60];
+
+  if (bdata->fcount > 0 || bdata->searching || bdata->state != NODE_FIND) {
+    return;
+  }
+  bdata->state = NODE_FOUND;
+
+  if (bdata->in_branch != -1) {
+    len = create_msg(MSG_REPORT, node->id, 0, bdata->best_key, 0, outmsg);
+    send_msg(node, bdata->branch_sock, outmsg, len);
+    return;
+  }
+
+  /*the root decides: nothing outgoing means the fragment is the whole MST*/
+  if (compare_keys(bdata->best_key, max_key()) == 0) {
+    snprintf(logmsg, 60, "Node %d: no outgoing edges left, done!", node->id);
+    log_msg(logmsg, node->globallog);
+    bor_finish(node, bdata);
+  }
+  else {
+    bor_changeroot(node, bdata);
+  }
+}
+
+void bor_changeroot(struct node *node, struct boruvka_node *bdata) {
+  uint8_t outmsg[50], len;
+  char logmsg[60];
+
+  if (bdata->edge_status[bdata->best_edge] == EDGE_BRANCH) {
+    len = create_msg(MSG_CHGROOT, node->id, 0, max_key(), 0, outmsg);
+    send_msg(node, bdata->best_sock, outmsg, len);
+  }
+  else {
+    snprintf(logmsg, 60, "Sending CONNECT message with phase %d!",
+                                                                bdata->phase);
+    log_msg(logmsg, node->log);
+    len = create_msg(MSG_CONNECT, node->id, bdata->phase, max_key(), 0, outmsg);
+    send_msg(node, bdata->best_sock, outmsg, len);
+    bdata->edge_status[bdata->best_edge] = EDGE_BRANCH;
+  }
+}
+
+void bor_finish(struct node *node, struct boruvka_node *bdata) {
+  uint8_t outmsg[50], len;
+  struct edge *link = node->neighs->head;
+  uint16_t i;
+
+  len = create_msg(MSG_REPORT, node->id, 0, max_key(), 0, outmsg);
+  for (i = 0; i < bdata->num_neighs; i++, link = link->next) {
+    if (bdata->edge_status[i] == EDGE_BRANCH && i != bdata->in_branch) {
+      send_msg(node, link->sock, outmsg, len);
+    }
+  }
+  bdata->done = 1;
+}
+
+void bor_output(struct node *node, struct boruvka_node *bdata) {
+  char *report = malloc(16 + (WEIGHT_DIGITS + 1)*bdata->num_neighs);
+  char *ptr = report;
+  struct edge *link = node->neighs->head;
+  uint16_t i;
+
+  ptr += sprintf(report, "Node %d: ", node->id);
+  for (i = 0; i < bdata->num_neighs; i++, link = link->next) {
+    if (bdata->edge_status[i] == EDGE_BRANCH) {
+      ptr += sprintf(ptr, "%" PRIweight " ", link->weight);
+      report_edge(node, link->neigh, link->weight);
+    }
+  }
+  log_msg(report, node->globallog);
+
+  free(report);
+  free(bdata->edge_status);
+  free_edge_arrays(&bdata->arrays);
+  free(bdata->neigh_frags);
+}
@@ -0,0 +1,254 @@
+#ifndef BORUVKA_H
+#define BORUVKA_H
+
+/*This file implements distributed Borůvka, twice: as a round-based algorithm for
+the BSP engine (see bsp.h), and as an asynchronous algorithm for nodes, on any
+of the transports GHS runs on. Every phase, each fragment picks its minimum
+outgoing edge, and every fragment merges along the edge it picked, so the number
+of fragments at least halves each phase. Edges are compared by their key, the
+same way GHS does, so no two edges are ever equal and the picked edges never
+close a cycle.
+
+In the BSP version, fragments are named after their lowest vertex ID. Since
+rounds are synchronous, vertices don't need to count replies to know when
+a phase is over: flooding something through a fragment is done the first round
+nobody, anywhere, got a message, which the engine tells every vertex. Each phase
+goes through these stages:
+  ANNOUNCE -> every vertex sends its fragment to its neighbours on BASIC edges
+              (edges that aren't known to be internal to the fragment)
+  CHOOSE   -> every vertex marks BASIC edges to its own fragment as INTERNAL,
+              which they'll stay forever, and picks its lightest outgoing edge.
+              Vertices that found one send it to their BRANCH neighbours
+  MIN      -> vertices forward lighter edges than the best they know of to
+              their BRANCH neighbours, until every vertex in a fragment knows
+              the fragment's minimum outgoing edge. Then the vertex that owns
+              it marks it BRANCH, and sends a JOIN with its fragment through
+              it. Fragments that have no outgoing edge left are done
+  MERGE    -> the vertex at the other end marks the edge BRANCH too, and the
+              lowest fragment name of the two is flooded through the merged
+              fragment, after which the next phase begins
+
+The asynchronous version has no rounds to count on, so it keeps fragments the
+way GHS does: as trees, rooted at a node that starts each phase with an
+INITIATE, collects the REPORTs of the search, and sends the CHGROOT and CONNECT
+that merge the fragment. Phases play the part of levels, and fragments are
+named after the key of the edge whose merge started their phase. Where it
+departs from GHS is the search. Rather than TESTing one edge at a time, and
+waiting for an ACCEPT or a REJECT before moving on to the next, a node sends a
+TEST with its phase and fragment through every BASIC edge at once as soon as it
+enters a phase, and nobody ever answers a TEST: the TEST the neighbour sends
+when it enters its own phase says all there is to say. A node keeps the name its
+fragment had in every phase it went through, and fragments only ever grow, so a
+neighbour that TESTed with a phase and name the node also had is in its
+fragment, for good. Otherwise, a neighbour that entered the node's phase, or a
+later one, is outside of it, since a node's phase only changes along with its
+fragment. One that's still at an earlier phase has to catch up before the edge
+can be told apart, which it eventually does, the same way GHS defers TESTs from
+higher levels. So a node finds its lightest outgoing edge in a single round trip,
+whatever its degree, for a TEST on every BASIC edge, every phase.
+
+Merging is the same as in GHS, with phases for levels: a CONNECT from a lower
+phase is absorbed right away, a CONNECT through the edge the node itself sent a
+CONNECT on merges the two fragments into the next phase (its root being the
+endpoint with the highest ID), and any other CONNECT waits until the node's
+phase goes up. Since every fragment CONNECTs every phase, the fragments that
+picked each other always merge, and the rest are absorbed as soon as whoever
+they picked has moved on.*/
+
+#include <stdio.h>      /*logging*/
+#include <stdint.h>     /*sized integers for messages*/
+#include <stdlib.h>     /*mallocs and frees*/
+
+#include "bsp.h"        /*the engine running the rounds*/
+#include "algorithm.h"  /*edges are compared by their keys, as in GHS*/
+
+/*Types of messages vertices send each other*/
+enum BORUVKA_MESSAGES {
+  BOR_FRAG = 0,
+  BOR_MIN,
+  BOR_JOIN,
+  BOR_ID
+};
+
+/*Stages of a phase, see above. Vertices in a component that is done are in
+BOR_DONE, and halted*/
+enum BORUVKA_STAGES {
+  BOR_ANNOUNCE = 0,
+  BOR_CHOOSE,
+  BOR_MIN_FLOOD,
+  BOR_MERGE,
+  BOR_DONE
+};
+
+/*Status of each of a vertex's edges*/
+enum BORUVKA_EDGES {
+  BOR_EDGE_BASIC = 0,
+  BOR_EDGE_BRANCH,
+  BOR_EDGE_INTERNAL
+};
+
+/*Borůvka's state for a single vertex.
+  stage       -> which of the BORUVKA_STAGES the vertex is in
+  frag        -> name of the vertex's fragment, its lowest vertex ID
+  phases      -> phases the vertex went through
+  edge_status -> status of each of the vertex's edges
+  best        -> lightest outgoing edge of the fragment the vertex knows of
+  own_best    -> the vertex's own lightest outgoing edge
+  own_edge    -> index of own_best in the vertex's edges
+  join_edge   -> index of the edge the vertex sent a JOIN through this phase,
+                 if any*/
+struct boruvka_vertex {
+  uint8_t stage;
+  uint8_t frag;
+  uint8_t phases;
+  uint8_t *edge_status;
+  struct edge_key best;
+  struct edge_key own_best;
+  int16_t own_edge;
+  int16_t join_edge;
+};
+
+/*Borůvka's state for the whole run.
+  vertices  -> every vertex's state
+  results   -> descriptor vertices report their results on, as nodes do
+  globallog -> where vertices log that they're done*/
+struct boruvka {
+  struct boruvka_vertex *vertices;
+  int32_t results;
+  FILE *globallog;
+};
+
+/*Most phases a node goes through. Fragments merging into phase p+1 are both at
+phase p, and fragments at phase p have at least 2^p nodes, so with node IDs
+being a byte there's no phase past 8*/
+#define BOR_MAX_PHASES 9
+
+/*Asynchronous Borůvka's state for a single node.
+  state       -> the node's state, FIND or FOUND (see NODE_STATES)
+  phase       -> the node's phase
+  fcount      -> the count of children still not reported to the node
+  searching   -> whether the node is still looking for its own lightest
+                 outgoing edge
+  done        -> whether the node is done
+  frag        -> name of the node's fragment
+  frags       -> name the node's fragment had in each phase, max_key() for the
+                 phases it skipped (or hasn't reached)
+  num_neighs  -> number of neighbours the node has
+  edge_status -> status of each of the node's edges (see EDGE_STATUS), REJECT
+                 meaning internal
+  arrays      -> the node's edges, in arrays indexed like edge_status
+  neigh_frags -> the latest phase (as its level) and fragment each neighbour
+                 TESTed the node with
+  in_branch   -> the node's parent in the fragment, -1 for the root
+  branch_sock -> socket of the edge to the parent
+  best_edge   -> index of the edge that leads to the best edge, -1 if none
+  best_key    -> key of the lightest outgoing edge found so far
+  best_sock   -> socket of best_edge
+  deferred    -> whether the last message handled was put back in the queue*/
+struct boruvka_node {
+  uint8_t state;
+  uint8_t phase;
+  uint8_t fcount;
+  uint8_t searching;
+  uint8_t done;
+  struct edge_key frag;
+  struct edge_key frags[BOR_MAX_PHASES];
+  uint16_t num_neighs;
+  uint8_t *edge_status;
+  struct edge_arrays arrays;
+  struct neigh_frag *neigh_frags;
+  int16_t in_branch;
+  uint32_t branch_sock;
+  int16_t best_edge;
+  struct edge_key best_key;
+  uint32_t best_sock;
+  uint8_t deferred;
+};
+
+/*Initializes Borůvka's state for the vertices of the given engine, which
+report their MST edges on the given results descriptor*/
+struct boruvka *init_boruvka(struct bsp_engine *engine, int32_t results,
+                                                              FILE *globallog);
+
+/*Runs a round of Borůvka on the given vertex (a bsp_step)*/
+void boruvka_step(struct bsp_thread *thread, uint32_t vertex,
+                                      struct bsp_msg *msgs, uint32_t num_msgs);
+
+/*Starts a new phase on the given vertex, announcing its fragment*/
+void boruvka_announce(struct bsp_thread *thread, uint32_t vertex);
+
+/*Sends the given message through every one of the vertex's edges with the
+given status, but the one with index skip (-1 to skip none)*/
+void boruvka_flood(struct bsp_thread *thread, uint32_t vertex, uint8_t status,
+                                  int32_t skip, uint8_t *msg, uint32_t len);
+
+/*Reports the vertex's BRANCH edges to the parent, logs it's done and halts it*/
+void boruvka_finish(struct bsp_thread *thread, uint32_t vertex);
+
+/*Frees Borůvka's state*/
+void free_boruvka(struct boruvka *bor, struct bsp_engine *engine);
+
+/*Entry point for asynchronous Borůvka, to be run by a node like ghs() is.
+Sends the node's phase 0 CONNECT, then reacts to messages until the fragment
+is the whole tree, and reports the node's BRANCH edges*/
+void boruvka(struct node *node);
+
+/*Processes an incoming CONNECT, absorbing the sender's fragment if it's at a
+lower phase, merging with it if both picked the same edge, or putting it back
+in the queue otherwise*/
+void bor_connect(struct node *node, struct boruvka_node *bdata,
+                        uint16_t edge_index, uint32_t edge_sock, uint8_t *msg);
+
+/*Processes an incoming INITIATE, which takes the node into the sender's phase
+and fragment*/
+void bor_initiate(struct node *node, struct boruvka_node *bdata,
+                        uint16_t edge_index, uint32_t edge_sock, uint8_t *msg);
+
+/*Processes an incoming TEST, keeping the sender's phase and fragment (and
+rejecting the edge if that's one of the node's own), and carrying on with the
+search if the node was waiting for them*/
+void bor_test(struct node *node, struct boruvka_node *bdata,
+                                            uint16_t edge_index, uint8_t *msg);
+
+/*Processes an incoming REPORT. From a child, it's the lightest outgoing edge
+of its subtree. From the parent, it means the MST is done*/
+void bor_report(struct node *node, struct boruvka_node *bdata,
+                        uint16_t edge_index, uint32_t edge_sock, uint8_t *msg);
+
+/*Takes the node into the given phase and fragment, in the given state, with
+the neighbour on edge from as its parent (-1 if the node is the new root).
+Passes the INITIATE on to the node's children, TESTs every BASIC edge and, if
+the fragment is searching, starts looking for the node's lightest outgoing
+edge*/
+void bor_enter(struct node *node, struct boruvka_node *bdata, uint8_t phase,
+      struct edge_key frag, uint8_t state, int16_t from, uint32_t from_sock);
+
+/*Returns 1 if the neighbour on the given edge is known to be in the node's
+fragment, since it TESTed with a phase and name the node had too*/
+uint8_t bor_internal(struct boruvka_node *bdata, uint16_t edge_index);
+
+/*Goes through the node's BASIC edges, lightest first (see lightest_edge()),
+rejecting the ones to neighbours known to be in the fragment, until it finds one
+known to lead outside it (which is the node's lightest outgoing edge), one whose
+neighbour hasn't caught up with the node's phase yet (so the search has to wait
+for its TEST), or runs out of edges*/
+void bor_search(struct node *node, struct boruvka_node *bdata);
+
+/*Once the node's own search is over and all of its children reported, reports
+the lightest outgoing edge to the parent. The root instead has the fragment
+CONNECT through it, or ends the run if there's none*/
+void bor_report_up(struct node *node, struct boruvka_node *bdata);
+
+/*Passes the CHGROOT towards the fragment's lightest outgoing edge, or sends
+the CONNECT through it if it's the node's own*/
+void bor_changeroot(struct node *node, struct boruvka_node *bdata);
+
+/*Tells the node's children the MST is done, with a REPORT with the maximum
+key, and marks the node as done*/
+void bor_finish(struct node *node, struct boruvka_node *bdata);
+
+/*Logs the node's BRANCH edges and reports them to the parent, the same way
+GHS nodes do, and frees the node's state*/
+void bor_output(struct node *node, struct boruvka_node *bdata);
+
+#endif /* BORUVKA_H */
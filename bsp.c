@@ -0,0 +1,221 @@
+#include "bsp.h"
+
+struct bsp_engine *init_bsp(weight_t *edges, uint8_t num_vertices,
+                            uint32_t num_threads, bsp_step step, void *algo) {
+  struct bsp_engine *engine;
+  uint32_t *routes, i, j, k;
+
+  engine = malloc(sizeof(struct bsp_engine));
+  engine->num_vertices = num_vertices;
+  engine->num_threads = (num_threads < 1) ? 1 :
+                      (num_threads > num_vertices) ? num_vertices : num_threads;
+  engine->step = step;
+  engine->algo = algo;
+
+  /*a message lands in its destination's list of edges, so each edge's "socket"
+  is where the edge sits in the neighbour's list: node j's edge to i is the
+  k-th one, k being the number of j's neighbours with a lower ID than i*/
+  routes = calloc(num_vertices*num_vertices, sizeof(uint32_t));
+  for (j = 0; j < num_vertices; j++) {
+    for (i = 0, k = 0; i < num_vertices; i++) {
+      if (edges[j*num_vertices + i]) {
+        routes[i*num_vertices + j] = k++;
+      }
+    }
+  }
+  engine->adj = build_adjacency(edges, routes, num_vertices, &engine->offsets);
+  free(routes);
+
+  /*nothing is in flight before the first round*/
+  engine->inbox_max = 16;
+  engine->inbox = malloc(engine->inbox_max*sizeof(struct bsp_msg));
+  engine->inbox_offsets = calloc(num_vertices + 1, sizeof(uint32_t));
+  engine->cursors = malloc(num_vertices*sizeof(uint32_t));
+  engine->outboxes = calloc(engine->num_threads, sizeof(struct bsp_outbox));
+  engine->halted = calloc(num_vertices, sizeof(uint8_t));
+  engine->active = calloc(engine->num_threads, sizeof(uint32_t));
+  engine->round = 0;
+  engine->delivered = 0;
+  engine->done = 0;
+  pthread_barrier_init(&engine->barrier, NULL, engine->num_threads);
+
+  engine->rounds = 0;
+  engine->max_rounds = 16;
+  engine->round_msgs = malloc(engine->max_rounds*sizeof(uint32_t));
+  engine->round_secs = malloc(engine->max_rounds*sizeof(double));
+  engine->secs = 0;
+  return engine;
+}
+
+uint32_t run_bsp(struct bsp_engine *engine) {
+  uint32_t n = engine->num_vertices, t = engine->num_threads, i;
+  struct bsp_thread threads[t];
+  pthread_t tids[t];
+  double start;
+
+  /*same slices as the partitioned workers get*/
+  start = mono_time();
+  for (i = 0; i < t; i++) {
+    threads[i].engine = engine;
+    threads[i].id = i;
+    threads[i].first = (i*n + t - 1) / t;
+    threads[i].last = ((i + 1)*n + t - 1) / t;
+    pthread_create(&tids[i], NULL, bsp_thread, (void*)&threads[i]);
+  }
+  for (i = 0; i < t; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  engine->secs = mono_time() - start;
+
+  return engine->rounds;
+}
+
+void bsp_send(struct bsp_thread *thread, uint32_t vertex, uint32_t edge,
+                                                  uint8_t *msg, uint32_t len) {
+  struct bsp_engine *engine = thread->engine;
+  struct bsp_outbox *out = &engine->outboxes[thread->id];
+  struct node_edge *link = &engine->adj[engine->offsets[vertex] + edge];
+  struct bsp_msg *bmsg;
+
+  /*outboxes only ever grow, and are reused every round*/
+  if (out->num == out->max) {
+    out->max = out->max ? 2*out->max : 64;
+    out->msgs = realloc(out->msgs, out->max*sizeof(struct bsp_msg));
+  }
+  bmsg = &out->msgs[out->num++];
+  bmsg->dest = link->neigh;
+  bmsg->edge = link->sock;
+  bmsg->len = len;
+  memcpy(bmsg->data, msg, len);
+}
+
+void bsp_halt(struct bsp_thread *thread, uint32_t vertex) {
+  thread->engine->halted[vertex] = 1;
+}
+
+void *bsp_thread(void *thread) {
+  struct bsp_thread *self = (struct bsp_thread*) thread;
+  struct bsp_engine *engine = self->engine;
+  uint32_t v, num;
+  double start;
+
+  while (1) {
+    /*run every vertex with messages or work left, halted ones are woken up by
+    the messages they get*/
+    start = mono_time();
+    engine->active[self->id] = 0;
+    for (v = self->first; v < self->last; v++) {
+      num = engine->inbox_offsets[v + 1] - engine->inbox_offsets[v];
+      if (num > 0 || !engine->halted[v]) {
+        engine->halted[v] = 0;
+        engine->step(self, v, &engine->inbox[engine->inbox_offsets[v]], num);
+      }
+      engine->active[self->id] += !engine->halted[v];
+    }
+
+    /*everyone has to be done with the inbox before it's overwritten, and the
+    next round can't start before it's ready*/
+    pthread_barrier_wait(&engine->barrier);
+    if (self->id == 0) {
+      bsp_exchange(engine, start);
+    }
+    pthread_barrier_wait(&engine->barrier);
+
+    if (engine->done) {
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+void bsp_exchange(struct bsp_engine *engine, double round_start) {
+  uint32_t n = engine->num_vertices, total = 0, active = 0, i, j, v;
+  struct bsp_outbox *out;
+
+  for (i = 0; i < engine->num_threads; i++) {
+    total += engine->outboxes[i].num;
+    active += engine->active[i];
+  }
+  if (total > engine->inbox_max) {
+    engine->inbox_max = total;
+    engine->inbox = realloc(engine->inbox,
+                                      engine->inbox_max*sizeof(struct bsp_msg));
+  }
+
+  /*count the messages for each vertex, so every vertex's bucket starts right
+  after the previous one's*/
+  memset(engine->cursors, 0, n*sizeof(uint32_t));
+  for (i = 0; i < engine->num_threads; i++) {
+    out = &engine->outboxes[i];
+    for (j = 0; j < out->num; j++) {
+      engine->cursors[out->msgs[j].dest]++;
+    }
+  }
+  engine->inbox_offsets[0] = 0;
+  for (v = 0; v < n; v++) {
+    engine->inbox_offsets[v + 1] = engine->inbox_offsets[v] +
+                                                            engine->cursors[v];
+    engine->cursors[v] = engine->inbox_offsets[v];
+  }
+
+  /*then drop them in, in the order they were sent*/
+  for (i = 0; i < engine->num_threads; i++) {
+    out = &engine->outboxes[i];
+    for (j = 0; j < out->num; j++) {
+      engine->inbox[engine->cursors[out->msgs[j].dest]++] = out->msgs[j];
+    }
+    out->num = 0;
+  }
+  engine->delivered = total;
+  engine->round++;
+  engine->done = (total == 0 && active == 0);
+
+  /*rounds only ever go up, so grow by doubling*/
+  if (engine->rounds == engine->max_rounds) {
+    engine->max_rounds *= 2;
+    engine->round_msgs = realloc(engine->round_msgs,
+                                        engine->max_rounds*sizeof(uint32_t));
+    engine->round_secs = realloc(engine->round_secs,
+                                          engine->max_rounds*sizeof(double));
+  }
+  engine->round_msgs[engine->rounds] = total;
+  engine->round_secs[engine->rounds] = mono_time() - round_start;
+  engine->rounds++;
+}
+
+void print_bsp_stats(struct bsp_engine *engine, FILE *stream) {
+  uint64_t total = 0;
+  uint32_t i;
+
+  for (i = 0; i < engine->rounds; i++) {
+    total += engine->round_msgs[i];
+  }
+  fprintf(stream, "BSP: %u rounds, %lu messages, %.3fs on %u threads\n",
+            engine->rounds, total, engine->secs, engine->num_threads);
+  fprintf(stream, "%6s %9s %10s\n", "Round", "Messages", "Time (ms)");
+  for (i = 0; i < engine->rounds; i++) {
+    fprintf(stream, "%6u %9u %10.3f\n", i, engine->round_msgs[i],
+                                                1000*engine->round_secs[i]);
+  }
+}
+
+void free_bsp(struct bsp_engine *engine) {
+  uint32_t i;
+
+  for (i = 0; i < engine->num_threads; i++) {
+    free(engine->outboxes[i].msgs);
+  }
+  pthread_barrier_destroy(&engine->barrier);
+  free(engine->adj);
+  free(engine->offsets);
+  free(engine->inbox);
+  free(engine->inbox_offsets);
+  free(engine->cursors);
+  free(engine->outboxes);
+  free(engine->halted);
+  free(engine->active);
+  free(engine->round_msgs);
+  free(engine->round_secs);
+  free(engine);
+}
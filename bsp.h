@@ -0,0 +1,157 @@
+#ifndef BSP_H
+#define BSP_H
+
+/*This file implements the synchronous-round (BSP) engine, for algorithms that
+are written as a sequence of rounds rather than as handlers reacting to
+whatever message comes next. Vertices have no queues and no receiver threads:
+in round r, every vertex that still has work to do is handed all the messages
+its neighbours sent it in round r-1, at once, and whatever it sends goes out in
+round r+1. Rounds are run by a pool of threads, each of which owns a contiguous
+slice of the vertices, and threads only meet at the barriers between rounds.
+
+Messages are kept in arrays, one per round and thread rather than per edge.
+While a round runs, each thread appends the messages its vertices send to its
+own outbox, so sending never takes a lock. At the barrier, the outboxes of every
+thread are bucketed by destination into the inbox of the next round, a single
+array in which each vertex's messages are contiguous. Messages land in the
+order they were sent, by thread, so a run only depends on its input (and the
+number of threads).
+
+A vertex that has nothing left to do votes to halt, and is skipped until a
+message wakes it up again. The run ends once every vertex has halted and no
+messages are in flight. The engine keeps the number of messages and the time
+taken by every round (superstep), from the start of the round to the end of
+its exchange.*/
+
+#include <stdio.h>      /*printing round statistics*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*memcpys*/
+#include <pthread.h>    /*the thread pool and its barrier*/
+
+#include "node.h"       /*vertices get the same edges nodes do*/
+#include "results.h"    /*monotonic timestamps*/
+
+/*Longest message a vertex can send*/
+#define BSP_MAX_MSG 16
+
+/*A message between vertices.
+  dest -> the vertex it's for
+  edge -> index of the edge it came through, in dest's list of edges
+  len  -> length of the message
+  data -> the message itself*/
+struct bsp_msg {
+  uint32_t dest;
+  uint32_t edge;
+  uint8_t len;
+  uint8_t data[BSP_MAX_MSG];
+};
+
+/*Messages a thread's vertices sent in the current round*/
+struct bsp_outbox {
+  struct bsp_msg *msgs;
+  uint32_t num;
+  uint32_t max;
+};
+
+struct bsp_thread;
+
+/*What a vertex does in a round: handles the num_msgs messages it got, sends
+its own with bsp_send(), and calls bsp_halt() if it has nothing else to do*/
+typedef void (*bsp_step) (struct bsp_thread *thread, uint32_t vertex,
+                                      struct bsp_msg *msgs, uint32_t num_msgs);
+
+/*The engine, and the state of the run.
+  num_vertices  -> number of vertices
+  num_threads   -> number of threads in the pool
+  adj           -> every vertex's edges, as built by build_adjacency(). The
+                   sock of each edge is its index in the neighbour's own list
+  offsets       -> where each vertex's edges start in adj
+  step          -> what vertices do in each round
+  algo          -> the algorithm's state, for step to use
+  inbox         -> the messages for the current round, by destination
+  inbox_offsets -> where each vertex's messages start in inbox
+  inbox_max     -> how many messages inbox has room for
+  cursors       -> where the next message for each vertex goes, while sorting
+                   the outboxes into the inbox
+  outboxes      -> each thread's messages for the next round
+  halted        -> whether each vertex has voted to halt
+  active        -> how many vertices each thread has that didn't halt
+  round         -> the current round, starting from 0
+  delivered     -> number of messages in the current round's inbox
+  done          -> whether the run is over
+  barrier       -> where threads wait for each other between rounds
+  rounds        -> number of rounds run
+  round_msgs    -> messages sent in each round
+  round_secs    -> time each round took, exchange included
+  max_rounds    -> how many rounds round_msgs and round_secs have room for
+  secs          -> time the whole run took*/
+struct bsp_engine {
+  uint32_t num_vertices;
+  uint32_t num_threads;
+  struct node_edge *adj;
+  uint32_t *offsets;
+  bsp_step step;
+  void *algo;
+  struct bsp_msg *inbox;
+  uint32_t *inbox_offsets;
+  uint32_t inbox_max;
+  uint32_t *cursors;
+  struct bsp_outbox *outboxes;
+  uint8_t *halted;
+  uint32_t *active;
+  uint32_t round;
+  uint32_t delivered;
+  uint8_t done;
+  pthread_barrier_t barrier;
+  uint32_t rounds;
+  uint32_t *round_msgs;
+  double *round_secs;
+  uint32_t max_rounds;
+  double secs;
+};
+
+/*A thread of the pool, which runs vertices first to last - 1 every round*/
+struct bsp_thread {
+  struct bsp_engine *engine;
+  uint32_t id;
+  uint32_t first;
+  uint32_t last;
+};
+
+/*Initializes an engine for the graph in the given connectivity matrix, with
+the given number of threads (no more than there are vertices), running the
+given step function on every vertex. algo is whatever state the algorithm
+needs, which the engine never touches*/
+struct bsp_engine *init_bsp(weight_t *edges, uint8_t num_vertices,
+                            uint32_t num_threads, bsp_step step, void *algo);
+
+/*Runs rounds until every vertex has halted and there are no messages left.
+Returns the number of rounds run*/
+uint32_t run_bsp(struct bsp_engine *engine);
+
+/*Sends a message from the given vertex, through its edge with the given index,
+to be delivered in the next round*/
+void bsp_send(struct bsp_thread *thread, uint32_t vertex, uint32_t edge,
+                                                  uint8_t *msg, uint32_t len);
+
+/*Votes to halt the given vertex, which won't be run again unless a message
+arrives for it*/
+void bsp_halt(struct bsp_thread *thread, uint32_t vertex);
+
+/*Runs a single thread of the pool, until the run is over*/
+void *bsp_thread(void *thread);
+
+/*Sorts every thread's outbox into the inbox of the next round, and decides
+whether the run is over. Only run by one thread, while the others wait at the
+barrier*/
+void bsp_exchange(struct bsp_engine *engine, double round_start);
+
+/*Prints the number of rounds, and the messages and time of each, to the given
+stream*/
+void print_bsp_stats(struct bsp_engine *engine, FILE *stream);
+
+/*Frees the engine (but not the algorithm's state)*/
+void free_bsp(struct bsp_engine *engine);
+
+#endif /* BSP_H */
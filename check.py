@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""Checks the MST a run wrote with '-o file' (as CSV) against the network it
+ran on, as printed to the global log. The edges must all be in the network,
+with the same weights, and make up a spanning forest of it (no cycles, one
+tree per component) that weighs as much as the one Kruskal finds. That holds
+for any minimum spanning forest, however ties between repeated weights were
+broken. Runs relabelled with '-N' log the relabelled network, along with the
+old ID of every node, which turns it back into the network the output names.
+
+Runs with updates ('-u') are checked against the network the updates leave
+behind, given the same updates file. Their nodes also log how deep they are in
+the final tree, and under whom, which must match the tree in the output.
+
+    python3 check.py global.log mst.csv [updates]
+"""
+
+import re
+import sys
+
+TOPOLOGY = "--------------- DEBUG: Network Topology ---------------"
+LABELS = "--------------- DEBUG: Node Labels ---------------"
+
+
+def read_network(path):
+    """Returns the adjacency matrix the global log starts with"""
+    with open(path) as log:
+        lines = log.read().split("\n")
+    start = lines.index(TOPOLOGY) + 1
+    rows = []
+    for line in lines[start:]:
+        if not line.strip():
+            break
+        rows.append([float(w) for w in line.split()])
+    return rows
+
+
+def unlabel(rows, path):
+    """Returns the network with the IDs it was generated with, if the global
+    log says it was relabelled, or as it is otherwise"""
+    with open(path) as log:
+        lines = log.read().split("\n")
+    if LABELS not in lines:
+        return rows
+    labels = [int(old) for old in lines[lines.index(LABELS) + 1].split()]
+    n = len(rows)
+    old = [[0.0] * n for _ in range(n)]
+    for u in range(n):
+        for v in range(n):
+            old[labels[u]][labels[v]] = rows[u][v]
+    return old
+
+
+def apply_updates(rows, path):
+    """Applies the updates in the given file to the network, skipping the same
+    ones the parent skips"""
+    n = len(rows)
+    with open(path) as updates:
+        for line in updates:
+            fields = line.split()
+            if line.startswith("#") or len(fields) != 4:
+                continue
+            try:
+                kind, u, v = fields[0], int(fields[1]), int(fields[2])
+                w = float(fields[3])
+            except ValueError:
+                continue
+            if u == v or min(u, v) < 0 or max(u, v) >= n or w <= 0:
+                continue
+            current = rows[u][v]
+            if (kind == "insert" and not current) or \
+               (kind == "decrease" and current and w < current):
+                rows[u][v] = rows[v][u] = w
+
+
+def read_depths(path):
+    """Returns the depth and parent (None for roots) the nodes logged for
+    themselves, by node"""
+    depths = {}
+    with open(path) as log:
+        for line in log:
+            match = re.search(r"Node (\d+) is (a root, )?(\d+) deep"
+                              r"(, under (\d+))?", line)
+            if match:
+                parent = match.group(5)
+                depths[int(match.group(1))] = (int(match.group(3)),
+                                               int(parent) if parent else None)
+    return depths
+
+
+def read_forest(path):
+    """Returns the (u, v, weight) edges of a CSV output file"""
+    with open(path) as csv:
+        lines = csv.read().split("\n")
+    if lines[0] != "u,v,weight":
+        sys.exit("%s isn't a CSV output file!" % path)
+    edges = []
+    for line in lines[1:]:
+        if line:
+            u, v, w = line.split(",")
+            edges.append((int(u), int(v), float(w)))
+    return edges
+
+
+def find(roots, node):
+    """Returns the root of the node's tree, halving the path to it"""
+    while roots[node] != node:
+        roots[node] = roots[roots[node]]
+        node = roots[node]
+    return node
+
+
+def kruskal(rows):
+    """Returns the weight of the network's minimum spanning forest, and how
+    many edges it has"""
+    n = len(rows)
+    roots = list(range(n))
+    edges = sorted((rows[u][v], u, v) for u in range(n)
+                   for v in range(u + 1, n) if rows[u][v])
+    total, count = 0.0, 0
+    for w, u, v in edges:
+        ru, rv = find(roots, u), find(roots, v)
+        if ru != rv:
+            roots[ru] = rv
+            total += w
+            count += 1
+    return total, count
+
+
+def check(rows, forest):
+    """Returns what's wrong with the forest, or None if it's a minimum
+    spanning forest of the network"""
+    n = len(rows)
+    roots = list(range(n))
+    total = 0.0
+    for u, v, w in forest:
+        if u >= n or v >= n or not rows[u][v]:
+            return "edge %d-%d isn't in the network" % (u, v)
+        if rows[u][v] != w:
+            return "edge %d-%d weighs %g, not %g" % (u, v, rows[u][v], w)
+        ru, rv = find(roots, u), find(roots, v)
+        if ru == rv:
+            return "edge %d-%d closes a cycle" % (u, v)
+        roots[ru] = rv
+        total += w
+
+    best, count = kruskal(rows)
+    if len(forest) != count:
+        return "%d edges, the spanning forest has %d" % (len(forest), count)
+    if abs(total - best) > 1e-9 * max(1.0, abs(best)):
+        return "total weight %g, the minimum is %g" % (total, best)
+    return None
+
+
+def check_depths(depths, n, forest):
+    """Returns what's wrong with the depths the nodes logged, or None if every
+    node is one deeper than its parent, through an edge of the forest"""
+    edges = set((min(u, v), max(u, v)) for u, v, w in forest)
+    for node in range(n):
+        if node not in depths:
+            return "node %d didn't log its depth" % node
+        depth, parent = depths[node]
+        if parent is None:
+            if depth != 0:
+                return "root %d is %d deep" % (node, depth)
+        elif (min(node, parent), max(node, parent)) not in edges:
+            return "node %d hangs from %d, off the tree" % (node, parent)
+        elif depth != depths[parent][0] + 1:
+            return "node %d is %d deep, its parent %d is %d deep" % (
+                node, depth, parent, depths[parent][0])
+    return None
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit("usage: %s <global log> <CSV output> [updates]" % sys.argv[0])
+    rows = unlabel(read_network(sys.argv[1]), sys.argv[1])
+    if len(sys.argv) == 4:
+        apply_updates(rows, sys.argv[3])
+    forest = read_forest(sys.argv[2])
+    error = check(rows, forest)
+    depths = read_depths(sys.argv[1])
+    if not error and depths:
+        error = check_depths(depths, len(rows), forest)
+    print("%d nodes, %d edges, total weight %g: %s" % (len(rows), len(forest),
+          sum(w for u, v, w in forest), error or "minimum"))
+    sys.exit(1 if error else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,126 @@
+#include "contract.h"
+
+struct seed *contract_nodes(weight_t *edges, uint8_t num_nodes,
+                                                uint8_t *owners, uint8_t id) {
+  struct seed *seeds = calloc(num_nodes, sizeof(struct seed));
+  uint8_t *chosen = calloc(num_nodes*num_nodes, sizeof(uint8_t));
+  uint8_t *local = malloc(num_nodes*sizeof(uint8_t));
+  uint8_t *roots = malloc(num_nodes*sizeof(uint8_t));
+  uint8_t *sizes = malloc(num_nodes*sizeof(uint8_t));
+  uint8_t *core = malloc(2*num_nodes*sizeof(uint8_t));
+  uint16_t *taken = malloc(num_nodes*sizeof(uint16_t));
+  uint32_t i, j, k, num_taken;
+
+  for (i = 0; i < num_nodes; i++) {
+    local[i] = (owners[i] == id);
+    seeds[i].core = SEED_NONE;
+    if (local[i]) {
+      seeds[i].inside = malloc(num_nodes*sizeof(uint8_t));
+    }
+  }
+
+  /*every edge with an end in this worker*/
+  for (i = 0; i < num_nodes; i++) {
+    for (j = i + 1; j < num_nodes; j++) {
+      chosen[i*num_nodes + j] = (edges[i*num_nodes + j] != 0 &&
+                                                      (local[i] || local[j]));
+    }
+  }
+  num_taken = kruskal(edges, num_nodes, chosen, local, roots, sizes, taken);
+
+  /*every fragment takes the last edge it took as its core*/
+  for (k = 0; k < num_taken; k++) {
+    i = taken[k] / num_nodes;
+    j = taken[k] % num_nodes;
+    core[2*find_root(roots, i)] = i;
+    core[2*find_root(roots, i) + 1] = j;
+    seeds[i].inside[seeds[i].num_branches++] = j;
+    seeds[j].inside[seeds[j].num_branches++] = i;
+  }
+
+  for (i = 0; i < num_nodes; i++) {
+    uint8_t root = find_root(roots, i);
+    if (owners[i] != id || sizes[root] == 1) {
+      continue;
+    }
+    for (k = sizes[root]; k > 1; k >>= 1) {
+      seeds[i].level++;
+    }
+    seeds[i].num_inside = seeds[i].num_branches;
+    for (j = 0; j < num_nodes; j++) {
+      if (edges[i*num_nodes + j] != 0 && owners[j] == id &&
+                  find_root(roots, j) == root && !is_branch(&seeds[i], j)) {
+        seeds[i].inside[seeds[i].num_inside++] = j;
+      }
+    }
+    if (core[2*root] == i) {
+      seeds[i].core = core[2*root + 1];
+    }
+    else if (core[2*root + 1] == i) {
+      seeds[i].core = core[2*root];
+    }
+  }
+
+  free(chosen);
+  free(local);
+  free(roots);
+  free(sizes);
+  free(core);
+  free(taken);
+  return seeds;
+}
+
+uint8_t is_branch(struct seed *seed, uint8_t neigh) {
+  uint32_t i;
+
+  for (i = 0; i < seed->num_branches; i++) {
+    if (seed->inside[i] == neigh) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+uint32_t count_seeded(struct seed *seeds, uint8_t num_nodes,
+                                      uint32_t *fragments, uint32_t *rejected) {
+  uint32_t i, branches = 0, inside = 0, cores = 0;
+
+  /*every edge has two ends, and so does every core*/
+  for (i = 0; i < num_nodes; i++) {
+    branches += seeds[i].num_branches;
+    inside += seeds[i].num_inside;
+    cores += (seeds[i].core != SEED_NONE);
+  }
+
+  *fragments = cores/2;
+  *rejected = (inside - branches)/2;
+  return branches/2;
+}
+
+void print_contraction(weight_t *edges, uint8_t num_nodes, uint8_t *owners,
+                          uint8_t workers, uint8_t trees, FILE *stream) {
+  uint32_t found = 0, fragments = 0, rejected = 0, aux, rej;
+  uint8_t k;
+
+  /*workers contract on their own, so we simply do what each of them does*/
+  for (k = 0; k < workers; k++) {
+    struct seed *seeds = contract_nodes(edges, num_nodes, owners, k);
+    found += count_seeded(seeds, num_nodes, &aux, &rej);
+    fragments += aux;
+    rejected += rej;
+    free_seeds(seeds, num_nodes);
+  }
+
+  fprintf(stream, "Contraction: workers found %u of %u MST edges, in %u"
+                  " fragments, and rejected %u edges\n", found,
+                  num_nodes - trees, fragments, rejected);
+}
+
+void free_seeds(struct seed *seeds, uint8_t num_nodes) {
+  uint32_t i;
+
+  for (i = 0; i < num_nodes; i++) {
+    free(seeds[i].inside);
+  }
+  free(seeds);
+}
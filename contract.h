@@ -0,0 +1,72 @@
+#ifndef CONTRACT_H
+#define CONTRACT_H
+
+/*This file implements contracting the network inside each partitioned worker
+before GHS starts. A worker knows the whole of the edges between its own nodes,
+so there's no need for them to find those of the MST with messages: with '-K',
+every worker first runs Kruskal over the edges of its nodes, in the order GHS
+ranks edges (by weight, then by their endpoints' IDs), and hands its nodes the
+fragments it found. GHS then starts from those fragments rather than from
+single nodes, and never sends a message inside them.
+A worker doesn't know which of its edges to other workers' nodes are in the
+MST, so it runs Kruskal knowing only its own nodes: the first time an edge to
+another worker comes up, the fragment on our end of it is frozen (see
+kruskal.h). Every fragment is thus a piece of the MST, whatever the other
+workers do.
+Each fragment of more than one node starts at level floor(log2(size)), which
+keeps GHS's promise that a fragment at level L has at least 2^L nodes, and is
+named after the last edge it took, as its core. Its nodes start out with their
+tree edges as BRANCH, and their other edges inside the fragment as REJECT, so
+they never TEST those. The two ends of the core send each other an INITIATE, as
+if two fragments had just merged over it (see seed_fragment()).*/
+
+#include <stdio.h>      /*reporting the fragments*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+
+#include "weight.h"     /*the adjacency matrix holds weights*/
+#include "kruskal.h"    /*fragments are what Kruskal takes*/
+
+/*Neighbour a node has across the core when it isn't at either end of it*/
+#define SEED_NONE 0xFF
+
+/*Fragment a node starts GHS in, as its worker found it.
+  level        -> level of the fragment, 0 if the node starts on its own
+  core         -> the neighbour across the fragment's core, or SEED_NONE
+  num_branches -> number of the node's edges in the fragment's tree
+  num_inside   -> number of the node's edges inside the fragment altogether
+  inside       -> the neighbours on the other end of those, tree edges first*/
+struct seed {
+  uint8_t level;
+  uint8_t core;
+  uint8_t num_branches;
+  uint8_t num_inside;
+  uint8_t *inside;
+};
+
+/*Returns the fragment every node of the given worker starts in, by node ID
+(the nodes of other workers start on their own), when the worker contracts the
+network with the given adjacency matrix as described above*/
+struct seed *contract_nodes(weight_t *edges, uint8_t num_nodes,
+                                                uint8_t *owners, uint8_t id);
+
+/*Returns whether the edge to the given neighbour is in the tree of the node's
+fragment*/
+uint8_t is_branch(struct seed *seed, uint8_t neigh);
+
+/*Returns how many MST edges the given seeds hold, and stores how many
+fragments of more than one node they make up, and how many edges inside those
+fragments aren't in the MST*/
+uint32_t count_seeded(struct seed *seeds, uint8_t num_nodes,
+                                      uint32_t *fragments, uint32_t *rejected);
+
+/*Prints how many MST edges and fragments all the workers found between them,
+next to how many MST edges the network has, and how many other edges they
+rejected*/
+void print_contraction(weight_t *edges, uint8_t num_nodes, uint8_t *owners,
+                          uint8_t workers, uint8_t trees, FILE *stream);
+
+/*Frees the given seeds*/
+void free_seeds(struct seed *seeds, uint8_t num_nodes);
+
+#endif /* CONTRACT_H */
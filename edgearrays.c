@@ -0,0 +1,271 @@
+#include "edgearrays.h"
+
+/*The kernel lightest_edge() runs, and its name, picked once*/
+lightest_kernel edge_kernel = &lightest_edge_scalar;
+const char *edge_kernel_name = "scalar";
+pthread_once_t edge_kernel_once = PTHREAD_ONCE_INIT;
+
+void init_edge_arrays(struct edge_arrays *arrays, struct neighbours *neighs) {
+  struct edge *link;
+  uint32_t i;
+
+  arrays->num = neighs->num;
+  arrays->weights = malloc(arrays->num*sizeof(weight_t));
+  arrays->socks = malloc(arrays->num*sizeof(uint32_t));
+  arrays->neighs = malloc(arrays->num*sizeof(uint32_t));
+  for (i = 0, link = neighs->head; i < arrays->num; i++, link = link->next) {
+    arrays->weights[i] = link->weight;
+    arrays->socks[i] = link->sock;
+    arrays->neighs[i] = link->neigh;
+  }
+}
+
+void append_edge_arrays(struct edge_arrays *arrays, weight_t weight,
+                                                uint32_t sock, uint32_t neigh) {
+  /*edges are only ever appended one at a time, and rarely*/
+  arrays->weights = realloc(arrays->weights,
+                                      (arrays->num + 1)*sizeof(weight_t));
+  arrays->socks = realloc(arrays->socks, (arrays->num + 1)*sizeof(uint32_t));
+  arrays->neighs = realloc(arrays->neighs, (arrays->num + 1)*sizeof(uint32_t));
+  arrays->weights[arrays->num] = weight;
+  arrays->socks[arrays->num] = sock;
+  arrays->neighs[arrays->num] = neigh;
+  arrays->num++;
+}
+
+void free_edge_arrays(struct edge_arrays *arrays) {
+  free(arrays->weights);
+  free(arrays->socks);
+  free(arrays->neighs);
+  arrays->num = 0;
+}
+
+int32_t lightest_edge(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                 uint8_t want) {
+  pthread_once(&edge_kernel_once, pick_lightest_kernel);
+  return edge_kernel(weights, status, num, want);
+}
+
+void pick_lightest_kernel() {
+#ifdef EDGE_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    edge_kernel = &lightest_edge_avx2;
+    edge_kernel_name = "avx2";
+  }
+  else if (__builtin_cpu_supports("sse4.2")) {
+    edge_kernel = &lightest_edge_sse42;
+    edge_kernel_name = "sse4.2";
+  }
+#endif
+}
+
+const char *lightest_kernel_name() {
+  pthread_once(&edge_kernel_once, pick_lightest_kernel);
+  return edge_kernel_name;
+}
+
+int32_t lightest_edge_scalar(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                 uint8_t want) {
+  int32_t best = -1;
+  uint32_t i;
+
+  /*strictly lighter, so ties go to the earliest edge*/
+  for (i = 0; i < num; i++) {
+    if (status[i] == want && (best == -1 || weights[i] < weights[best])) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+#ifdef EDGE_SIMD
+
+/*Both SIMD kernels are the same code, over vectors of different widths. For
+each ISA and weight type, the macros below give:
+  VEC        -> the vector type
+  LANES      -> how many weights fit in a vector
+  SET1(x)    -> a vector with x in every lane
+  MASKED(i)  -> the weights of edges i to i + LANES - 1, with WEIGHT_MAX for the
+                ones whose status isn't want
+  MIN(a, b)  -> lane-wise minimum of two vectors
+  EQ(a, b)   -> movemask of the lanes in which a and b are equal
+  BITS       -> bits EQ() gives per lane
+  STORE(p,v) -> stores v's lanes in p
+Statuses are bytes, so they're loaded LANES at a time, compared with want, and
+the comparison sign-extended to the width of a weight, which makes a mask with
+all of a lane's bits set for the edges with the right status.*/
+#if defined(WEIGHT_U32)
+#define SSE_VEC __m128i
+#define SSE_LANES 4
+#define SSE_SET1(x) _mm_set1_epi32((int32_t) (x))
+#define SSE_MASKED(i) _mm_blendv_epi8(maxv, \
+    _mm_loadu_si128((__m128i*) &weights[i]), \
+    _mm_cvtepi8_epi32(_mm_cmpeq_epi8(STATUS4(i), _mm_set1_epi8(want))))
+#define SSE_MIN(a, b) _mm_min_epu32(a, b)
+#define SSE_EQ(a, b) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)))
+#define SSE_BITS 1
+#define SSE_STORE(p, v) _mm_storeu_si128((__m128i*) (p), v)
+
+#define AVX2_VEC __m256i
+#define AVX2_LANES 8
+#define AVX2_SET1(x) _mm256_set1_epi32((int32_t) (x))
+#define AVX2_MASKED(i) _mm256_blendv_epi8(maxv, \
+    _mm256_loadu_si256((__m256i*) &weights[i]), \
+    _mm256_cvtepi8_epi32(_mm_cmpeq_epi8(STATUS8(i), _mm_set1_epi8(want))))
+#define AVX2_MIN(a, b) _mm256_min_epu32(a, b)
+#define AVX2_EQ(a, b) _mm256_movemask_ps(_mm256_castsi256_ps( \
+    _mm256_cmpeq_epi32(a, b)))
+#define AVX2_BITS 1
+#define AVX2_STORE(p, v) _mm256_storeu_si256((__m256i*) (p), v)
+
+/*there's no unsigned 64-bit minimum before AVX-512, so flip the sign bits and
+compare them as signed*/
+#elif defined(WEIGHT_U64)
+#define SSE_VEC __m128i
+#define SSE_LANES 2
+#define SSE_SET1(x) _mm_set1_epi64x((int64_t) (x))
+#define SSE_MASKED(i) _mm_blendv_epi8(maxv, \
+    _mm_loadu_si128((__m128i*) &weights[i]), \
+    _mm_cvtepi8_epi64(_mm_cmpeq_epi8(STATUS2(i), _mm_set1_epi8(want))))
+#define SSE_MIN(a, b) _mm_blendv_epi8(a, b, _mm_cmpgt_epi64( \
+    _mm_xor_si128(a, _mm_set1_epi64x(INT64_MIN)), \
+    _mm_xor_si128(b, _mm_set1_epi64x(INT64_MIN))))
+#define SSE_EQ(a, b) _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(a, b)))
+#define SSE_BITS 1
+#define SSE_STORE(p, v) _mm_storeu_si128((__m128i*) (p), v)
+
+#define AVX2_VEC __m256i
+#define AVX2_LANES 4
+#define AVX2_SET1(x) _mm256_set1_epi64x((int64_t) (x))
+#define AVX2_MASKED(i) _mm256_blendv_epi8(maxv, \
+    _mm256_loadu_si256((__m256i*) &weights[i]), \
+    _mm256_cvtepi8_epi64(_mm_cmpeq_epi8(STATUS4(i), _mm_set1_epi8(want))))
+#define AVX2_MIN(a, b) _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64( \
+    _mm256_xor_si256(a, _mm256_set1_epi64x(INT64_MIN)), \
+    _mm256_xor_si256(b, _mm256_set1_epi64x(INT64_MIN))))
+#define AVX2_EQ(a, b) _mm256_movemask_pd(_mm256_castsi256_pd( \
+    _mm256_cmpeq_epi64(a, b)))
+#define AVX2_BITS 1
+#define AVX2_STORE(p, v) _mm256_storeu_si256((__m256i*) (p), v)
+
+#elif defined(WEIGHT_F64)
+#define SSE_VEC __m128d
+#define SSE_LANES 2
+#define SSE_SET1(x) _mm_set1_pd(x)
+#define SSE_MASKED(i) _mm_blendv_pd(maxv, _mm_loadu_pd(&weights[i]), \
+    _mm_castsi128_pd(_mm_cvtepi8_epi64( \
+    _mm_cmpeq_epi8(STATUS2(i), _mm_set1_epi8(want)))))
+#define SSE_MIN(a, b) _mm_min_pd(a, b)
+#define SSE_EQ(a, b) _mm_movemask_pd(_mm_cmpeq_pd(a, b))
+#define SSE_BITS 1
+#define SSE_STORE(p, v) _mm_storeu_pd(p, v)
+
+#define AVX2_VEC __m256d
+#define AVX2_LANES 4
+#define AVX2_SET1(x) _mm256_set1_pd(x)
+#define AVX2_MASKED(i) _mm256_blendv_pd(maxv, _mm256_loadu_pd(&weights[i]), \
+    _mm256_castsi256_pd(_mm256_cvtepi8_epi64( \
+    _mm_cmpeq_epi8(STATUS4(i), _mm_set1_epi8(want)))))
+#define AVX2_MIN(a, b) _mm256_min_pd(a, b)
+#define AVX2_EQ(a, b) _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ))
+#define AVX2_BITS 1
+#define AVX2_STORE(p, v) _mm256_storeu_pd(p, v)
+
+/*16-bit weights, where movemask gives two bits per lane*/
+#else
+#define SSE_VEC __m128i
+#define SSE_LANES 8
+#define SSE_SET1(x) _mm_set1_epi16((int16_t) (x))
+#define SSE_MASKED(i) _mm_blendv_epi8(maxv, \
+    _mm_loadu_si128((__m128i*) &weights[i]), \
+    _mm_cvtepi8_epi16(_mm_cmpeq_epi8(STATUS8(i), _mm_set1_epi8(want))))
+#define SSE_MIN(a, b) _mm_min_epu16(a, b)
+#define SSE_EQ(a, b) _mm_movemask_epi8(_mm_cmpeq_epi16(a, b))
+#define SSE_BITS 2
+#define SSE_STORE(p, v) _mm_storeu_si128((__m128i*) (p), v)
+
+#define AVX2_VEC __m256i
+#define AVX2_LANES 16
+#define AVX2_SET1(x) _mm256_set1_epi16((int16_t) (x))
+#define AVX2_MASKED(i) _mm256_blendv_epi8(maxv, \
+    _mm256_loadu_si256((__m256i*) &weights[i]), \
+    _mm256_cvtepi8_epi16(_mm_cmpeq_epi8(STATUS16(i), _mm_set1_epi8(want))))
+#define AVX2_MIN(a, b) _mm256_min_epu16(a, b)
+#define AVX2_EQ(a, b) _mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b))
+#define AVX2_BITS 2
+#define AVX2_STORE(p, v) _mm256_storeu_si256((__m256i*) (p), v)
+#endif
+
+/*Loads the statuses of edges i onwards into the low bytes of a vector, never
+reading past the last of them*/
+#define STATUS16(i) _mm_loadu_si128((__m128i*) &status[i])
+#define STATUS8(i) _mm_loadl_epi64((__m128i*) &status[i])
+#define STATUS4(i) (memcpy(&sword, &status[i], 4), _mm_cvtsi32_si128(sword))
+#define STATUS2(i) (memcpy(&sword, &status[i], 2), _mm_cvtsi32_si128(sword))
+
+/*The kernel: the minimum of every full vector of edges, then of its lanes and
+of the edges left over, then the first edge with that weight and status (which
+the masked lanes never match, since WEIGHT_MAX is never an edge's weight)*/
+#define LIGHTEST_KERNEL(ISA) \
+  ISA##_VEC maxv = ISA##_SET1(WEIGHT_MAX), minv = maxv; \
+  weight_t lanes[ISA##_LANES], best = WEIGHT_MAX; \
+  uint32_t i, full = num - num % ISA##_LANES; \
+  int32_t sword __attribute__((unused)) = 0; \
+  uint32_t bits; \
+  \
+  for (i = 0; i < full; i += ISA##_LANES) { \
+    minv = ISA##_MIN(minv, ISA##_MASKED(i)); \
+  } \
+  ISA##_STORE(lanes, minv); \
+  for (i = 0; i < ISA##_LANES; i++) { \
+    best = (lanes[i] < best) ? lanes[i] : best; \
+  } \
+  for (i = full; i < num; i++) { \
+    if (status[i] == want && weights[i] < best) { \
+      best = weights[i]; \
+    } \
+  } \
+  if (best == WEIGHT_MAX) { \
+    return -1; \
+  } \
+  \
+  minv = ISA##_SET1(best); \
+  for (i = 0; i < full; i += ISA##_LANES) { \
+    bits = ISA##_EQ(ISA##_MASKED(i), minv); \
+    if (bits) { \
+      return i + __builtin_ctz(bits) / ISA##_BITS; \
+    } \
+  } \
+  for (i = full; i < num; i++) { \
+    if (status[i] == want && weights[i] == best) { \
+      return i; \
+    } \
+  } \
+  return -1;
+
+__attribute__((target("sse4.2")))
+int32_t lightest_edge_sse42(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                 uint8_t want) {
+  LIGHTEST_KERNEL(SSE)
+}
+
+__attribute__((target("avx2")))
+int32_t lightest_edge_avx2(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                 uint8_t want) {
+  LIGHTEST_KERNEL(AVX2)
+}
+
+/*nothing to vectorise with elsewhere*/
+#else
+int32_t lightest_edge_sse42(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                 uint8_t want) {
+  return lightest_edge_scalar(weights, status, num, want);
+}
+
+int32_t lightest_edge_avx2(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                 uint8_t want) {
+  return lightest_edge_scalar(weights, status, num, want);
+}
+#endif
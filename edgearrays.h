@@ -0,0 +1,84 @@
+#ifndef EDGEARRAYS_H
+#define EDGEARRAYS_H
+
+/*This file implements a node's edges as a struct of arrays, and finding the
+lightest of them with a given status. The neighbour list keeps edges sorted by
+weight, so GHS used to find its lightest UNKNOWN edge by walking the list until
+the first one, which is a pointer chase per edge, and only works as long as the
+list is sorted. Instead, algorithms keep the weights, sockets and neighbours of
+their edges in arrays, in the same order as the list and as their edge_status
+arrays, and look for the lightest edge with a masked min-reduction over the
+weights: edges with any other status count as the largest weight, the minimum
+is taken over the whole array, and then the first edge with that weight and
+status is the one. Ties go to the earliest edge, which for a sorted list is the
+one with the lowest neighbour ID, same as edge keys.
+
+The reduction has a scalar version, and SSE4.2 and AVX2 ones for every weight
+type, which handle as many edges at once as fit in a register (2 to 16) and
+leave the rest to the scalar loop. The fastest one the CPU supports is picked
+the first time it's needed. Builds for anything but x86 only have the scalar
+version. See edgebench.c for how they compare, on degrees from 8 to 100k.*/
+
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*memcpys of statuses*/
+#include <pthread.h>    /*picking the kernel once, whoever gets there first*/
+
+#include "neighlist.h"  /*the list the arrays are built from*/
+
+/*SIMD kernels are only built for x86*/
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  /*SSE and AVX intrinsics*/
+#define EDGE_SIMD
+#endif
+
+/*A node's edges, as parallel arrays indexed like the neighbour list.
+  num     -> number of edges
+  weights -> weight of each edge
+  socks   -> socket of each edge
+  neighs  -> ID of the neighbour at the other end of each edge*/
+struct edge_arrays {
+  uint32_t num;
+  weight_t *weights;
+  uint32_t *socks;
+  uint32_t *neighs;
+};
+
+/*Signature of the kernels below*/
+typedef int32_t (*lightest_kernel) (weight_t *weights, uint8_t *status,
+                                                  uint32_t num, uint8_t want);
+
+/*Fills the arrays with the edges of the given list, in the list's order*/
+void init_edge_arrays(struct edge_arrays *arrays, struct neighbours *neighs);
+
+/*Adds an edge to the end of the arrays, as append_edge() does to the list*/
+void append_edge_arrays(struct edge_arrays *arrays, weight_t weight,
+                                                uint32_t sock, uint32_t neigh);
+
+/*Frees the arrays (but not the struct itself)*/
+void free_edge_arrays(struct edge_arrays *arrays);
+
+/*Returns the index of the lightest of the num edges whose status is want, or
+-1 if there are none, with the fastest kernel the CPU supports*/
+int32_t lightest_edge(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                  uint8_t want);
+
+/*Picks the kernel lightest_edge() runs. Only run once*/
+void pick_lightest_kernel();
+
+/*Returns the name of the kernel lightest_edge() runs*/
+const char *lightest_kernel_name();
+
+/*Same as lightest_edge(), one edge at a time*/
+int32_t lightest_edge_scalar(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                  uint8_t want);
+
+/*Same as lightest_edge(), with 128-bit registers. Only for CPUs with SSE4.2*/
+int32_t lightest_edge_sse42(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                  uint8_t want);
+
+/*Same as lightest_edge(), with 256-bit registers. Only for CPUs with AVX2*/
+int32_t lightest_edge_avx2(weight_t *weights, uint8_t *status, uint32_t num,
+                                                                  uint8_t want);
+
+#endif /* EDGEARRAYS_H */
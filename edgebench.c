@@ -0,0 +1,152 @@
+#include "edgebench.h"
+
+int main(int argc, char *argv[]) {
+  uint32_t degrees[] = {8, 16, 32, 64, 128, 256, 1024, 4096, 16384, 65536,
+                                                                        100000};
+  uint32_t num_degrees = sizeof(degrees) / sizeof(degrees[0]), d, i;
+  uint8_t sse = 0, avx2 = 0;
+  int32_t expected, found;
+
+#ifdef EDGE_SIMD
+  __builtin_cpu_init();
+  sse = __builtin_cpu_supports("sse4.2") != 0;
+  avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+
+  srand(argc > 1 ? strtoul(argv[1], NULL, 10) : (unsigned long) time(NULL));
+  printf("%lu-bit weights, lightest_edge() runs the %s kernel\n",
+                            8*sizeof(weight_t), lightest_kernel_name());
+  printf("%8s %10s %10s %10s %10s %8s\n", "Degree", "list(ns)", "scalar(ns)",
+                                      "sse4.2(ns)", "avx2(ns)", "speedup");
+
+  for (d = 0; d < num_degrees; d++) {
+    uint32_t num = degrees[d], reps = BENCH_EDGES / num;
+    weight_t *weights = malloc(num*sizeof(weight_t));
+    weight_t *sorted = malloc(num*sizeof(weight_t));
+    uint8_t *status = malloc(num*sizeof(uint8_t));
+    uint8_t *list_status = malloc(num*sizeof(uint8_t));
+    double list, scalar, fastest, secs;
+
+    for (i = 0; i < num; i++) {
+      weights[i] = random_weight(WEIGHT_MAX < 1000000 ? WEIGHT_MAX : 1000000);
+    }
+    struct neighbours *neighs = shuffled_list(weights, sorted, num);
+
+    /*edges lighter than the median are done with, a few of them BRANCH*/
+    weight_t median = sorted[num / 2];
+    for (i = 0; i < num; i++) {
+      status[i] = (weights[i] >= median) ? EDGE_UNKNOWN :
+                              (rand() % 8 == 0) ? EDGE_BRANCH : EDGE_REJECT;
+      list_status[i] = (sorted[i] >= median) ? EDGE_UNKNOWN : EDGE_REJECT;
+    }
+
+    list = time_list(neighs, list_status, EDGE_UNKNOWN, reps);
+    scalar = time_kernel(&lightest_edge_scalar, weights, status, num, reps,
+                                                                    &expected);
+    fastest = scalar;
+    printf("%8u %10.1f %10.1f", num, list, scalar);
+
+    /*kernels the CPU doesn't have are left blank*/
+    if (sse) {
+      secs = time_kernel(&lightest_edge_sse42, weights, status, num, reps,
+                                                                      &found);
+      fastest = (secs < fastest) ? secs : fastest;
+      printf(" %10.1f", secs);
+      if (found != expected) {
+        fprintf(stderr, "\nsse4.2 found edge %d, not %d!\n", found, expected);
+        return 1;
+      }
+    }
+    else {
+      printf(" %10s", "-");
+    }
+    if (avx2) {
+      secs = time_kernel(&lightest_edge_avx2, weights, status, num, reps,
+                                                                      &found);
+      fastest = (secs < fastest) ? secs : fastest;
+      printf(" %10.1f", secs);
+      if (found != expected) {
+        fprintf(stderr, "\navx2 found edge %d, not %d!\n", found, expected);
+        return 1;
+      }
+    }
+    else {
+      printf(" %10s", "-");
+    }
+    printf(" %7.1fx\n", scalar / fastest);
+
+    free_neighs(neighs);
+    free(weights);
+    free(sorted);
+    free(status);
+    free(list_status);
+  }
+
+  return 0;
+}
+
+double time_kernel(lightest_kernel kernel, weight_t *weights, uint8_t *status,
+                                uint32_t num, uint32_t reps, int32_t *found) {
+  double start = mono_time();
+  uint32_t i;
+
+  for (i = 0; i < reps; i++) {
+    *found = kernel(weights, status, num, EDGE_UNKNOWN);
+  }
+
+  return (mono_time() - start) * 1e9 / reps;
+}
+
+double time_list(struct neighbours *neighs, uint8_t *status, uint8_t want,
+                                                              uint32_t reps) {
+  double start = mono_time();
+  struct edge *link;
+  uint32_t i, j;
+
+  for (i = 0; i < reps; i++) {
+    link = neighs->head;
+    for (j = 0; j < neighs->num && status[j] != want; j++) {
+      link = link->next;
+    }
+  }
+
+  return (mono_time() - start) * 1e9 / reps;
+}
+
+struct neighbours *shuffled_list(weight_t *weights, weight_t *sorted,
+                                                                uint32_t num) {
+  struct neighbours *neighs = init_neighs();
+  struct edge **edges = malloc(num*sizeof(struct edge*)), *swap;
+  uint32_t i, j;
+
+  /*add_edge() would take quadratic time to build the longest lists, so link
+  them ourselves, in sorted order but with the edges all over the heap*/
+  for (i = 0; i < num; i++) {
+    edges[i] = malloc(sizeof(struct edge));
+  }
+  for (i = num - 1; i > 0; i--) {
+    j = rand() % (i + 1);
+    swap = edges[i];
+    edges[i] = edges[j];
+    edges[j] = swap;
+  }
+  memcpy(sorted, weights, num*sizeof(weight_t));
+  qsort(sorted, num, sizeof(weight_t), compare_weights);
+  for (i = 0; i < num; i++) {
+    edges[i]->weight = sorted[i];
+    edges[i]->sock = i;
+    edges[i]->neigh = i;
+    edges[i]->next = (i + 1 < num) ? edges[i + 1] : NULL;
+  }
+  neighs->head = edges[0];
+  neighs->num = num;
+
+  free(edges);
+  return neighs;
+}
+
+int compare_weights(const void *a, const void *b) {
+  weight_t wa = *(weight_t*) a, wb = *(weight_t*) b;
+
+  return (wa > wb) - (wa < wb);
+}
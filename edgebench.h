@@ -0,0 +1,51 @@
+#ifndef EDGEBENCH_H
+#define EDGEBENCH_H
+
+/*This file implements the microbenchmark for finding a node's lightest UNKNOWN
+edge (see edgearrays.h), built as 'edgebench'. For each degree, from 8 up to
+100k, it makes a node with random weights halfway through its search for the
+LWOE: the lighter half of its edges are already BRANCH or REJECT, the heavier
+half still UNKNOWN. Then it times:
+  list   -> walking a weight-sorted neighbour list to its first UNKNOWN edge, as
+            GHS did before the edge arrays. Its edges are allocated in random
+            order, as nodes allocate them while the network is built
+  scalar -> the scalar kernel, over the edge arrays in no particular order
+  sse4.2 -> the SSE kernel, if the CPU has SSE4.2
+  avx2   -> the AVX2 kernel, if the CPU has AVX2
+as the average time of a single call, over enough calls for every degree to take
+about the same time. Every kernel has to find the same edge as the scalar one,
+or the benchmark fails. Usage:
+
+  ./edgebench [seed]*/
+
+#include <stdio.h>      /*printing the results*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*rands, mallocs and frees*/
+#include <time.h>       /*default seed*/
+
+#include "edgearrays.h" /*what we're measuring*/
+#include "algorithm.h"  /*edge statuses*/
+#include "results.h"    /*monotonic timestamps*/
+
+/*Edges the calls for each degree go through, in total*/
+#define BENCH_EDGES 50000000
+
+/*Returns the average time in nanoseconds of a call to the given kernel, over
+reps calls. Stores what the kernel returned in found*/
+double time_kernel(lightest_kernel kernel, weight_t *weights, uint8_t *status,
+                                uint32_t num, uint32_t reps, int32_t *found);
+
+/*Returns the average time in nanoseconds of walking the given list to its
+first edge whose status (in list order) is want, over reps walks*/
+double time_list(struct neighbours *neighs, uint8_t *status, uint8_t want,
+                                                              uint32_t reps);
+
+/*Builds a neighbour list with the given weights, sorted, with its edges
+allocated in random order. Stores the weights in sorted order in sorted*/
+struct neighbours *shuffled_list(weight_t *weights, weight_t *sorted,
+                                                                uint32_t num);
+
+/*Compares two weights, for qsort*/
+int compare_weights(const void *a, const void *b);
+
+#endif /* EDGEBENCH_H */
@@ -0,0 +1,114 @@
+#include "filter.h"
+
+uint32_t filter_edges(weight_t *edges, uint8_t num_nodes, uint32_t seed) {
+  uint8_t *forest = sample_forest(edges, num_nodes, seed);
+  uint16_t *heaviest = malloc(num_nodes*sizeof(uint16_t));
+  uint32_t i, j, dropped = 0;
+
+  /*the forest's own edges are never dropped, so paths stay as they were*/
+  for (i = 0; i < num_nodes; i++) {
+    path_maxima(forest, edges, num_nodes, i, heaviest);
+    for (j = i + 1; j < num_nodes; j++) {
+      if (edges[i*num_nodes + j] == 0 || forest[i*num_nodes + j] ||
+                                                  heaviest[j] == FILTER_NONE) {
+        continue;
+      }
+      if (compare_keys(index_key(edges, num_nodes, i*num_nodes + j),
+                        index_key(edges, num_nodes, heaviest[j])) > 0) {
+        edges[i*num_nodes + j] = 0;
+        edges[j*num_nodes + i] = 0;
+        dropped++;
+      }
+    }
+  }
+
+  free(forest);
+  free(heaviest);
+  return dropped;
+}
+
+uint8_t *sample_forest(weight_t *edges, uint8_t num_nodes, uint32_t seed) {
+  uint8_t *forest = calloc(num_nodes*num_nodes, sizeof(uint8_t));
+  uint8_t *chosen = calloc(num_nodes*num_nodes, sizeof(uint8_t));
+  uint8_t *roots = malloc(num_nodes*sizeof(uint8_t));
+  uint8_t *sizes = malloc(num_nodes*sizeof(uint8_t));
+  uint16_t *taken = malloc(num_nodes*sizeof(uint16_t));
+  uint32_t i, j, k, num_taken;
+
+  /*half the edges*/
+  for (i = 0; i < num_nodes; i++) {
+    for (j = i + 1; j < num_nodes; j++) {
+      chosen[i*num_nodes + j] = (edges[i*num_nodes + j] != 0 &&
+                                                rand_r(&seed) <= RAND_MAX/2);
+    }
+  }
+  num_taken = kruskal(edges, num_nodes, chosen, NULL, roots, sizes, taken);
+
+  for (k = 0; k < num_taken; k++) {
+    i = taken[k] / num_nodes;
+    j = taken[k] % num_nodes;
+    forest[i*num_nodes + j] = 1;
+    forest[j*num_nodes + i] = 1;
+  }
+
+  free(chosen);
+  free(roots);
+  free(sizes);
+  free(taken);
+  return forest;
+}
+
+void path_maxima(uint8_t *forest, weight_t *edges, uint8_t num_nodes,
+                                        uint8_t source, uint16_t *heaviest) {
+  uint8_t *queue = malloc(num_nodes*sizeof(uint8_t));
+  uint8_t *seen = calloc(num_nodes, sizeof(uint8_t));
+  uint16_t i, head, tail;
+
+  for (i = 0; i < num_nodes; i++) {
+    heaviest[i] = FILTER_NONE;
+  }
+
+  /*breadth first through the source's tree, every node taking the heavier of
+  its parent's maximum and the edge to its parent*/
+  seen[source] = 1;
+  queue[0] = source;
+  for (head = 0, tail = 1; head < tail; head++) {
+    uint8_t u = queue[head];
+    for (i = 0; i < num_nodes; i++) {
+      if (!forest[u*num_nodes + i] || seen[i]) {
+        continue;
+      }
+      uint16_t edge = u*num_nodes + i;
+      heaviest[i] = edge;
+      if (heaviest[u] != FILTER_NONE &&
+                      compare_keys(index_key(edges, num_nodes, heaviest[u]),
+                                    index_key(edges, num_nodes, edge)) > 0) {
+        heaviest[i] = heaviest[u];
+      }
+      seen[i] = 1;
+      queue[tail++] = i;
+    }
+  }
+
+  free(queue);
+  free(seen);
+}
+
+struct edge_key index_key(weight_t *edges, uint8_t num_nodes, uint16_t index) {
+  return make_key(edges[index], index / num_nodes, index % num_nodes);
+}
+
+void print_filtering(weight_t *edges, uint8_t num_nodes, uint32_t dropped,
+                                                    double secs, FILE *stream) {
+  uint32_t i, left = 0;
+
+  for (i = 0; i < num_nodes*num_nodes; i++) {
+    left += (edges[i] != 0);
+  }
+  left /= 2;
+
+  fprintf(stream, "Filtering: dropped %u of %u edges (%.1f%%), %u left, in"
+                  " %.3fs\n", dropped, left + dropped,
+                  (left + dropped) ? (100.0 * dropped) / (left + dropped) : 0.0,
+                  left, secs);
+}
@@ -0,0 +1,57 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+/*This file implements dropping edges that can't be in the MST before the
+network runs at all, as Karger, Klein and Tarjan's randomized MST algorithm
+does. Every edge costs GHS at least a TEST and its answer, and a dense network
+has around n^2/2 of them, of which only n - 1 end up in the MST. With '-S', the
+parent first samples every edge with probability 1/2, and finds the minimum
+spanning forest F of the sample with Kruskal. An edge is F-heavy when its
+endpoints are in the same tree of F, and it's heavier than every edge on the
+path between them: it closes a cycle in which it's the heaviest edge, so it
+can't be in the MST. Every F-heavy edge is dropped, and whichever engine runs
+the network only gets the rest. F is kept whole, so neither the components nor
+the MST change. KKT's sampling lemma says the edges left outside of F (the
+F-light ones) are at most n/p = 2n in expectation, so a dense network of 100
+nodes goes from around 4800 edges to a few hundred.
+Edges are compared by their keys, as GHS compares them (by weight, then by
+their endpoints' IDs), so that repeated weights never make two edges tie, and
+the MST comes out the same, edge for edge. Sampling has a generator of its own,
+seeded by whoever filters, so it doesn't disturb anyone else's rand(), and the
+same network and seed are always filtered the same way (which TCP workers on
+different hosts rely on).*/
+
+#include <stdio.h>      /*reporting what was dropped*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs, frees and the generator*/
+
+#include "weight.h"     /*the adjacency matrix holds weights*/
+#include "algorithm.h"  /*edges are compared by their keys, as in GHS*/
+#include "kruskal.h"    /*the sample's forest*/
+
+/*Index of no edge at all, for nodes with no path to the source*/
+#define FILTER_NONE 0xFFFF
+
+/*Drops every edge of the network with the given adjacency matrix that is
+F-heavy for the forest of a sample of it, as described above, sampling with the
+given seed. Returns how many edges were dropped*/
+uint32_t filter_edges(weight_t *edges, uint8_t num_nodes, uint32_t seed);
+
+/*Returns which edges are in the minimum spanning forest of a sample of the
+network, as a matrix of flags, sampling every edge with probability 1/2*/
+uint8_t *sample_forest(weight_t *edges, uint8_t num_nodes, uint32_t seed);
+
+/*Stores, for every node, the index in the adjacency matrix of the heaviest
+edge on its path in the forest to the source, or FILTER_NONE if it has none*/
+void path_maxima(uint8_t *forest, weight_t *edges, uint8_t num_nodes,
+                                        uint8_t source, uint16_t *heaviest);
+
+/*Returns the key of the edge at the given index of the adjacency matrix*/
+struct edge_key index_key(weight_t *edges, uint8_t num_nodes, uint16_t index);
+
+/*Prints how many edges filtering dropped, out of how many there were, and how
+long it took*/
+void print_filtering(weight_t *edges, uint8_t num_nodes, uint32_t dropped,
+                                                    double secs, FILE *stream);
+
+#endif /* FILTER_H */
@@ -0,0 +1,73 @@
+#include "forest.h"
+
+uint8_t find_components(weight_t *edges, uint8_t num_nodes, uint8_t *comp) {
+  uint8_t *queue = malloc(num_nodes*sizeof(uint8_t));
+  uint16_t i, j, head, tail;
+  uint8_t trees = 0;
+
+  for (i = 0; i < num_nodes; i++) {
+    comp[i] = num_nodes;
+  }
+
+  /*every node nobody reached yet starts a component, breadth first*/
+  for (i = 0; i < num_nodes; i++) {
+    if (comp[i] != num_nodes) {
+      continue;
+    }
+    comp[i] = trees;
+    queue[0] = i;
+    for (head = 0, tail = 1; head < tail; head++) {
+      for (j = 0; j < num_nodes; j++) {
+        if (edges[queue[head]*num_nodes + j] != 0 && comp[j] == num_nodes) {
+          comp[j] = trees;
+          queue[tail++] = j;
+        }
+      }
+    }
+    trees++;
+  }
+
+  free(queue);
+  return trees;
+}
+
+void print_forest(struct mst_result *res, uint8_t *comp, uint8_t trees,
+                                                                FILE *stream) {
+  uint32_t *sizes = calloc(trees, sizeof(uint32_t));
+  uint32_t *branches = calloc(trees, sizeof(uint32_t));
+  uint32_t *done = calloc(trees, sizeof(uint32_t));
+  double *finished = calloc(trees, sizeof(double));
+  double first = -1, last = 0;
+  uint32_t i, single = 0, whole = 0;
+
+  /*a tree is done when the last of its nodes is*/
+  for (i = 0; i < res->num_nodes; i++) {
+    sizes[comp[i]]++;
+    if (res->finished[i] > 0) {
+      done[comp[i]]++;
+      if (res->finished[i] > finished[comp[i]]) {
+        finished[comp[i]] = res->finished[i];
+      }
+    }
+  }
+  for (i = 0; i < res->num_edges; i++) {
+    branches[comp[res->edges[i].u]]++;
+  }
+
+  for (i = 0; i < trees; i++) {
+    single += (sizes[i] == 1);
+    if (done[i] == sizes[i] && branches[i] == sizes[i] - 1) {
+      whole++;
+      first = (first < 0 || finished[i] < first) ? finished[i] : first;
+      last = (finished[i] > last) ? finished[i] : last;
+    }
+  }
+
+  fprintf(stream, "Forest: %u trees (%u single nodes), %u whole, done between"
+                  " %.3fs and %.3fs\n", trees, single, whole,
+                  (first < 0) ? 0 : first, last);
+  free(sizes);
+  free(branches);
+  free(done);
+  free(finished);
+}
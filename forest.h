@@ -0,0 +1,33 @@
+#ifndef FOREST_H
+#define FOREST_H
+
+/*This file implements what the parent needs to know about networks that aren't
+connected, whose MST is really a forest: one tree per component. Nodes don't
+need to know at all, since GHS already runs every component on its own. A
+fragment's core only ever hears about edges that leave the fragment, so once a
+component is a single fragment its core finds nothing outgoing, and tells the
+rest of the component it's over, same as it would for the whole network. Every
+component is thus an independent run of GHS (or Borůvka), all of them going at
+once, and a node with no neighbours at all is a tree of its own from the start.
+What the parent does is find the components up front, so that it can tell
+when each of them is done, and whether each tree came out whole.*/
+
+#include <stdio.h>      /*reporting the trees*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+
+#include "weight.h"     /*the adjacency matrix holds weights*/
+#include "results.h"    /*trees come out of the results*/
+
+/*Finds the components of the network with the given adjacency matrix, and
+stores the one each node is in, numbered by their lowest node. Returns how
+many there are*/
+uint8_t find_components(weight_t *edges, uint8_t num_nodes, uint8_t *comp);
+
+/*Prints how many trees the results make up, how many of them are single nodes,
+how many came out whole (every node done, and one edge less than nodes), and
+when the first and the last of them were done*/
+void print_forest(struct mst_result *res, uint8_t *comp, uint8_t trees,
+                                                                FILE *stream);
+
+#endif /* FOREST_H */
@@ -0,0 +1,117 @@
+#include "histogram.h"
+
+/*names of the metrics and message types, for printing, in the order of
+HIST_METRICS and MSG_TYPES*/
+char *metric_names[HIST_METRICS] = {"queue residence (us)", "handler (cycles)"};
+char *msg_names[HIST_TYPES] = {"connect", "initiate", "test", "accept",
+                                      "reject", "chgroot", "report", "other"};
+
+uint32_t hist_bucket(uint64_t value) {
+  uint32_t exp;
+
+  /*small values get a bucket each*/
+  if (value < (1 << HIST_SUB_BITS)) {
+    return value;
+  }
+
+  /*otherwise, the position of the leading bit picks the power of two, and the
+  bits right after it pick the sub-bucket*/
+  exp = 63 - __builtin_clzll(value);
+  return ((exp - HIST_SUB_BITS + 1) << HIST_SUB_BITS) +
+              ((value >> (exp - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1));
+}
+
+uint64_t hist_bucket_value(uint32_t bucket) {
+  uint32_t exp, sub;
+
+  if (bucket < (1 << HIST_SUB_BITS)) {
+    return bucket;
+  }
+
+  exp = (bucket >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+  sub = bucket & ((1 << HIST_SUB_BITS) - 1);
+  return ((uint64_t) ((1 << HIST_SUB_BITS) + sub)) << (exp - HIST_SUB_BITS);
+}
+
+void hist_add(struct histogram *hist, uint64_t value) {
+  hist->buckets[hist_bucket(value)]++;
+  hist->count++;
+  hist->sum += value;
+  if (value > hist->max) {
+    hist->max = value;
+  }
+}
+
+void hist_merge(struct histogram *into, struct histogram *from) {
+  uint32_t i;
+
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    into->buckets[i] += from->buckets[i];
+  }
+  into->count += from->count;
+  into->sum += from->sum;
+  if (from->max > into->max) {
+    into->max = from->max;
+  }
+}
+
+uint64_t hist_percentile(struct histogram *hist, double percentile) {
+  uint64_t seen = 0, rank;
+  uint32_t i;
+
+  if (hist->count == 0) {
+    return 0;
+  }
+
+  /*rank of the value we're after, counting from 1*/
+  rank = (uint64_t) (percentile / 100 * hist->count + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= rank) {
+      /*the bucket's bound may well be above anything we actually saw*/
+      return (seen == hist->count) ? hist->max : hist_bucket_value(i);
+    }
+  }
+
+  return hist->max;
+}
+
+uint64_t cycle_count() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void print_histograms(struct histogram hists[HIST_METRICS][HIST_TYPES],
+                                                                FILE *stream) {
+  uint32_t metric, type;
+
+  for (metric = 0; metric < HIST_METRICS; metric++) {
+    /*residence is measured in nanoseconds, but microseconds read better*/
+    double scale = (metric == HIST_RESIDENCE) ? 1e-3 : 1;
+
+    fprintf(stream, "%-22s %8s %10s %10s %10s %10s %10s\n",
+              metric_names[metric], "n", "mean", "p50", "p90", "p99", "max");
+    for (type = 0; type < HIST_TYPES; type++) {
+      struct histogram *hist = &hists[metric][type];
+      if (hist->count == 0) {
+        continue;
+      }
+      fprintf(stream, "  %-20s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+              msg_names[type], (unsigned long long) hist->count,
+              scale * hist->sum / hist->count,
+              scale * hist_percentile(hist, 50),
+              scale * hist_percentile(hist, 90),
+              scale * hist_percentile(hist, 99), scale * hist->max);
+    }
+  }
+}
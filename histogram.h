@@ -0,0 +1,81 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+/*This file implements log-bucketed histograms, in the spirit of HdrHistogram:
+every power of two is split into a few linear sub-buckets, so a value always
+lands in a bucket no wider than a fraction of itself, while the whole 64-bit
+range fits in a few hundred counters. Histograms are plain structs with a fixed
+size, so recording a value never allocates, and merging two of them is just
+adding their counters, which is what the parent does with the nodes'.
+
+Nodes running with GHS_HISTOGRAMS keep one per message type for how long messages
+sat in their queue, and one for how long each handler took, and send them to
+the parent when they terminate.*/
+
+#include <stdio.h>      /*printing distributions*/
+#include <stdint.h>     /*counters are wide*/
+#include <string.h>     /*memsets*/
+#include <time.h>       /*the fallback for the cycle counter*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  /*the actual cycle counter*/
+#endif
+
+/*Each power of two is split into 2^HIST_SUB_BITS buckets, so bucket bounds are
+within 25% of the values in them*/
+#define HIST_SUB_BITS 2
+#define HIST_BUCKETS (64 << HIST_SUB_BITS)
+
+/*Message types we keep histograms for, which covers every GHS message*/
+#define HIST_TYPES 8
+
+/*What the nodes measure, for every message type:
+  residence -> time from a message being enqueued to it being dequeued, in
+               nanoseconds
+  handler   -> time spent handling the message, in cycles of the timestamp
+               counter (nanoseconds where there's no such thing)*/
+enum HIST_METRICS {
+  HIST_RESIDENCE = 0,
+  HIST_HANDLER,
+  HIST_METRICS
+};
+
+/*A histogram.
+  count   -> number of values recorded
+  sum     -> sum of the values recorded
+  max     -> largest value recorded
+  buckets -> how many values fell in each bucket*/
+struct histogram {
+  uint64_t count;
+  uint64_t sum;
+  uint64_t max;
+  uint32_t buckets[HIST_BUCKETS];
+};
+
+/*Returns the bucket the given value falls in*/
+uint32_t hist_bucket(uint64_t value);
+
+/*Returns the smallest value that falls in the given bucket*/
+uint64_t hist_bucket_value(uint32_t bucket);
+
+/*Records a value in the given histogram*/
+void hist_add(struct histogram *hist, uint64_t value);
+
+/*Adds every value recorded in from to into*/
+void hist_merge(struct histogram *into, struct histogram *from);
+
+/*Returns the value at the given percentile (0 to 100) of the histogram, as the
+lowest value of the bucket it falls in (or the maximum, for the last one)*/
+uint64_t hist_percentile(struct histogram *hist, double percentile);
+
+/*Returns the current value of the cycle counter. On anything but x86 this is
+the monotonic clock, in nanoseconds*/
+uint64_t cycle_count();
+
+/*Prints the distribution (count, mean, median, 90th and 99th percentiles and
+maximum) of each metric for each message type to the given stream. hists is
+indexed by metric and then by message type, and empty histograms are skipped*/
+void print_histograms(struct histogram hists[HIST_METRICS][HIST_TYPES],
+                                                                FILE *stream);
+
+#endif /* HISTOGRAM_H */
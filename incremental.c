@@ -0,0 +1,620 @@
+#include "incremental.h"
+
+void ghs_incremental(struct node *node) {
+  struct node_data node_data;
+  struct inc_data inc_data;
+  struct inc_update none;
+  uint8_t outmsg[50], len;
+
+  /*build the tree from scratch first, keeping GHS's final state around*/
+  print_edges(node->neighs, node->log);
+  node_data.options = 0;
+  node_data.replay = 0;
+  find_mst(node, &node_data);
+
+  /*then find out where we are in it: the core's ends find each other by
+  claiming their parents, and our depth comes down from the root. Our parent's
+  REPORT always gets to it before our CLAIM does, so it's done with GHS too*/
+  memset(&inc_data, 0, sizeof(inc_data));
+  memset(&none, 0, sizeof(none));
+  inc_data.depth = INC_NONE;
+  if (node_data.num_neighs == 0) {
+    set_depth(node, &node_data, &inc_data, &none, 0, 0);
+  }
+  else {
+    len = create_inc_msg(MSG_CLAIM, node->id, &none, outmsg);
+    send_msg(node, node_data.branch_sock, outmsg, len);
+  }
+
+  /*then keep it up to date, until the parent is out of updates*/
+  maintain(node, &node_data, &inc_data);
+
+  log_depth(node, &node_data, &inc_data);
+  output(node, &node_data);
+}
+
+void maintain(struct node *node, struct node_data *ndata,
+                                                    struct inc_data *idata) {
+  uint8_t inmsg[50];
+  struct inc_update upd;
+  char logmsg[60];
+
+  while (1) {
+    wait_queue(node->queue);
+    memset(inmsg, 0, 50);
+    dequeue(node->queue, inmsg, NULL);
+
+    /*every incremental message carries the update it belongs to*/
+    upd.id = (inmsg[2] << 8) | inmsg[3];
+    upd.u = inmsg[4];
+    upd.v = inmsg[5];
+    upd.weight = get_weight(&inmsg[6]);
+
+    switch (inmsg[0]) {
+      case MSG_UPDATE: {
+        process_update(node, ndata, idata, &upd);
+        break;
+      }
+      case MSG_LINK: {
+        process_link(node, ndata, idata, &upd, inmsg);
+        break;
+      }
+      case MSG_CLIMB: {
+        process_climb(node, ndata, idata, &upd, inmsg);
+        break;
+      }
+      case MSG_CUT: {
+        cut(node, ndata, idata, &upd, inmsg[INC_HDR_LEN],
+            inmsg[INC_HDR_LEN + 1], inmsg[INC_HDR_LEN + 2],
+            inmsg[INC_HDR_LEN + 3]);
+        break;
+      }
+      case MSG_JOIN: {
+        process_join(node, ndata, idata, &upd);
+        break;
+      }
+      case MSG_TURN: {
+        process_turn(node, ndata, idata, &upd, inmsg);
+        break;
+      }
+      case MSG_CLAIM: {
+        process_claim(node, ndata, idata, inmsg[1]);
+        break;
+      }
+      case MSG_DEPTH: {
+        set_depth(node, ndata, idata, &upd, inmsg[INC_HDR_LEN],
+                                                      inmsg[INC_HDR_LEN + 1]);
+        break;
+      }
+      case MSG_SETTLED: {
+        process_settled(node, ndata, idata, &upd, inmsg[1]);
+        break;
+      }
+      case MSG_STOP: {
+        log_msg("Parent is out of updates, stopping!", node->log);
+        return;
+      }
+      /*GHS is over, but some of its messages might still be in flight*/
+      default: {
+        snprintf(logmsg, 60, "Ignoring stray message of type %d!", inmsg[0]);
+        log_msg(logmsg, node->log);
+        break;
+      }
+    }
+  }
+}
+
+int16_t set_edge(struct node *node, struct node_data *ndata, uint8_t neigh,
+                                                              weight_t weight) {
+  struct edge *link;
+  int16_t index;
+
+  /*existing edges just get their new weight. GHS is done with the list, so it
+  doesn't matter that it might not be sorted anymore*/
+  if ((index = edge_index(node, neigh, &link)) != -1) {
+    link->weight = weight;
+    ndata->arrays.weights[index] = weight;
+    return index;
+  }
+
+  /*new edges go at the end of the list, so the edge status array stays valid.
+  Partitioned nodes route by neighbour ID, so that's also the edge's socket*/
+  append_edge(node->neighs, weight, neigh, neigh);
+  append_edge_arrays(&ndata->arrays, weight, neigh, neigh);
+  ndata->edge_status = realloc(ndata->edge_status, ndata->num_neighs + 1);
+  ndata->edge_status[ndata->num_neighs] = EDGE_REJECT;
+  return ndata->num_neighs++;
+}
+
+void process_update(struct node *node, struct node_data *ndata,
+                        struct inc_data *idata, struct inc_update *upd) {
+  uint8_t outmsg[50], len, tree;
+  struct cycle_edge none = {0, INC_NONE, INC_NONE};
+  char logmsg[60];
+  int16_t index;
+
+  snprintf(logmsg, 60, "Update %d: edge to %d now weighs %" PRIweight, upd->id,
+                                                          upd->v, upd->weight);
+  log_msg(logmsg, node->log);
+
+  /*lighter tree edges stay in the tree, so there's no cycle to look at*/
+  index = set_edge(node, ndata, upd->v, upd->weight);
+  tree = (ndata->edge_status[index] == EDGE_BRANCH);
+
+  /*our mark has to be there before the other endpoint's climb can get here.
+  Then it needs to know about the edge, and how deep we are, to start it*/
+  if (!tree) {
+    idata->marks[0].update = upd->id;
+    idata->marks[0].valid = 1;
+    idata->marks[0].down = INC_NONE;
+    idata->marks[0].max = none;
+  }
+  len = create_inc_msg(MSG_LINK, node->id, upd, outmsg);
+  outmsg[len++] = tree;
+  outmsg[len++] = idata->depth;
+  send_inc_msg(node, upd->v, outmsg, len);
+}
+
+void process_link(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t *msg) {
+  struct cycle_edge none = {0, INC_NONE, INC_NONE};
+  struct result_update done = {upd->id, 0};
+  char logmsg[60];
+
+  snprintf(logmsg, 60, "Update %d: edge to %d now weighs %" PRIweight, upd->id,
+                                                          upd->u, upd->weight);
+  log_msg(logmsg, node->log);
+
+  set_edge(node, ndata, upd->u, upd->weight);
+
+  /*u saw it's a tree edge, so we're the last ones to hear about it*/
+  if (msg[INC_HDR_LEN]) {
+    write_result(node->results, RESULT_UPDATE, node->id, &done, sizeof(done));
+    return;
+  }
+
+  arrive(node, ndata, idata, upd, 1, INC_NONE, none, upd->u,
+                                                          msg[INC_HDR_LEN + 1]);
+}
+
+void process_climb(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t *msg) {
+  struct cycle_edge max;
+
+  max.child = msg[INC_HDR_LEN + 1];
+  max.parent = msg[INC_HDR_LEN + 2];
+  max.weight = get_weight(&msg[INC_HDR_LEN + 5]);
+  arrive(node, ndata, idata, upd, msg[INC_HDR_LEN], msg[1], max,
+                                  msg[INC_HDR_LEN + 3], msg[INC_HDR_LEN + 4]);
+}
+
+void arrive(struct node *node, struct node_data *ndata, struct inc_data *idata,
+            struct inc_update *upd, uint8_t side, uint8_t down,
+            struct cycle_edge max, uint8_t front, uint8_t front_depth) {
+  struct climb_mark *mark = &idata->marks[side];
+  struct climb_mark *other = &idata->marks[!side];
+
+  mark->update = upd->id;
+  mark->valid = 1;
+  mark->down = down;
+  mark->max = max;
+
+  /*the other climb got here first, so this is where the paths meet*/
+  if (other->valid && other->update == upd->id) {
+    resolve(node, ndata, idata, upd);
+    return;
+  }
+
+  advance(node, ndata, idata, upd, side, front, front_depth);
+}
+
+void advance(struct node *node, struct node_data *ndata, struct inc_data *idata,
+            struct inc_update *upd, uint8_t side, uint8_t front,
+                                                        uint8_t front_depth) {
+  struct cycle_edge max = idata->marks[side].max;
+  uint8_t outmsg[50], len;
+  struct edge *link;
+  uint16_t i;
+
+  /*the root is never deeper than anyone, so it always hands over. The front
+  needn't be a neighbour, but partitioned nodes route by ID anyway*/
+  if (idata->depth < front_depth || idata->root) {
+    len = create_inc_msg(MSG_TURN, node->id, upd, outmsg);
+    outmsg[len++] = !side;
+    outmsg[len++] = idata->depth;
+    send_msg(node, front, outmsg, len);
+    return;
+  }
+
+  /*otherwise keep climbing, adding our parent edge to the path*/
+  link = node->neighs->head;
+  for (i = 0; i < ndata->in_branch; i++) {
+    link = link->next;
+  }
+  if (heavier(link->weight, node->id, link->neigh, max.weight, max.child,
+                                                                max.parent)) {
+    max.weight = link->weight;
+    max.child = node->id;
+    max.parent = link->neigh;
+  }
+
+  len = create_inc_msg(MSG_CLIMB, node->id, upd, outmsg);
+  outmsg[len++] = side;
+  outmsg[len++] = max.child;
+  outmsg[len++] = max.parent;
+  outmsg[len++] = front;
+  outmsg[len++] = front_depth;
+  len += put_weight(&outmsg[len], max.weight);
+  send_inc_msg(node, link->neigh, outmsg, len);
+}
+
+void process_turn(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t *msg) {
+  advance(node, ndata, idata, upd, msg[INC_HDR_LEN], msg[1],
+                                                        msg[INC_HDR_LEN + 1]);
+}
+
+void process_claim(struct node *node, struct node_data *ndata,
+                                  struct inc_data *idata, uint8_t sender) {
+  struct inc_update none;
+  struct edge *link;
+  char logmsg[60];
+
+  if (edge_index(node, sender, &link) != ndata->in_branch ||
+                                                          node->id > sender) {
+    return;
+  }
+  idata->root = 1;
+  snprintf(logmsg, 60, "Core neighbour %d claimed us, we're the root!", sender);
+  log_msg(logmsg, node->log);
+  memset(&none, 0, sizeof(none));
+  set_depth(node, ndata, idata, &none, 0, 0);
+}
+
+void set_depth(struct node *node, struct node_data *ndata,
+                struct inc_data *idata, struct inc_update *upd, uint8_t depth,
+                                                                uint8_t force) {
+  uint8_t outmsg[50], len, first = (idata->depth == INC_NONE);
+  struct edge *link;
+  uint16_t i;
+
+  if (idata->depth == depth && !force) {
+    return;
+  }
+  idata->depth = depth;
+
+  len = create_inc_msg(MSG_DEPTH, node->id, upd, outmsg);
+  outmsg[len++] = depth + 1;
+  outmsg[len++] = force;
+  idata->unsettled = 0;
+  link = node->neighs->head;
+  for (i = 0; i < ndata->num_neighs; i++) {
+    if (ndata->edge_status[i] == EDGE_BRANCH &&
+                                      (i != ndata->in_branch || idata->root)) {
+      send_msg(node, link->sock, outmsg, len);
+      idata->unsettled++;
+    }
+    link = link->next;
+  }
+
+  if (first) {
+    write_result(node->results, RESULT_READY, node->id, NULL, 0);
+  }
+
+  /*leaves of a flipped subtree are settled as soon as they have their depth*/
+  if (force && idata->unsettled == 0) {
+    len = create_inc_msg(MSG_SETTLED, node->id, upd, outmsg);
+    send_msg(node, ndata->branch_sock, outmsg, len);
+  }
+}
+
+void process_settled(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t sender) {
+  struct result_update done = {upd->id, 1};
+  uint8_t outmsg[50], len;
+
+  if (--idata->unsettled > 0) {
+    return;
+  }
+
+  /*the changed edge's other end started the wave, so once the endpoint below
+  it settles, the update is done*/
+  if ((node->id == upd->u && sender == upd->v) ||
+                                  (node->id == upd->v && sender == upd->u)) {
+    log_msg("Flipped subtree has its depths, update done!", node->log);
+    write_result(node->results, RESULT_UPDATE, node->id, &done, sizeof(done));
+    return;
+  }
+
+  len = create_inc_msg(MSG_SETTLED, node->id, upd, outmsg);
+  send_msg(node, ndata->branch_sock, outmsg, len);
+}
+
+void log_depth(struct node *node, struct node_data *ndata,
+                                                    struct inc_data *idata) {
+  struct edge *link;
+  char logmsg[60];
+  uint16_t i;
+
+  if (idata->root || ndata->num_neighs == 0) {
+    snprintf(logmsg, 60, "Node %d is a root, %d deep", node->id, idata->depth);
+  }
+  else {
+    link = node->neighs->head;
+    for (i = 0; i < ndata->in_branch; i++) {
+      link = link->next;
+    }
+    snprintf(logmsg, 60, "Node %d is %d deep, under %d", node->id,
+                                                     idata->depth, link->neigh);
+  }
+  log_msg(logmsg, node->globallog);
+}
+
+void resolve(struct node *node, struct node_data *ndata,
+                        struct inc_data *idata, struct inc_update *upd) {
+  struct cycle_edge *max0 = &idata->marks[0].max, *max1 = &idata->marks[1].max;
+  struct result_update done = {upd->id, 0};
+  uint8_t side;
+  char logmsg[60];
+
+  /*the heaviest edge of the cycle is the heaviest of either path*/
+  side = heavier(max1->weight, max1->child, max1->parent, max0->weight,
+                                                  max0->child, max0->parent);
+  struct cycle_edge *max = side ? max1 : max0;
+
+  /*the changed edge is the heaviest of the cycle, so the tree stays put*/
+  if (!heavier(max->weight, max->child, max->parent, upd->weight, upd->u,
+                                                                    upd->v)) {
+    snprintf(logmsg, 60, "Update %d: tree is still minimum", upd->id);
+    log_msg(logmsg, node->log);
+    write_result(node->results, RESULT_UPDATE, node->id, &done, sizeof(done));
+    return;
+  }
+
+  snprintf(logmsg, 60, "Update %d: swapping out %" PRIweight " (%d-%d)", upd->id,
+                                          max->weight, max->child, max->parent);
+  log_msg(logmsg, node->log);
+  cut(node, ndata, idata, upd, side, max->child, max->parent, 0);
+}
+
+void cut(struct node *node, struct node_data *ndata, struct inc_data *idata,
+          struct inc_update *upd, uint8_t side, uint8_t child, uint8_t parent,
+                                                                uint8_t below) {
+  struct climb_mark *mark = &idata->marks[side];
+  uint8_t endpoint = side ? upd->v : upd->u;
+  uint8_t other = side ? upd->u : upd->v;
+  uint8_t outmsg[50], len;
+  struct edge *link;
+  int16_t index;
+
+  /*the heaviest edge is below us, or starts right here*/
+  if (!below) {
+    if (node->id == parent) {
+      ndata->edge_status[edge_index(node, child, &link)] = EDGE_REJECT;
+      log_msg("Rejecting our edge to a former child!", node->log);
+      below = 1;
+    }
+    len = create_inc_msg(MSG_CUT, node->id, upd, outmsg);
+    outmsg[len++] = side;
+    outmsg[len++] = child;
+    outmsg[len++] = parent;
+    outmsg[len++] = below;
+    send_inc_msg(node, mark->down, outmsg, len);
+    return;
+  }
+
+  /*we're below the heaviest edge, so our former parent goes out of the tree
+  if it's the other end of it*/
+  if (node->id == child) {
+    ndata->edge_status[edge_index(node, parent, &link)] = EDGE_REJECT;
+    log_msg("Rejecting our edge to a former parent!", node->log);
+  }
+
+  /*the endpoint now hangs from the changed edge, everyone else from the node
+  the climb came from*/
+  index = edge_index(node, node->id == endpoint ? other : mark->down, &link);
+  ndata->in_branch = index;
+  ndata->branch_sock = link->sock;
+
+  if (node->id == endpoint) {
+    ndata->edge_status[index] = EDGE_BRANCH;
+    len = create_inc_msg(MSG_JOIN, node->id, upd, outmsg);
+    send_inc_msg(node, other, outmsg, len);
+    return;
+  }
+
+  len = create_inc_msg(MSG_CUT, node->id, upd, outmsg);
+  outmsg[len++] = side;
+  outmsg[len++] = child;
+  outmsg[len++] = parent;
+  outmsg[len++] = 1;
+  send_inc_msg(node, mark->down, outmsg, len);
+}
+
+void process_join(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd) {
+  uint8_t endpoint = (node->id == upd->u) ? upd->v : upd->u;
+  uint8_t outmsg[50], len;
+  struct edge *link;
+
+  ndata->edge_status[edge_index(node, endpoint, &link)] = EDGE_BRANCH;
+  log_msg("Changed edge joined the tree!", node->log);
+
+  /*the endpoint's side of the tree now hangs from us, and its depths go down
+  from there. Former parents are children now, so a node whose own depth stays
+  the same may still have children whose depth changed, and the depths go all
+  the way down. The next update's climbs go by them, so this one is only done
+  once the whole subtree has settled*/
+  len = create_inc_msg(MSG_DEPTH, node->id, upd, outmsg);
+  outmsg[len++] = idata->depth + 1;
+  outmsg[len++] = 1;
+  send_msg(node, link->sock, outmsg, len);
+  idata->unsettled = 1;
+}
+
+int16_t edge_index(struct node *node, uint8_t neigh, struct edge **link) {
+  int16_t i = 0;
+
+  for (*link = node->neighs->head; *link != NULL; *link = (*link)->next) {
+    if ((*link)->neigh == neigh) {
+      return i;
+    }
+    i++;
+  }
+
+  return -1;
+}
+
+uint8_t heavier(weight_t w1, uint8_t a1, uint8_t b1, weight_t w2, uint8_t a2,
+                                                                  uint8_t b2) {
+  return compare_keys(make_key(w1, a1, b1), make_key(w2, a2, b2)) > 0;
+}
+
+uint8_t create_inc_msg(uint8_t type, uint8_t sender, struct inc_update *upd,
+                                                              uint8_t *buffer) {
+  buffer[0] = type;
+  buffer[1] = sender;
+  buffer[2] = (upd->id >> 8) & 0xFF;
+  buffer[3] = upd->id & 0xFF;
+  buffer[4] = upd->u;
+  buffer[5] = upd->v;
+
+  return 6 + put_weight(&buffer[6], upd->weight);
+}
+
+void send_inc_msg(struct node *node, uint8_t neigh, uint8_t *msg, uint8_t len) {
+  struct edge *link = find_neigh(node->neighs, neigh);
+
+  if (link == NULL) {
+    fprintf(stderr, "Node %d has no edge to %d!\n", node->id, neigh);
+    return;
+  }
+  send_msg(node, link->sock, msg, len);
+}
+
+uint8_t read_progress(int32_t fd, struct update_progress *prog) {
+  struct result_hdr hdr;
+  struct result_update rec;
+
+  if (!read_full(fd, &hdr, sizeof(hdr)) || hdr.len > sizeof(rec) ||
+      !read_full(fd, &rec, hdr.len)) {
+    return 0;
+  }
+
+  switch (hdr.kind) {
+    case RESULT_READY: {
+      prog->ready++;
+      break;
+    }
+    case RESULT_UPDATE: {
+      prog->done++;
+      prog->swaps += rec.swapped;
+      break;
+    }
+    default: {
+      fprintf(stderr, "Unexpected result record %d from node %d!\n", hdr.kind,
+                                                                      hdr.node);
+      break;
+    }
+  }
+
+  return 1;
+}
+
+uint8_t run_updates(FILE *updates, int32_t results, weight_t *edges,
+                    uint8_t num_nodes, uint32_t *sockets, uint8_t workers,
+                    uint8_t *owners, struct worker_stats *stats,
+                    FILE *globallog) {
+  struct update_progress prog;
+  struct inc_update upd;
+  uint8_t outmsg[50], len;
+  uint64_t before = 0, after = 0;
+  char line[128], kind[16], token[32], logmsg[60];
+  int32_t a, b, i;
+  weight_t w;
+  uint16_t count = 0;
+
+  /*nodes still running GHS, or not knowing how deep they are, wouldn't know
+  what to do with updates*/
+  memset(&prog, 0, sizeof(prog));
+  memset(&upd, 0, sizeof(upd));
+  while (prog.ready < num_nodes) {
+    if (!read_progress(results, &prog)) {
+      fprintf(stderr, "Nodes exited before taking any updates!\n");
+      return 0;
+    }
+  }
+  for (i = 0; i < workers; i++) {
+    before += stats[i].local + stats[i].remote;
+  }
+
+  while (fgets(line, sizeof(line), updates) != NULL) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    if (sscanf(line, "%15s %d %d %31s", kind, &a, &b, token) != 4 ||
+        (strcmp(kind, "insert") && strcmp(kind, "decrease"))) {
+      fprintf(stderr, "Skipping malformed update: %s", line);
+      continue;
+    }
+
+    /*we only ever make the graph cheaper, otherwise a tree edge might have to
+    be replaced by an edge that isn't in the tree, which is a different story*/
+    if (a < 0 || b < 0 || a >= num_nodes || b >= num_nodes || a == b ||
+        !parse_weight(token, &w)) {
+      fprintf(stderr, "Skipping invalid update: %s", line);
+      continue;
+    }
+    weight_t current = edges[a*num_nodes + b];
+    if ((!strcmp(kind, "insert") && current) ||
+        (!strcmp(kind, "decrease") && (!current || w >= current))) {
+      fprintf(stderr, "Skipping update that doesn't %s an edge: %s", kind, line);
+      continue;
+    }
+    edges[a*num_nodes + b] = w;
+    edges[b*num_nodes + a] = w;
+
+    /*u is always the lowest ID, which the nodes rely on to pick sides*/
+    upd.id = count;
+    upd.weight = w;
+    upd.u = a < b ? a : b;
+    upd.v = a < b ? b : a;
+    len = create_inc_msg(MSG_UPDATE, INC_NONE, &upd, outmsg);
+    send_control(sockets, owners, upd.u, outmsg, len);
+    count++;
+
+    /*one update at a time, since cuts move parent edges around*/
+    while (prog.done < count) {
+      if (!read_progress(results, &prog)) {
+        fprintf(stderr, "Nodes exited in the middle of update %d!\n", upd.id);
+        return 0;
+      }
+    }
+  }
+
+  /*let everyone report their final edges*/
+  len = create_inc_msg(MSG_STOP, INC_NONE, &upd, outmsg);
+  for (i = 0; i < num_nodes; i++) {
+    send_control(sockets, owners, i, outmsg, len);
+  }
+
+  for (i = 0; i < workers; i++) {
+    after += stats[i].local + stats[i].remote;
+  }
+  snprintf(logmsg, 60, "%d updates, %u swaps, %lu messages", count, prog.swaps,
+                                                              after - before);
+  log_msg(logmsg, globallog);
+  printf("Updates: %s\n", logmsg);
+
+  return 1;
+}
+
+void send_control(uint32_t *sockets, uint8_t *owners, uint8_t node,
+                                                    uint8_t *msg, uint8_t len) {
+  uint8_t frame[50 + WORKER_HDR_LEN];
+
+  frame[0] = node;
+  frame[1] = WORKER_CONTROLLER;
+  memcpy(frame + WORKER_HDR_LEN, msg, len);
+  send(sockets[2*owners[node] + 1], frame, len + WORKER_HDR_LEN, MSG_NOSIGNAL);
+}
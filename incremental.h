@@ -0,0 +1,262 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+/*This file implements incremental maintenance of the MST. Nodes first run GHS
+as usual, but rather than exiting once it terminates, they hold on to their
+final state (edge status and parent edge) and wait for topology changes sent by
+the parent: edge insertions and weight decreases. Both only ever create a
+single cycle in the current tree, made up of the changed edge and the tree path
+between its endpoints, so repairing the tree means finding the heaviest edge on
+that path and swapping it out for the changed edge, if the latter is lighter.
+
+Each endpoint climbs towards the root of the tree along its parent edges,
+leaving a mark on every node it visits (where it came from, and the heaviest
+edge seen so far). Only one of the climbs moves at a time: the deeper one, which
+takes turns with the other once they're as deep. The first node that gets
+marked by both endpoints is then their lowest common ancestor, which knows the
+heaviest edge of the whole cycle, and neither climb ever goes past it. If that
+edge has to go, a CUT goes back down the marked path, rejecting it and flipping
+the parent edges below it, so that the endpoint on that side now hangs from the
+changed edge. Only the nodes on the cycle are ever messaged, besides those
+that end up under the changed edge when the tree is flipped: they all get their
+new depth, and settle back up to it, before the update is done.
+
+GHS leaves the tree rooted at its core edge, whose endpoints are each other's
+parent. Once done, every node claims its parent with a CLAIM, so the core's
+endpoints find each other, and the one with the lowest ID becomes the root.
+Depths then go down the tree from there, and every node is ready for updates
+once it has its own.
+
+Since new edges may connect any two nodes, this needs a transport where any node
+can reach any other by its ID, which is the case for the partitioned mode.*/
+
+#include <stdio.h>      /*logs and updates files*/
+#include <stdint.h>     /*sized integers everywhere*/
+#include <stdlib.h>     /*reallocs for new edges*/
+#include <string.h>     /*memsets and strcmps*/
+#include <sys/socket.h> /*the parent talks to the workers directly*/
+
+#include "node.h"       /*nodes are who we're repairing*/
+#include "neighlist.h"  /*new edges go into the neighbour lists*/
+#include "algorithm.h"  /*we start off where GHS finished*/
+#include "worker.h"     /*updates are sent through the partitioned workers*/
+#include "results.h"    /*and acknowledged through the results pipe*/
+
+/*Message types for incremental maintenance. They start well after the GHS
+ones, so stray GHS messages are never mistaken for them.*/
+enum INC_MSG_TYPES {
+  MSG_UPDATE = 16,
+  MSG_LINK,
+  MSG_CLIMB,
+  MSG_CUT,
+  MSG_JOIN,
+  MSG_TURN,
+  MSG_CLAIM,
+  MSG_DEPTH,
+  MSG_SETTLED,
+  MSG_STOP
+};
+
+/*All incremental messages start with this many bytes: type, sender ID, update
+number, the changed edge's endpoints, and its new weight*/
+#define INC_HDR_LEN (6 + WEIGHT_LEN)
+
+/*Stands for "nobody", for marks left by the endpoints themselves, and for the
+heaviest edge of an empty path*/
+#define INC_NONE 0xFF
+
+/*An update being processed: its sequence number, and the changed edge, from
+u to v (u always has the lowest ID)*/
+struct inc_update {
+  uint16_t id;
+  weight_t weight;
+  uint8_t u;
+  uint8_t v;
+};
+
+/*A tree edge, seen from below: the child endpoint and the parent endpoint*/
+struct cycle_edge {
+  weight_t weight;
+  uint8_t child;
+  uint8_t parent;
+};
+
+/*The mark a climb leaves on a node.
+  update -> which update the mark belongs to
+  valid  -> whether the mark has been left at all
+  down   -> neighbour the climb came from (INC_NONE at the endpoint)
+  max    -> heaviest edge between the endpoint and this node*/
+struct climb_mark {
+  uint16_t update;
+  uint8_t valid;
+  uint8_t down;
+  struct cycle_edge max;
+};
+
+/*Additional data for maintaining the tree, on top of the GHS node_data.
+  root      -> whether the node is the root of the tree
+  depth     -> how many edges the node is from the root (INC_NONE until known)
+  unsettled -> children yet to settle on their new depth, after a flip
+  marks     -> marks left by the climbs from u (0) and from v (1)*/
+struct inc_data {
+  uint8_t root;
+  uint8_t depth;
+  uint16_t unsettled;
+  struct climb_mark marks[2];
+};
+
+/*Payload of RESULT_UPDATE records, sent by the node that finishes an update.
+  update  -> which update is done
+  swapped -> whether a tree edge was swapped out for the changed edge*/
+struct result_update {
+  uint16_t update;
+  uint8_t swapped;
+};
+
+/*The parent's count of the records it got from the nodes so far.
+  ready  -> nodes done with GHS, that know their depth
+  done   -> updates finished
+  swaps  -> updates that swapped an edge out of the tree*/
+struct update_progress {
+  uint32_t ready;
+  uint32_t done;
+  uint32_t swaps;
+};
+
+/*Entry point for the incremental mode. Runs GHS, claims its parent, then
+maintains the tree until the parent says to stop, and only then
+reports the node's BRANCH edges*/
+void ghs_incremental(struct node *node);
+
+/*Main loop for maintaining the tree, reacting to the parent's updates and the
+other nodes' messages until a STOP arrives*/
+void maintain(struct node *node, struct node_data *ndata,
+                                                    struct inc_data *idata);
+
+/*Processes an UPDATE from the parent, meaning this node is the u endpoint of a
+changed edge. Adds or reweighs the edge, leaves our mark (unless the edge is in
+the tree), and tells v about it, which starts the climbs*/
+void process_update(struct node *node, struct node_data *ndata,
+                        struct inc_data *idata, struct inc_update *upd);
+
+/*Processes a LINK from the u endpoint of a changed edge, meaning this node is
+its v endpoint. Adds or reweighs the edge, then either acknowledges the update
+(if the edge is in the tree) or starts climbing*/
+void process_link(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t *msg);
+
+/*Processes a CLIMB from a child, carrying the climb on*/
+void process_climb(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t *msg);
+
+/*Leaves the mark of a climb on this node. If the other endpoint's climb
+already got here, this is the lowest common ancestor and the cycle is resolved,
+otherwise the climb goes on. Front is where the other climb is, and how deep*/
+void arrive(struct node *node, struct node_data *ndata, struct inc_data *idata,
+            struct inc_update *upd, uint8_t side, uint8_t down,
+            struct cycle_edge max, uint8_t front, uint8_t front_depth);
+
+/*Moves whichever climb is deeper, this node's or the other one at the front,
+up to its parent. This node's climb also goes when they're as deep, since it
+can't be at the lowest common ancestor then, or the other would be too*/
+void advance(struct node *node, struct node_data *ndata, struct inc_data *idata,
+            struct inc_update *upd, uint8_t side, uint8_t front,
+                                                        uint8_t front_depth);
+
+/*Processes a TURN from the node at the front of the other climb, which is
+shallower than ours, so our climb goes on from where it stopped*/
+void process_turn(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t *msg);
+
+/*Processes a CLAIM from a child. Our parent only claims us if we're the two
+ends of the core edge, in which case the one with the lowest ID is the root*/
+void process_claim(struct node *node, struct node_data *ndata,
+                                  struct inc_data *idata, uint8_t sender);
+
+/*Takes the given depth, and passes it on to our children (every neighbour
+in the tree, for the root), unless we had it already and it isn't forced. The
+first depth a node takes also makes it ready for updates. Forced depths come
+down a subtree the given update flipped, and nodes without children settle
+right away, by sending a SETTLED to their parent*/
+void set_depth(struct node *node, struct node_data *ndata,
+                struct inc_data *idata, struct inc_update *upd, uint8_t depth,
+                                                                uint8_t force);
+
+/*Processes a SETTLED from a child, meaning its whole subtree has its new depth.
+Once every child settled, so have we, and we tell our parent, unless we're the
+end of the changed edge that started the depths down, in which case the update
+is done*/
+void process_settled(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd, uint8_t sender);
+
+/*Logs the node's depth and its parent in the global log, once it's out of
+updates, so the final tree can be checked (see check.py)*/
+void log_depth(struct node *node, struct node_data *ndata,
+                                                    struct inc_data *idata);
+
+/*Decides whether the changed edge replaces the heaviest edge of the cycle,
+once both climbs met at this node, and starts cutting it out if so*/
+void resolve(struct node *node, struct node_data *ndata,
+                        struct inc_data *idata, struct inc_update *upd);
+
+/*Processes a CUT travelling down the given side of the cycle. Above the
+heaviest edge it just follows the marks, the parent endpoint rejects the edge,
+and every node below it makes its former child its parent, until the endpoint
+makes the changed edge its parent edge*/
+void cut(struct node *node, struct node_data *ndata, struct inc_data *idata,
+          struct inc_update *upd, uint8_t side, uint8_t child, uint8_t parent,
+                                                                uint8_t below);
+
+/*Processes a JOIN from the other endpoint, which just made the changed edge its
+parent edge. Marks our end as a BRANCH, and forces the endpoint's new depth down
+the subtree now hanging from it. The update is done once it settled*/
+void process_join(struct node *node, struct node_data *ndata,
+          struct inc_data *idata, struct inc_update *upd);
+
+/*Gives the edge to the given neighbour its new weight, adding it to the end of
+the neighbour list (as a REJECT edge) if it doesn't exist yet. Returns the
+index of the edge*/
+int16_t set_edge(struct node *node, struct node_data *ndata, uint8_t neigh,
+                                                              weight_t weight);
+
+/*Returns the index of the edge to the given neighbour in the node's list, and
+stores the edge itself in link. Returns -1 if there is no such edge*/
+int16_t edge_index(struct node *node, uint8_t neigh, struct edge **link);
+
+/*Returns 1 if edge (w1, a1, b1) is heavier than edge (w2, a2, b2). Ties on the
+weight are broken by the endpoints, the same way GHS compares edge keys*/
+uint8_t heavier(weight_t w1, uint8_t a1, uint8_t b1, weight_t w2, uint8_t a2,
+                                                                    uint8_t b2);
+
+/*Creates an incremental message of the given type, filling out the header
+with the update's data. Type-specific fields are written by the caller, after
+the header. Returns the length of the header.*/
+uint8_t create_inc_msg(uint8_t type, uint8_t sender, struct inc_update *upd,
+                                                              uint8_t *buffer);
+
+/*Sends an incremental message to the given neighbour*/
+void send_inc_msg(struct node *node, uint8_t neigh, uint8_t *msg, uint8_t len);
+
+/*Runs in the parent of a partitioned network. Waits for every node to be done
+with GHS, then reads updates from the given stream, one per line, as "insert u
+v weight" or "decrease u v weight", and sends them to the nodes one at a time,
+waiting for each to be done. The connectivity matrix is kept up to date, and
+invalid updates are skipped. Finally tells every node to stop. Sockets holds
+the workers' socket pairs, owners the worker that hosts each node, and stats
+the workers' message counters, so we can report how many messages the updates
+took. Returns 1 on success, 0 otherwise*/
+uint8_t run_updates(FILE *updates, int32_t results, weight_t *edges,
+                    uint8_t num_nodes, uint32_t *sockets, uint8_t workers,
+                    uint8_t *owners, struct worker_stats *stats,
+                    FILE *globallog);
+
+/*Reads a single record from the nodes, counting it in prog. Returns 0 if
+every node is gone, 1 otherwise*/
+uint8_t read_progress(int32_t fd, struct update_progress *prog);
+
+/*Sends a message from the parent to the given node, through the worker that
+hosts it (from owners)*/
+void send_control(uint32_t *sockets, uint8_t *owners, uint8_t node,
+                                                    uint8_t *msg, uint8_t len);
+
+#endif /* INCREMENTAL_H */
@@ -0,0 +1,79 @@
+#include "kruskal.h"
+
+uint16_t *order_edges(weight_t *edges, uint8_t num_nodes, uint8_t *chosen,
+                                                              uint32_t *count) {
+  uint16_t *order = malloc(num_nodes*num_nodes*sizeof(uint16_t));
+  uint32_t i, j, k;
+
+  /*edges come in order of their endpoints already, so sorting them by weight,
+  keeping that order among equal weights, ranks them by key*/
+  *count = 0;
+  for (i = 0; i < num_nodes; i++) {
+    for (j = i + 1; j < num_nodes; j++) {
+      if (!chosen[i*num_nodes + j]) {
+        continue;
+      }
+      weight_t weight = edges[i*num_nodes + j];
+      for (k = *count; k > 0 && edges[order[k-1]] > weight; k--) {
+        order[k] = order[k-1];
+      }
+      order[k] = i*num_nodes + j;
+      (*count)++;
+    }
+  }
+
+  return order;
+}
+
+uint32_t kruskal(weight_t *edges, uint8_t num_nodes, uint8_t *chosen,
+                  uint8_t *local, uint8_t *roots, uint8_t *sizes,
+                  uint16_t *taken) {
+  uint8_t *frozen = calloc(num_nodes, sizeof(uint8_t));
+  uint32_t i, j, k, count, num_taken = 0;
+  uint16_t *order = order_edges(edges, num_nodes, chosen, &count);
+
+  for (i = 0; i < num_nodes; i++) {
+    roots[i] = i;
+    sizes[i] = 1;
+  }
+
+  for (k = 0; k < count; k++) {
+    i = order[k] / num_nodes;
+    j = order[k] % num_nodes;
+
+    /*an edge leading out of what we know freezes our end of it*/
+    if (local != NULL && (!local[i] || !local[j])) {
+      frozen[find_root(roots, local[i] ? i : j)] = 1;
+      continue;
+    }
+
+    uint8_t ri = find_root(roots, i), rj = find_root(roots, j);
+    if (ri == rj || (frozen[ri] && frozen[rj])) {
+      continue;
+    }
+
+    /*the smaller fragment goes under the bigger one, which is frozen if either
+    of them was*/
+    if (sizes[ri] < sizes[rj]) {
+      uint8_t aux = ri;
+      ri = rj;
+      rj = aux;
+    }
+    roots[rj] = ri;
+    sizes[ri] += sizes[rj];
+    frozen[ri] |= frozen[rj];
+    taken[num_taken++] = order[k];
+  }
+
+  free(order);
+  free(frozen);
+  return num_taken;
+}
+
+uint8_t find_root(uint8_t *roots, uint8_t node) {
+  while (roots[node] != node) {
+    roots[node] = roots[roots[node]];
+    node = roots[node];
+  }
+  return node;
+}
@@ -0,0 +1,42 @@
+#ifndef KRUSKAL_H
+#define KRUSKAL_H
+
+/*This file implements Kruskal's algorithm, for the parent and the workers to
+find pieces of the MST on their own, before any node runs: the partitioned
+workers contracting their nodes (see contract.h), and the parent filtering out
+edges a sample of the network proves heavy (see filter.h). Edges go lightest
+first, ranked as GHS ranks them (by weight, then by their endpoints' IDs), so
+whatever Kruskal takes is what GHS would.
+Kruskal may also run on a part of the network, knowing only some of its nodes.
+An edge with just one end among the local nodes can't be taken, but it freezes
+the fragment on that end: the edge may well be the fragment's lightest outgoing
+edge, so no heavier one can be trusted to be. Two frozen fragments never merge,
+but one that isn't frozen still takes its next edge, even into a frozen
+fragment, since that edge is its lightest outgoing edge. Whatever is taken is
+thus part of the MST of the whole network.*/
+
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+
+#include "weight.h"     /*the adjacency matrix holds weights*/
+
+/*Returns the index in the adjacency matrix (i*num_nodes + j, with i < j) of
+every edge flagged in chosen, in the order GHS ranks them, and stores how many
+there are in count*/
+uint16_t *order_edges(weight_t *edges, uint8_t num_nodes, uint8_t *chosen,
+                                                              uint32_t *count);
+
+/*Runs Kruskal over the edges flagged in chosen, as described above, where
+local flags the nodes known (NULL if all of them are), and every edge chosen
+has at least one end among them. Roots and sizes hold the union-find once done
+(see find_root()), and taken the index of every edge taken, in the order it was
+taken. Returns how many edges were taken*/
+uint32_t kruskal(weight_t *edges, uint8_t num_nodes, uint8_t *chosen,
+                  uint8_t *local, uint8_t *roots, uint8_t *sizes,
+                  uint16_t *taken);
+
+/*Returns the root of the given node's fragment, in Kruskal's union-find,
+halving the path to it on the way*/
+uint8_t find_root(uint8_t *roots, uint8_t node);
+
+#endif /* KRUSKAL_H */
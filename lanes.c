@@ -0,0 +1,173 @@
+#include "lanes.h"
+
+struct lanes *init_lanes(const uint8_t *lane_of) {
+  struct lanes *lanes = calloc(1, sizeof(struct lanes));
+  uint8_t i;
+
+  /*lanes past the last one would never be taken from*/
+  for (i = 0; i < LANES_MAX; i++) {
+    lanes->lane_of[i] = (lane_of[i] < LANES_MAX) ? lane_of[i] : LANES_MAX - 1;
+  }
+
+  return lanes;
+}
+
+void fill_lanes(struct lanes *lanes, struct msgqueue *queue) {
+  struct msg *msg = dequeue_all(queue), *next;
+  uint8_t lane;
+
+  for (; msg != NULL; msg = next) {
+    next = msg->next;
+    msg->next = NULL;
+
+    /*number the message among those from its sender, counting from 1*/
+    msg->seq = ++lanes->arrived[msg_sender(msg)];
+
+    lane = msg_lane(lanes, msg);
+    if (lanes->back[lane] == NULL) {
+      lanes->front[lane] = msg;
+    }
+    else {
+      lanes->back[lane]->next = msg;
+    }
+    lanes->back[lane] = msg;
+  }
+}
+
+uint32_t dequeue_lanes(struct lanes *lanes, uint8_t *buffer, uint64_t *stamp) {
+  struct msg *msg, *prev;
+  uint8_t lane;
+  uint32_t len;
+
+  for (lane = 0; lane < LANES_MAX; lane++) {
+    /*the oldest message in the lane that its sender doesn't have any older
+    message ahead of*/
+    for (prev = NULL, msg = lanes->front[lane]; msg != NULL;
+                                                  prev = msg, msg = msg->next) {
+      if (msg->seq == lanes->taken[msg_sender(msg)] + 1) {
+        break;
+      }
+    }
+    if (msg == NULL) {
+      continue;
+    }
+
+    /*unlink it, updating both ends of the lane if necessary*/
+    if (prev == NULL) {
+      lanes->front[lane] = msg->next;
+    }
+    else {
+      prev->next = msg->next;
+    }
+    if (lanes->back[lane] == msg) {
+      lanes->back[lane] = prev;
+    }
+    lanes->taken[msg_sender(msg)]++;
+
+    len = msg->len;
+    if (buffer != NULL) {
+      memcpy(buffer, msg->str, len);
+    }
+    if (stamp != NULL) {
+      *stamp = msg->stamp;
+    }
+    free(msg->str);
+    free(msg);
+    return len;
+  }
+
+  /*whatever is left is waiting on parked messages from the same senders, so
+  those get tried again first, as they would at the front of the queue*/
+  if (lanes->parked != NULL) {
+    unpark_msgs(lanes);
+    return dequeue_lanes(lanes, buffer, stamp);
+  }
+
+  return 0;
+}
+
+uint8_t lanes_empty(struct lanes *lanes) {
+  uint8_t lane;
+
+  for (lane = 0; lane < LANES_MAX; lane++) {
+    if (lanes->front[lane] != NULL) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+void park_msg(struct lanes *lanes, uint8_t *str, uint32_t len, uint64_t stamp) {
+  struct msg *msg = malloc(sizeof(struct msg));
+
+  msg->str = malloc(len*sizeof(uint8_t));
+  memcpy(msg->str, str, len);
+  msg->len = len;
+  msg->stamp = stamp;
+  msg->next = NULL;
+
+  /*it's as good as a message that just arrived, so it goes after whatever its
+  sender already sent*/
+  msg->seq = ++lanes->arrived[msg_sender(msg)];
+
+  if (lanes->last == NULL) {
+    lanes->parked = msg;
+  }
+  else {
+    lanes->last->next = msg;
+  }
+  lanes->last = msg;
+}
+
+void unpark_msgs(struct lanes *lanes) {
+  struct msg *front[LANES_MAX] = {NULL}, *back[LANES_MAX] = {NULL};
+  struct msg *msg, *next;
+  uint8_t lane;
+
+  /*sort the parked messages by lane first, keeping their order...*/
+  for (msg = lanes->parked; msg != NULL; msg = next) {
+    next = msg->next;
+    msg->next = NULL;
+    lane = msg_lane(lanes, msg);
+    if (back[lane] == NULL) {
+      front[lane] = msg;
+    }
+    else {
+      back[lane]->next = msg;
+    }
+    back[lane] = msg;
+  }
+  lanes->parked = lanes->last = NULL;
+
+  /*...then put each lane's ahead of whatever is already in it*/
+  for (lane = 0; lane < LANES_MAX; lane++) {
+    if (front[lane] == NULL) {
+      continue;
+    }
+    back[lane]->next = lanes->front[lane];
+    if (lanes->back[lane] == NULL) {
+      lanes->back[lane] = back[lane];
+    }
+    lanes->front[lane] = front[lane];
+  }
+}
+
+void free_lanes(struct lanes *lanes) {
+  /*parked messages go back in the lanes, so they're freed along with them*/
+  unpark_msgs(lanes);
+  while (!lanes_empty(lanes)) {
+    dequeue_lanes(lanes, NULL, NULL);
+  }
+  free(lanes);
+}
+
+uint8_t msg_lane(struct lanes *lanes, struct msg *msg) {
+  return lanes->lane_of[(msg->str[0] < LANES_MAX) ? msg->str[0] :
+                                                                LANES_MAX - 1];
+}
+
+uint8_t msg_sender(struct msg *msg) {
+  /*IDs take bytes 1 and 2, but never need more than the second*/
+  return (msg->len < 3) ? 0 : msg->str[2];
+}
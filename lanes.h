@@ -0,0 +1,85 @@
+#ifndef LANES_H
+#define LANES_H
+
+/*This file implements the lanes a node can sort its messages into, so that it
+handles them by priority rather than in the order they arrived. Every message
+type goes into one of the lanes, and the node always takes the oldest message it
+can from the first lane that has any. A message can only be taken once every
+message that arrived before it from the same sender has been, since GHS counts
+on every edge delivering messages in the order they were sent.
+Messages the node can't act on yet are parked apart, rather than put back in
+their lane: whether a node can act on a message only changes when it handles
+some other message, so trying them again any sooner would only defer them once
+more. Once the node handles a message it could act on, they go back to the
+front of their lanes, in the order they were parked. Parking a message counts
+as it arriving again, same as putting it back at the end of the queue, so the
+messages its sender sends after that still wait for it (and if there's nothing
+else to take, it gets tried again right away).*/
+
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*copying messages in and out*/
+
+#include "msgqueue.h"   /*where messages come from*/
+
+/*Most lanes a node can have. Message types past the last lane go in it*/
+#define LANES_MAX 8
+
+/*Node IDs are a single byte, so this is as many senders as there can be*/
+#define LANES_SENDERS 256
+
+/*A node's lanes, and the messages parked apart from them.
+  lane_of -> lane each message type goes in, 0 being the first one taken from
+  front   -> oldest message in each lane
+  back    -> newest message in each lane
+  parked  -> oldest message parked
+  last    -> newest message parked
+  arrived -> how many messages from each sender went into the lanes (or were
+             parked), which is how messages are numbered (in their seq)
+  taken   -> how many of those have been taken out of the lanes, so the next
+             one from each sender is the one numbered taken + 1*/
+struct lanes {
+  uint8_t lane_of[LANES_MAX];
+  struct msg *front[LANES_MAX];
+  struct msg *back[LANES_MAX];
+  struct msg *parked;
+  struct msg *last;
+  uint32_t arrived[LANES_SENDERS];
+  uint32_t taken[LANES_SENDERS];
+};
+
+/*Initializes empty lanes, where messages of type t go in lane lane_of[t]*/
+struct lanes *init_lanes(const uint8_t *lane_of);
+
+/*Moves every message in the queue to the back of its lane, without waiting for
+any to arrive*/
+void fill_lanes(struct lanes *lanes, struct msgqueue *queue);
+
+/*Takes the next message out of the lanes and copies it to the given buffer, as
+dequeue() does. Returns the length of the message (0 if the lanes are empty). If
+stamp isn't NULL, it gets the time the message was enqueued (or parked) at.
+If every message in the lanes is waiting on a parked one, the parked ones go
+back in the lanes first*/
+uint32_t dequeue_lanes(struct lanes *lanes, uint8_t *buffer, uint64_t *stamp);
+
+/*Returns 1 if there are no messages in the lanes (parked ones don't count), 0
+otherwise*/
+uint8_t lanes_empty(struct lanes *lanes);
+
+/*Parks a message the node couldn't act on, stamped anew with the given stamp
+(see queue_stamp())*/
+void park_msg(struct lanes *lanes, uint8_t *str, uint32_t len, uint64_t stamp);
+
+/*Puts every parked message back at the front of its lane*/
+void unpark_msgs(struct lanes *lanes);
+
+/*Returns the lane the given message goes in, by its type (its first byte)*/
+uint8_t msg_lane(struct lanes *lanes, struct msg *msg);
+
+/*Returns the ID of the node that sent the given message*/
+uint8_t msg_sender(struct msg *msg);
+
+/*Frees the lanes, along with every message still in them (or parked)*/
+void free_lanes(struct lanes *lanes);
+
+#endif /* LANES_H */
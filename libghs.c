@@ -0,0 +1,245 @@
+#include "libghs.h"
+#include "worker.h"     /*graphs run on a worker of their own*/
+#include "algorithm.h"  /*whose nodes run GHS*/
+#include "boruvka.h"    /*or Borůvka*/
+#include "forest.h"     /*on every component of the graph*/
+#include "filter.h"     /*with fewer edges, if need be*/
+
+/*A runner is a partitioned worker with the whole network to itself, like the
+workers of batch mode.
+  nodes   -> the nodes, indexed by ID (NULL until a graph needs them)
+  worker  -> the worker hosting the nodes
+  stats   -> the worker's message counters
+  results -> the pipe nodes report their results on, reading end first
+  edges   -> the connectivity matrix of the graph being run
+  routes  -> where each node's edges lead, which are just neighbour IDs*/
+struct ghs_runner {
+  struct node *nodes[GHS_MAX_NODES];
+  struct worker worker;
+  struct worker_stats stats;
+  int32_t results[2];
+  weight_t *edges;
+  uint32_t *routes;
+};
+
+/*What nodes run for each of the GHS_ENGINES, and the GHS_OPTIONS they run it
+with*/
+void (*engine_algos[GHS_ENGINES]) (struct node *node) = {&ghs, &ghs, &ghs,
+                                                                  &boruvka};
+uint8_t engine_opts[GHS_ENGINES] = {0, GHS_LEAN, GHS_SPECULATE, 0};
+
+struct ghs_graph *ghs_init_graph(uint32_t num_nodes) {
+  struct ghs_graph *graph;
+
+  if (num_nodes > GHS_MAX_NODES) {
+    return NULL;
+  }
+
+  graph = malloc(sizeof(struct ghs_graph));
+  graph->num_nodes = num_nodes;
+  graph->num_edges = 0;
+  graph->max_edges = 0;
+  graph->edges = NULL;
+  return graph;
+}
+
+uint8_t ghs_add_edge(struct ghs_graph *graph, uint32_t u, uint32_t v,
+                                                            weight_t weight) {
+  if (u >= graph->num_nodes || v >= graph->num_nodes || u == v ||
+                                                        !valid_weight(weight)) {
+    return 0;
+  }
+
+  /*edges are added one at a time, so grow by doubling*/
+  if (graph->num_edges == graph->max_edges) {
+    graph->max_edges = graph->max_edges ? 2*graph->max_edges : 16;
+    graph->edges = realloc(graph->edges,
+                                graph->max_edges*sizeof(struct ghs_edge));
+  }
+  graph->edges[graph->num_edges].u = u;
+  graph->edges[graph->num_edges].v = v;
+  graph->edges[graph->num_edges].weight = weight;
+  graph->num_edges++;
+  return 1;
+}
+
+const char *ghs_check_graph(struct ghs_graph *graph) {
+  uint8_t seen[GHS_MAX_NODES*GHS_MAX_NODES];
+  uint32_t n = graph->num_nodes, i;
+
+  if (n < 2 || n > GHS_MAX_NODES) {
+    return "bad number of nodes";
+  }
+
+  memset(seen, 0, n*n);
+  for (i = 0; i < graph->num_edges; i++) {
+    struct ghs_edge *edge = &graph->edges[i];
+    if (edge->u >= n || edge->v >= n || edge->u == edge->v) {
+      return "bad endpoints";
+    }
+    if (!valid_weight(edge->weight)) {
+      return "bad weight";
+    }
+    if (seen[edge->u*n + edge->v]) {
+      return "repeated edges";
+    }
+    seen[edge->u*n + edge->v] = seen[edge->v*n + edge->u] = 1;
+  }
+
+  return NULL;
+}
+
+void ghs_free_graph(struct ghs_graph *graph) {
+  free(graph->edges);
+  free(graph);
+}
+
+struct ghs_runner *ghs_init_runner() {
+  struct ghs_runner *runner;
+
+  runner = malloc(sizeof(struct ghs_runner));
+
+  /*nodes report to us through a pipe that lasts as long as we do*/
+  if (pipe(runner->results) == -1) {
+    free(runner);
+    return NULL;
+  }
+
+  /*a worker with the whole network to itself, so messages never leave it*/
+  memset(runner->nodes, 0, sizeof(runner->nodes));
+  memset(&runner->stats, 0, sizeof(runner->stats));
+  runner->worker.id = 0;
+  runner->worker.workers = 1;
+  runner->worker.inbox = -1;
+  runner->worker.outboxes = NULL;
+  runner->worker.nodes = runner->nodes;
+  runner->worker.stats = &runner->stats;
+
+  runner->edges = malloc(GHS_MAX_NODES*GHS_MAX_NODES*sizeof(weight_t));
+  runner->routes = malloc(GHS_MAX_NODES*GHS_MAX_NODES*sizeof(uint32_t));
+  return runner;
+}
+
+uint8_t ghs_run(struct ghs_runner *runner, struct ghs_graph *graph,
+                            struct ghs_config *config, struct ghs_mst *mst) {
+  struct ghs_config plain = {GHS_ENGINE_GHS, NULL, 0};
+  struct node_edge *adj;
+  struct mst_result res;
+  uint32_t *offsets, i, n = graph->num_nodes, filtered = 0;
+  uint8_t comp[GHS_MAX_NODES];
+
+  if (config == NULL) {
+    config = &plain;
+  }
+  if (config->engine >= GHS_ENGINES || ghs_check_graph(graph) != NULL) {
+    return 0;
+  }
+
+  /*same matrices as everyone else uses, routes are just neighbour IDs*/
+  memset(runner->edges, 0, n*n*sizeof(weight_t));
+  for (i = 0; i < graph->num_edges; i++) {
+    struct ghs_edge *edge = &graph->edges[i];
+    runner->edges[edge->u*n + edge->v] = edge->weight;
+    runner->edges[edge->v*n + edge->u] = edge->weight;
+  }
+  for (i = 0; i < n*n; i++) {
+    runner->routes[i] = i % n;
+  }
+  if (config->filter != 0) {
+    filtered = filter_edges(runner->edges, n, config->filter);
+  }
+
+  adj = build_adjacency(runner->edges, runner->routes, n, &offsets);
+
+  /*reuse whichever nodes we already have, only create the missing ones. Nodes
+  never get logs of their own, only the one in the config*/
+  runner->worker.num_nodes = n;
+  for (i = 0; i < n; i++) {
+    struct node *node = runner->nodes[i];
+    if (node == NULL) {
+      node = init_node(i, &adj[offsets[i]], offsets[i+1] - offsets[i],
+                                                    TRANSPORT_PART, 0, NULL);
+      node->worker = &runner->worker;
+      node->results = runner->results[1];
+      node->delays = 0;
+      runner->nodes[i] = node;
+    }
+    else {
+      reset_node(node, &adj[offsets[i]], offsets[i+1] - offsets[i]);
+    }
+    node->globallog = config->log;
+    node->algo_opts = engine_opts[config->engine];
+  }
+  free(adj);
+  free(offsets);
+
+  /*run the graph, collecting results as they come so the pipe never fills*/
+  pthread_t tids[n];
+  struct node_thread_data tdata[n];
+  memset(&runner->stats, 0, sizeof(runner->stats));
+  double start = mono_time();
+  for (i = 0; i < n; i++) {
+    tdata[i].node = runner->nodes[i];
+    tdata[i].algo = engine_algos[config->engine];
+    pthread_create(&tids[i], NULL, node_thread, (void*)&tdata[i]);
+  }
+  collect_results(runner->results[0], n, start, &res);
+  for (i = 0; i < n; i++) {
+    pthread_join(tids[i], NULL);
+  }
+
+  mst->num_nodes = n;
+  mst->trees = find_components(runner->edges, n, comp);
+  mst->num_edges = res.num_edges;
+  mst->edges = malloc((res.num_edges + 1)*sizeof(struct ghs_edge));
+  for (i = 0; i < res.num_edges; i++) {
+    mst->edges[i].u = res.edges[i].u;
+    mst->edges[i].v = res.edges[i].v;
+    mst->edges[i].weight = res.edges[i].weight;
+  }
+  mst->total = res.total;
+  mst->done = res.done;
+  mst->mismatched = res.mismatched;
+  mst->secs = res.secs;
+  mst->messages = runner->stats.local + runner->stats.remote;
+  mst->avoided = res.avoided;
+  mst->filtered = filtered;
+  free_results(&res);
+  return 1;
+}
+
+void ghs_free_runner(struct ghs_runner *runner) {
+  uint32_t i;
+
+  for (i = 0; i < GHS_MAX_NODES; i++) {
+    if (runner->nodes[i] != NULL) {
+      /*whoever gave us the log may well have closed it by now*/
+      runner->nodes[i]->globallog = NULL;
+      free_node(runner->nodes[i]);
+    }
+  }
+  close(runner->results[0]);
+  close(runner->results[1]);
+  free(runner->routes);
+  free(runner->edges);
+  free(runner);
+}
+
+uint8_t ghs_mst(struct ghs_graph *graph, struct ghs_config *config,
+                                                        struct ghs_mst *mst) {
+  struct ghs_runner *runner;
+  uint8_t ret;
+
+  if ((runner = ghs_init_runner()) == NULL) {
+    return 0;
+  }
+  ret = ghs_run(runner, graph, config, mst);
+  ghs_free_runner(runner);
+  return ret;
+}
+
+void ghs_free_mst(struct ghs_mst *mst) {
+  free(mst->edges);
+  mst->edges = NULL;
+  mst->num_edges = 0;
+}
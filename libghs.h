@@ -0,0 +1,162 @@
+#ifndef LIBGHS_H
+#define LIBGHS_H
+
+/*This file is the public interface of libghs, for computing MSTs from inside
+another program rather than through the ghs binary. The library runs a graph
+the way batch mode does: every node is a thread of the calling process, nodes
+talk over the partitioned transport (straight into each other's queues), and
+their results come back through a pipe the library owns. Nothing is forked,
+nothing is written to the working directory, and nothing is logged unless a log
+is given in the config.
+
+Using it takes a graph, a runner, and an MST to put the results in:
+
+  struct ghs_graph *graph = ghs_init_graph(4);
+  ghs_add_edge(graph, 0, 1, 3);
+  ...
+  struct ghs_runner *runner = ghs_init_runner();
+  struct ghs_mst mst;
+  if (ghs_run(runner, graph, NULL, &mst)) {
+    ... mst.edges[0] to mst.edges[mst.num_edges - 1] ...
+    ghs_free_mst(&mst);
+  }
+  ghs_free_runner(runner);
+  ghs_free_graph(graph);
+
+A runner holds on to its nodes and message queues between runs, so running
+many graphs through the same runner is cheaper than setting up a new one each
+time (which is what ghs_mst does). A runner only runs one graph at a time, but
+separate runners can be used from separate threads.
+
+Weights are weight_t, whose type depends on how the library was built (see
+weight.h), so programs have to be built with the same weight flags as the
+library.*/
+
+#include <stdio.h>      /*logs are streams*/
+#include <stdint.h>     /*sized integers*/
+
+#include "weight.h"     /*edges have weights*/
+
+/*Marks the functions the library exports. It's built with everything else
+hidden, so its insides never clash with the program linking it*/
+#define GHS_API __attribute__((visibility("default")))
+
+/*Largest graph the library takes, since node IDs have to fit in a byte*/
+#define GHS_MAX_NODES 100
+
+/*Engines a graph can be run with:
+  GHS_ENGINE_GHS  -> textbook GHS
+  GHS_ENGINE_LEAN -> GHS, combining TESTs that cross between fragments (-a lean)
+  GHS_ENGINE_SPEC -> GHS, testing several edges at once (-a spec)
+  GHS_ENGINE_BORUVKA -> Borůvka, on the same nodes (-a boruvka)*/
+enum GHS_ENGINES {
+  GHS_ENGINE_GHS = 0,
+  GHS_ENGINE_LEAN,
+  GHS_ENGINE_SPEC,
+  GHS_ENGINE_BORUVKA,
+  GHS_ENGINES
+};
+
+/*An undirected edge between nodes u and v. MST edges always have u < v*/
+struct ghs_edge {
+  uint32_t u;
+  uint32_t v;
+  weight_t weight;
+};
+
+/*A graph, as a list of edges.
+  num_nodes -> number of nodes, which are numbered from 0
+  num_edges -> number of edges
+  max_edges -> number of edges there's room for
+  edges     -> the edges themselves*/
+struct ghs_graph {
+  uint32_t num_nodes;
+  uint32_t num_edges;
+  uint32_t max_edges;
+  struct ghs_edge *edges;
+};
+
+/*How to run a graph.
+  engine -> one of GHS_ENGINES
+  log    -> stream the nodes log their progress to, like the global log of
+            the ghs binary (NULL to log nothing)
+  filter -> seed to sample the graph with, to drop the edges the sample
+            proves heavy before running it, as '-S' does (0 drops nothing)*/
+struct ghs_config {
+  uint8_t engine;
+  FILE *log;
+  uint32_t filter;
+};
+
+/*The MST of a graph, and how computing it went.
+  num_nodes  -> number of nodes in the graph
+  trees      -> number of trees in the MST, one per component of the graph
+                (a graph that isn't connected has a spanning forest instead)
+  num_edges  -> number of MST edges (num_nodes - trees, when all went well)
+  edges      -> the MST edges, sorted by (u, v)
+  total      -> total weight of the MST
+  done       -> how many nodes terminated
+  mismatched -> edges only one of the endpoints reported as part of the MST
+  secs       -> time from starting the nodes to the last one terminating
+  messages   -> number of messages the nodes sent
+  avoided    -> TESTs the nodes didn't need to send, since they knew the
+                neighbour was in their own fragment
+  filtered   -> edges dropped before running the graph, when filtering*/
+struct ghs_mst {
+  uint32_t num_nodes;
+  uint32_t trees;
+  uint32_t num_edges;
+  struct ghs_edge *edges;
+  weight_sum_t total;
+  uint32_t done;
+  uint32_t mismatched;
+  double secs;
+  uint64_t messages;
+  uint32_t avoided;
+  uint32_t filtered;
+};
+
+/*Everything needed to run graphs, kept from one graph to the next. Its
+contents are private to the library*/
+struct ghs_runner;
+
+/*Creates an empty graph with the given number of nodes. Returns NULL if there
+are too many of them*/
+GHS_API struct ghs_graph *ghs_init_graph(uint32_t num_nodes);
+
+/*Adds an edge to the given graph. Returns 1 on success, 0 if the endpoints or
+the weight can't make up an edge*/
+GHS_API uint8_t ghs_add_edge(struct ghs_graph *graph, uint32_t u, uint32_t v,
+                                                              weight_t weight);
+
+/*Returns NULL if GHS can run the given graph, or why it can't otherwise:
+it needs between 2 and GHS_MAX_NODES nodes, valid edges and no edge repeated
+(anything else would leave nodes waiting forever). Graphs that aren't connected
+are fine, every component gets a tree of its own*/
+GHS_API const char *ghs_check_graph(struct ghs_graph *graph);
+
+/*Frees the given graph*/
+GHS_API void ghs_free_graph(struct ghs_graph *graph);
+
+/*Creates a runner. Returns NULL if it could not be set up*/
+GHS_API struct ghs_runner *ghs_init_runner();
+
+/*Computes the MST of the given graph with the given runner, according to the
+given config (NULL runs textbook GHS without logging), and stores it in mst.
+Returns 1 on success, 0 if the graph or the config are invalid (in which case
+mst is left untouched). Runs that go wrong still return 1, with fewer nodes done
+or mismatched edges in the MST*/
+GHS_API uint8_t ghs_run(struct ghs_runner *runner, struct ghs_graph *graph,
+                            struct ghs_config *config, struct ghs_mst *mst);
+
+/*Frees the given runner*/
+GHS_API void ghs_free_runner(struct ghs_runner *runner);
+
+/*Same as ghs_run, but with a runner of its own*/
+GHS_API uint8_t ghs_mst(struct ghs_graph *graph, struct ghs_config *config,
+                                                          struct ghs_mst *mst);
+
+/*Frees the memory allocated for the given MST*/
+GHS_API void ghs_free_mst(struct ghs_mst *mst);
+
+#endif /* LIBGHS_H */
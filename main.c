@@ -2,23 +2,227 @@
 
 /*entry point*/
 int main (int argc, char *argv[]) {
+	/*parse options first, positional arguments are whatever is left*/
+	struct options opts;
+	char *hosts = NULL;
+	int opt;
+	memset(&opts, 0, sizeof(opts));
+	opts.transport = TRANSPORT_EDGE;
+	opts.tcp.port = TCP_DEFAULT_PORT;
+	opts.only_worker = -1;
+	opts.seed = time(NULL);
+	opts.pieces = 1;
+	while ((opt = getopt(argc, argv, "t:w:W:p:H:s:o:f:u:b:T:MrR:a:P:LN:F:KS"))
+	                                                                     != -1) {
+		switch (opt) {
+			case 't': {
+				if (!strcmp(optarg, "edge")) {
+					opts.transport = TRANSPORT_EDGE;
+				}
+				else if (!strcmp(optarg, "mux")) {
+					opts.transport = TRANSPORT_MUX;
+				}
+				else if (!strcmp(optarg, "tcp")) {
+					opts.transport = TRANSPORT_TCP;
+				}
+				else if (!strcmp(optarg, "part")) {
+					opts.transport = TRANSPORT_PART;
+				}
+				else if (!strcmp(optarg, "bsp")) {
+					opts.transport = TRANSPORT_BSP;
+				}
+				else {
+					fprintf(stderr, "Unknown transport '%s'!\n", optarg);
+					return 0;
+				}
+				break;
+			}
+			case 'w': {
+				opts.workers = atoi(optarg);
+				break;
+			}
+			case 'W': {
+				opts.only_worker = atoi(optarg);
+				break;
+			}
+			case 'p': {
+				opts.tcp.port = atoi(optarg);
+				break;
+			}
+			case 'H': {
+				hosts = optarg;
+				break;
+			}
+			case 's': {
+				opts.seed = strtoul(optarg, NULL, 10);
+				break;
+			}
+			case 'o': {
+				opts.outfile = optarg;
+				break;
+			}
+			case 'f': {
+				if (!strcmp(optarg, "csv") || !strcmp(optarg, "bin")) {
+					opts.binary = !strcmp(optarg, "bin");
+				}
+				else {
+					fprintf(stderr, "Unknown output format '%s'!\n", optarg);
+					return 0;
+				}
+				break;
+			}
+			case 'u': {
+				opts.updates = strcmp(optarg, "-") ? fopen(optarg, "r") : stdin;
+				if (opts.updates == NULL) {
+					fprintf(stderr, "Could not open updates file '%s'!\n", optarg);
+					return 0;
+				}
+				break;
+			}
+			case 'b': {
+				opts.batch = strcmp(optarg, "-") ? fopen(optarg, "r") : stdin;
+				if (opts.batch == NULL) {
+					fprintf(stderr, "Could not open graphs file '%s'!\n", optarg);
+					return 0;
+				}
+				break;
+			}
+			case 'T': {
+				opts.timeline = optarg;
+				opts.algo_opts |= GHS_TIMELINE;
+				break;
+			}
+			case 'M': {
+				opts.algo_opts |= GHS_HISTOGRAMS;
+				break;
+			}
+			case 'r': {
+				opts.algo_opts |= GHS_RECORD;
+				break;
+			}
+			case 'L': {
+				opts.place = 1;
+				break;
+			}
+			case 'K': {
+				opts.algo_opts |= GHS_CONTRACT;
+				break;
+			}
+			case 'S': {
+				opts.filter = 1;
+				break;
+			}
+			case 'N': {
+				if (!strcmp(optarg, "bfs")) {
+					opts.order = ORDER_BFS;
+				}
+				else if (!strcmp(optarg, "rcm")) {
+					opts.order = ORDER_RCM;
+				}
+				else if (!strcmp(optarg, "degree")) {
+					opts.order = ORDER_DEGREE;
+				}
+				else {
+					fprintf(stderr, "Unknown order '%s'!\n", optarg);
+					return 0;
+				}
+				break;
+			}
+			case 'F': {
+				opts.pieces = atoi(optarg);
+				break;
+			}
+			case 'R': {
+				opts.replay = optarg;
+				break;
+			}
+			case 'a': {
+				opts.algo_opts &= ~(GHS_LEAN | GHS_SPECULATE);
+				opts.fun = &ghs;
+				if (!strcmp(optarg, "ghs")) {
+					break;
+				}
+				else if (!strcmp(optarg, "boruvka")) {
+					opts.fun = &boruvka;
+				}
+				else if (!strcmp(optarg, "lean")) {
+					opts.algo_opts |= GHS_LEAN;
+				}
+				else if (!strcmp(optarg, "spec")) {
+					opts.algo_opts |= GHS_SPECULATE;
+				}
+				else {
+					fprintf(stderr, "Unknown algorithm '%s'!\n", optarg);
+					return 0;
+				}
+				break;
+			}
+			case 'P': {
+				opts.algo_opts &= ~GHS_POLICY;
+				if (!strcmp(optarg, "fifo")) {
+					break;
+				}
+				else if (!strcmp(optarg, "prio")) {
+					opts.algo_opts |= POLICY_PRIO << GHS_POLICY_SHIFT;
+				}
+				else if (!strcmp(optarg, "answers")) {
+					opts.algo_opts |= POLICY_ANSWERS << GHS_POLICY_SHIFT;
+				}
+				else {
+					fprintf(stderr, "Unknown policy '%s'!\n", optarg);
+					return 0;
+				}
+				break;
+			}
+			default: {
+				usage();
+				return 0;
+			}
+		}
+	}
+
+	/*batch mode brings its own graphs, and its own pool of workers*/
+	if (opts.batch != NULL) {
+		if (opts.workers == 0) {
+			long cores = sysconf(_SC_NPROCESSORS_ONLN);
+			opts.workers = (cores < 1) ? 1 : (cores > 255) ? 255 : cores;
+		}
+		FILE *globallog = fopen("global.log", "w");
+		setbuf(globallog, NULL);
+		uint8_t ret = run_batch(opts.batch, opts.workers, opts.outfile, opts.binary,
+		                                                                globallog);
+		if (opts.batch != stdin) {
+			fclose(opts.batch);
+		}
+		fclose(globallog);
+		return ret;
+	}
+
+	/*replays bring their own nodes, which don't talk to each other at all*/
+	if (opts.replay != NULL) {
+		FILE *globallog = fopen("global.log", "w");
+		setbuf(globallog, NULL);
+		uint8_t ret = run_replay(opts.replay, globallog);
+		fclose(globallog);
+		return ret;
+	}
+
 	/*check for number of input arguments*/
-	if (argc < 2) {
+	if (argc - optind < 1) {
 		fprintf(stderr, "Not enough arguments!\n");
-		fprintf(stderr, "Usage: ./ghs <number nodes> <connectivity flag>\n");
-		fprintf(stderr, "Use flag as anything but 0 for dense network.\n");
+		usage();
 		return 0;
 	}
 
 	/*type of connectivity*/
 	uint8_t con_flag = 0;
-	if (argc == 3) {
-		con_flag = atoi(argv[2]);
+	if (argc - optind >= 2) {
+		con_flag = atoi(argv[optind + 1]);
 	}
 
 	/*compute number of nodes and check for validity*/
 	uint8_t num_nodes;
-	num_nodes = atoi(argv[1]);
+	num_nodes = atoi(argv[optind]);
 	if (num_nodes > 100) {
 		fprintf(stderr, "Too many nodes! (max: 100)\n");
 		fprintf(stderr, "Fork bombing is bad and you should feel bad!\n");
@@ -30,8 +234,118 @@ int main (int argc, char *argv[]) {
 		return 0;
 	}
 
-	/*initialize network connectivity (who is adjacent to whom)*/
-	uint16_t *edges;
+	/*TCP defaults to a couple of workers, partitioned mode and the BSP engine
+	to one per core*/
+	if (opts.workers == 0) {
+		opts.workers = 2;
+		if (opts.transport == TRANSPORT_PART || opts.transport == TRANSPORT_BSP) {
+			long cores = sysconf(_SC_NPROCESSORS_ONLN);
+			opts.workers = (cores < 1) ? 1 : (cores > num_nodes) ? num_nodes : cores;
+		}
+	}
+	if (opts.workers > num_nodes) {
+		fprintf(stderr, "Invalid number of workers! (1-%d)\n", num_nodes);
+		return 0;
+	}
+	if (opts.pieces < 1 || opts.pieces > num_nodes) {
+		fprintf(stderr, "Invalid number of pieces! (1-%d)\n", num_nodes);
+		return 0;
+	}
+	opts.tcp.workers = opts.workers;
+
+	/*workers need to agree on where everyone is*/
+	if (opts.transport == TRANSPORT_TCP) {
+		if (opts.only_worker >= opts.tcp.workers) {
+			fprintf(stderr, "There is no worker %d!\n", opts.only_worker);
+			return 0;
+		}
+		if (!tcp_parse_hosts(&opts.tcp, hosts)) {
+			tcp_free_hosts(&opts.tcp);
+			return 0;
+		}
+	}
+
+	/*declare and initialize function pointer, in this case we'll run function
+	ghs for each node, which is the GHS algorithm implementation, unless -a asked
+	for Borůvka. Which variant of GHS, and what they measure, is up to the
+	options nodes are given*/
+	if (opts.fun == NULL) {
+		opts.fun = &ghs;
+	}
+
+	/*Borůvka nodes keep no timelines, histograms or recordings, and handle
+	their messages in the order they arrive*/
+	if (opts.fun == &boruvka && (opts.algo_opts & GHS_POLICY)) {
+		fprintf(stderr, "Borůvka nodes only handle messages in order!\n");
+		return 0;
+	}
+	if (opts.fun == &boruvka && (opts.algo_opts & GHS_CONTRACT)) {
+		fprintf(stderr, "Borůvka nodes don't start from fragments!\n");
+		return 0;
+	}
+	if (opts.fun == &boruvka && opts.algo_opts) {
+		fprintf(stderr, "Borůvka nodes can't be timed or recorded!\n");
+		return 0;
+	}
+
+	/*incremental nodes keep running after GHS, and the parent needs to reach
+	any of them, which only the partitioned workers allow. They pick up where
+	plain GHS left off*/
+	if (opts.updates != NULL) {
+		if (opts.transport != TRANSPORT_PART) {
+			fprintf(stderr, "Updates need the partitioned transport (-t part)!\n");
+			return 0;
+		}
+		if (opts.algo_opts || opts.fun != &ghs) {
+			fprintf(stderr, "Incremental mode only runs plain GHS!\n");
+			return 0;
+		}
+		if (opts.order != ORDER_NONE) {
+			fprintf(stderr, "Updates can't name relabelled nodes!\n");
+			return 0;
+		}
+		if (opts.pieces > 1) {
+			fprintf(stderr, "Updates need the network in one piece!\n");
+			return 0;
+		}
+		if (opts.filter) {
+			fprintf(stderr, "Updates need every edge of the network!\n");
+			return 0;
+		}
+		opts.fun = &ghs_incremental;
+	}
+
+	/*only partitioned workers contract their nodes, and a replay wouldn't know
+	which fragments they started in*/
+	if (opts.algo_opts & GHS_CONTRACT) {
+		if (opts.transport != TRANSPORT_PART) {
+			fprintf(stderr, "Contraction needs the partitioned transport"
+			                " (-t part)!\n");
+			return 0;
+		}
+		if (opts.algo_opts & GHS_RECORD) {
+			fprintf(stderr, "Contracted runs can't be recorded!\n");
+			return 0;
+		}
+	}
+
+	/*the BSP engine has no nodes to run GHS, or to measure*/
+	if (opts.transport == TRANSPORT_BSP && opts.algo_opts) {
+		fprintf(stderr, "The BSP engine only runs Borůvka!\n");
+		return 0;
+	}
+
+	/*only nodes we fork ourselves, on this host, can be placed*/
+	if (opts.place && (opts.transport == TRANSPORT_TCP ||
+	                   opts.transport == TRANSPORT_BSP)) {
+		fprintf(stderr, "Placement needs the edge, mux or partitioned transport!\n");
+		return 0;
+	}
+
+	/*initialize network connectivity (who is adjacent to whom). The topology
+	only depends on the seed, so workers on different hosts can agree on it*/
+	weight_t *edges;
+	srand(opts.seed);
 	if (con_flag) {
 		edges = compute_dense_connectivity(num_nodes);
 	}
@@ -39,40 +353,145 @@ int main (int argc, char *argv[]) {
 		edges = compute_sparse_connectivity(num_nodes);
 	}
 
-	/*initialize socket pairs for each edge*/
-	uint32_t *sockets;
-	sockets = init_sockets(edges, num_nodes);
-	if (sockets == NULL) {
-		return 0;
+	/*the parent tells when each piece is done, and nodes don't need to know*/
+	if (opts.pieces > 1) {
+		cut_connectivity(edges, num_nodes, opts.pieces);
+	}
+	opts.comp = malloc(num_nodes*sizeof(uint8_t));
+	opts.trees = find_components(edges, num_nodes, opts.comp);
+
+	/*drop the edges a sample of the network proves heavy, whatever runs it. The
+	sample only depends on the seed, so TCP workers drop the same ones*/
+	if (opts.filter) {
+		double start = mono_time();
+		uint32_t dropped = filter_edges(edges, num_nodes, opts.seed);
+		print_filtering(edges, num_nodes, dropped, mono_time() - start, stdout);
+		fflush(stdout);
+	}
+
+	/*number neighbours close to each other, and run that network instead. We
+	keep the old IDs to report the results with*/
+	if (opts.order != ORDER_NONE) {
+		weight_t *relabelled;
+		opts.labels = order_nodes(edges, num_nodes, opts.order);
+		relabelled = relabel_edges(edges, opts.labels, num_nodes);
+		print_relabelling(edges, relabelled, num_nodes, stdout);
+		fflush(stdout);
+		free(edges);
+		edges = relabelled;
+	}
+
+	/*split the network into groups with few edges between them, one per worker,
+	or one per core when every node is a process of its own*/
+	if (opts.place) {
+		uint8_t groups = opts.workers;
+		if (opts.transport != TRANSPORT_PART) {
+			groups = (count_cores() > num_nodes) ? num_nodes : count_cores();
+		}
+		opts.owners = place_nodes(edges, num_nodes, groups);
+		print_placement(edges, opts.owners, num_nodes, groups, stdout);
+		fflush(stdout);
 	}
 
 	/*initialize global log file (shared by all nodes), disable buffering for
-	"real-time" logging*/
-	FILE *globallog = fopen("global.log", "w");
+	"real-time" logging. Workers started on their own append to it instead, in
+	case other workers are sharing it*/
+	FILE *globallog = fopen("global.log", opts.only_worker == -1 ? "w" : "a");
 	fflush(globallog);
 	setbuf(globallog, NULL);
 
+	/*the log holds the relabelled network, so check.py needs the old IDs to
+	check the output against it. Only once, like the topology*/
+	if (opts.labels != NULL && opts.only_worker <= 0) {
+		print_labels(opts.labels, num_nodes, globallog);
+	}
+
+	/*TCP workers set up their own channels, and fork their own nodes*/
+	if (opts.transport == TRANSPORT_TCP) {
+		return run_tcp(edges, num_nodes, &opts, globallog);
+	}
+
+	/*partitioned workers host their nodes as threads, and route their messages*/
+	if (opts.transport == TRANSPORT_PART) {
+		return run_partitioned(edges, num_nodes, &opts, globallog);
+	}
+
+	/*the BSP engine runs rounds on a pool of threads, with no nodes at all*/
+	if (opts.transport == TRANSPORT_BSP) {
+		return run_synchronous(edges, num_nodes, &opts, globallog);
+	}
+
+	/*initialize socket pairs for each edge, or a single named socket for each
+	node if we are multiplexing*/
+	uint32_t *sockets, *inboxes = NULL;
+	if (opts.transport == TRANSPORT_MUX) {
+		sockets = init_mux_sockets(edges, num_nodes, &inboxes);
+	}
+	else {
+		sockets = init_sockets(edges, num_nodes);
+	}
+	if (sockets == NULL) {
+		return 0;
+	}
+
 	print_network(edges, sockets, num_nodes, globallog);
+	uint32_t network = getpid();
+
+	/*nodes report their results to us through a pipe*/
+	int32_t results[2];
+	if (pipe(results) == -1) {
+		fprintf(stderr, "Could not create results pipe!\n");
+		return 0;
+	}
+
+	/*every node only gets its own edges, rather than the whole matrices, and
+	we need to know how far up the descriptors go so nodes can close the ones
+	that aren't theirs*/
+	uint32_t *offsets;
+	struct node_edge *adj = build_adjacency(edges, sockets, num_nodes, &offsets);
+	int32_t max_fd = max_descriptor(sockets, inboxes, num_nodes, results);
+	double start = mono_time();
 
 	/*spawn child processes for each node, and let them run*/
 	int32_t i, pid;
 	for (i = 0; i < num_nodes; i++) {
 		/*child processes will run this, and init and run their own node*/
 		if ((pid = fork()) == 0) {
+			/*placed nodes run on their group's core, along with their threads*/
+			if (opts.owners != NULL && !pin_to_core(opts.owners[i])) {
+				fprintf(stderr, "Could not pin node %d to a core!\n", i);
+			}
+
 			/*declare and initialize the node*/
 			struct node *newnode;
-			newnode = init_node(i, edges, sockets, num_nodes, globallog);
+			newnode = init_node(i, &adj[offsets[i]], offsets[i+1] - offsets[i],
+			                    opts.transport, inboxes ? inboxes[i] : 0, globallog);
+			newnode->results = results[1];
+			newnode->network = network;
+			newnode->algo_opts = opts.algo_opts;
 
-			/*declare and initialize function pointer, in this case we'll run function
-			ghs for each node, which is the GHS algorithm implementation*/
-			void (*fun) (struct node *node);
-			fun = &ghs;
+			/*drop everyone else's channels and the parent's view of the network
+			right away, the node has everything it needs*/
+			close_other_fds(newnode, max_fd);
+			free(adj);
+			free(offsets);
+			free(edges);
+			free(sockets);
+			free(inboxes);
+			free(opts.owners);
+			free(opts.labels);
+			free(opts.comp);
+			adj = NULL;
+			offsets = NULL;
+			edges = NULL;
+			sockets = inboxes = NULL;
+			opts.owners = opts.labels = opts.comp = NULL;
 
 			/*Run whatever algorithm here. At this point, the nodes should be agnostic
 			to any global information from the parent process, such as the edge/socket
 			map, and should only rely on information that is self-contained to their
 			own initialized structure*/
-			run_node(newnode, fun);
+			run_node(newnode, opts.fun);
 
 			/*free the node's memory in the child process*/
 			free_node(newnode);
@@ -82,38 +501,149 @@ int main (int argc, char *argv[]) {
 		}
 	}
 
+	/*the nodes hold their own sockets now, and only theirs*/
+	for (i = 0; pid != 0 && inboxes != NULL && i < num_nodes; i++) {
+		close(inboxes[i]);
+	}
+
+	free(adj);
+	free(offsets);
 	free(edges);
 	free(sockets);
-	fclose(globallog);
+	free(inboxes);
+	free(opts.owners);
 
 	/*child processes are done at this point, so return them*/
 	if (pid == 0) {
+		fclose(globallog);
 		return 1;
 	}
 
-	/*parent needs to wait for all child processes (nodes) to finish executing*/
+	/*parent collects the results until the last node is gone, then waits for
+	all child processes (nodes) to finish executing*/
+	close(results[1]);
+	finish_results(results[0], num_nodes, start, &opts, globallog);
 	int32_t status = 0;
 	while(wait(&status) > 0) {}
 
+	free(opts.labels);
+	free(opts.comp);
+	fclose(globallog);
 	return 1;
 }
 
+int32_t max_descriptor(uint32_t *sockets, uint32_t *inboxes, uint8_t num_nodes,
+                                                            int32_t *results) {
+	int32_t max_fd = (results[0] > results[1]) ? results[0] : results[1];
+	int32_t i;
+
+	for (i = 0; i < num_nodes*num_nodes; i++) {
+		max_fd = ((int32_t) sockets[i] > max_fd) ? (int32_t) sockets[i] : max_fd;
+	}
+	for (i = 0; inboxes != NULL && i < num_nodes; i++) {
+		max_fd = ((int32_t) inboxes[i] > max_fd) ? (int32_t) inboxes[i] : max_fd;
+	}
+
+	return max_fd;
+}
+
+void finish_results(int32_t fd, uint8_t num_nodes, double start,
+                                      struct options *opts, FILE *globallog) {
+	struct mst_result res;
+	char logmsg[60];
+
+	collect_results(fd, num_nodes, start, &res);
+	close(fd);
+	res.trees = opts->trees;
+	if (opts->labels != NULL) {
+		unlabel_results(&res, opts->labels);
+	}
+
+	print_results(&res, stdout);
+	if (opts->trees > 1) {
+		print_forest(&res, opts->comp, opts->trees, stdout);
+	}
+	snprintf(logmsg, 60, "MST has %u edges, weight %" PRIsum " (%.3fs)",
+	                                           res.num_edges, res.total, res.secs);
+	log_msg(logmsg, globallog);
+
+	if (opts->outfile != NULL) {
+		write_results(&res, opts->outfile, opts->binary);
+	}
+	if (opts->timeline != NULL) {
+		print_timeline(&res, stdout);
+		write_timeline(&res, opts->timeline);
+	}
+	if (res.hists != NULL) {
+		print_histograms(res.hists, stdout);
+	}
+	free_results(&res);
+}
+
+uint8_t run_tcp(weight_t *edges, uint8_t num_nodes, struct options *opts,
+                                                              FILE *globallog) {
+	struct tcp_config *tcp = &opts->tcp;
+	int32_t results[2] = {-1, -1};
+	uint8_t ret = 1;
+	char logmsg[60];
+	int32_t k;
+
+	/*the workers build their own socket maps, so there's only edges to print*/
+	if (opts->only_worker <= 0) {
+		print_network(edges, NULL, num_nodes, globallog);
+	}
+	snprintf(logmsg, 60, "Topology seed is %u, %d workers", opts->seed,
+	                                                                tcp->workers);
+	log_msg(logmsg, globallog);
+
+	/*running a single worker, presumably the others are on other hosts, so
+	there's nobody to collect the results*/
+	if (opts->only_worker != -1) {
+		ret = run_tcp_worker(opts->only_worker, edges, num_nodes, tcp, globallog,
+		                                           -1, opts->fun, opts->algo_opts);
+	}
+
+	/*otherwise fork every worker locally, they'll still talk over TCP*/
+	else {
+		double start = mono_time();
+		if (pipe(results) == -1) {
+			fprintf(stderr, "Could not create results pipe!\n");
+			return 0;
+		}
+		for (k = 0; k < tcp->workers; k++) {
+			if (fork() == 0) {
+				ret = run_tcp_worker(k, edges, num_nodes, tcp, globallog, results[1],
+				                                           opts->fun, opts->algo_opts);
+				break;
+			}
+		}
+		if (k == tcp->workers) {
+			int32_t status = 0;
+			close(results[1]);
+			finish_results(results[0], num_nodes, start, opts, globallog);
+			while(wait(&status) > 0) {}
+		}
+	}
+
+	tcp_free_hosts(tcp);
+	free(edges);
+	free(opts->labels);
+	free(opts->comp);
+	fclose(globallog);
+	return ret;
+}
 
-uint32_t *init_sockets(uint16_t *edges, uint8_t num_nodes) {
-	uint16_t *weights;
+uint32_t *init_sockets(weight_t *edges, uint8_t num_nodes) {
 	uint32_t *sockets;
 
-	/*weights for unique edges, sockets is our socket map*/
-	weights = calloc(num_nodes*num_nodes, sizeof(uint16_t));
+	/*sockets is our socket map*/
 	sockets = calloc(num_nodes*num_nodes, sizeof(uint32_t));
 
 	/*compute socket pairs for each edge*/
 	int16_t i, j;
 	for (i = 0; i < num_nodes; i++) {
-		for (j = 0; j < num_nodes; j++) {
-			int16_t weight = edges[i*num_nodes + j];
-
-			if (weight && !weights[weight]) {
+		for (j = i+1; j < num_nodes; j++) {
+			if (edges[i*num_nodes + j]) {
 				int fd_pair[2];
 
 				/*we use SEQPACKET sockets, which are a nifty mix of datagram
@@ -126,29 +656,71 @@ uint32_t *init_sockets(uint16_t *edges, uint8_t num_nodes) {
 				/*each node gets a different socket*/
 				sockets[i*num_nodes + j] = fd_pair[0];
 				sockets[j*num_nodes + i] = fd_pair[1];
-				weights[weight] = 1;
 			}
 		}
 	}
 
-	free(weights);
 	return sockets;
 }
 
-uint16_t *compute_dense_connectivity(uint8_t num_nodes) {
-	uint16_t *edges, *weights;
+uint32_t *init_mux_sockets(weight_t *edges, uint8_t num_nodes,
+                                                        uint32_t **inboxes) {
+	struct sockaddr_un addr;
+	socklen_t len;
+	uint32_t *sockets;
+	int32_t fd;
+
+	/*sockets is still our socket map, but each cell now holds the ID of the
+	node on the other end of the edge, which names its socket. inboxes holds
+	each node's own socket*/
+	sockets = calloc(num_nodes*num_nodes, sizeof(uint32_t));
+	*inboxes = calloc(num_nodes, sizeof(uint32_t));
+
+	int16_t i, j;
+	for (i = 0; i < num_nodes; i++) {
+		/*datagrams keep message boundaries, and messages from several senders
+		never get interleaved. Sockets are named before anyone is forked, so
+		nobody ever sends to a name that isn't there yet*/
+		len = mux_address(&addr, getpid(), i);
+		if ((fd = socket(AF_UNIX, SOCK_DGRAM, 0)) == -1 ||
+		    bind(fd, (struct sockaddr *) &addr, len) == -1) {
+			fprintf(stderr, "Error when creating node %d's socket!\n", i);
+			if (fd != -1) {
+				close(fd);
+			}
+			for (j = 0; j < i; j++) {
+				close((*inboxes)[j]);
+			}
+			free(sockets);
+			free(*inboxes);
+			*inboxes = NULL;
+			return NULL;
+		}
+
+		/*the node receives on it, and its neighbours send to its name*/
+		(*inboxes)[i] = fd;
+		for (j = 0; j < num_nodes; j++) {
+			if (edges[j*num_nodes + i]) {
+				sockets[j*num_nodes + i] = i;
+			}
+		}
+	}
+
+	return sockets;
+}
+
+weight_t *compute_dense_connectivity(uint8_t num_nodes) {
+	weight_t *edges;
 	uint16_t num_edges, goal;
 
 	/*we want (n-1)*(n-2)/2 + 1 edges total*/
 	goal = (((num_nodes-1) * (num_nodes-2)) / 2) + 1;
 	num_edges = 0;
 
-	/*edges will be our connectivity matrix, weights will guarantee uniqueness*/
-	edges = calloc(num_nodes*num_nodes, sizeof(uint16_t));
-	weights = calloc(num_nodes*num_nodes, sizeof(uint16_t));
+	/*edges will be our connectivity matrix*/
+	edges = calloc(num_nodes*num_nodes, sizeof(weight_t));
 
 	/*generate random edges until we reach goal*/
-	srand(time(NULL));
 	while(num_edges < goal) {
 		/*randomize nodes*/
 		uint8_t v1 = rand()%num_nodes;
@@ -159,15 +731,10 @@ uint16_t *compute_dense_connectivity(uint8_t num_nodes) {
 			continue;
 		}
 
-		/*get a valid, unique weight*/
-		int16_t weight = -1;
-		while (weight < 1) {
-			weight = (rand()%((num_nodes)*(num_nodes)));
-			weight = (weights[weight]) ? -1 : weight;
-		}
+		/*get a valid weight, repeated ones are fine since GHS breaks ties*/
+		weight_t weight = random_weight((num_nodes)*(num_nodes));
 
-		/*update graph and unique weight flag map*/
-		weights[weight] = 1;
+		/*update graph*/
 		edges[v1*num_nodes + v2] = weight;
 		edges[v2*num_nodes + v1] = weight;
 		num_edges++;
@@ -176,27 +743,20 @@ uint16_t *compute_dense_connectivity(uint8_t num_nodes) {
 	return edges;
 }
 
-uint16_t *compute_sparse_connectivity(uint8_t num_nodes) {
-	uint16_t *edges, *weights;
+weight_t *compute_sparse_connectivity(uint8_t num_nodes) {
+	weight_t *edges;
 	uint16_t num_edges;
 
 	num_edges = 0;
 
-	/*edges will be our connectivity matrix, weights will guarantee uniqueness*/
-	edges = calloc(num_nodes*num_nodes, sizeof(uint16_t));
-	weights = calloc(num_nodes*num_nodes, sizeof(uint16_t));
+	/*edges will be our connectivity matrix*/
+	edges = calloc(num_nodes*num_nodes, sizeof(weight_t));
 
 	/*generate random n-1 random weight edges (which connects the graph)*/
-	srand(time(NULL));
 	int16_t i;
 	for (i = 0; i < num_nodes-1; i++) {
-		int16_t weight = -1;
-		while (weight < 1) {
-			weight = (rand()%((num_nodes)*(num_nodes)));
-			weight = (weights[weight]) ? -1 : weight;
-		}
+		weight_t weight = random_weight((num_nodes)*(num_nodes));
 
-		weights[weight] = 1;
 		edges[i*num_nodes + (i+1)] = weight;
 		edges[(i+1)*num_nodes + i] = weight;
 		num_edges++;
@@ -214,36 +774,253 @@ uint16_t *compute_sparse_connectivity(uint8_t num_nodes) {
 			continue;
 		}
 
-		/*get a valid, unique weight*/
-		int16_t weight = -1;
-		while (weight < 1) {
-			weight = (rand()%((num_nodes)*(num_nodes)));
-			weight = (weights[weight]) ? -1 : weight;
-		}
+		/*get a valid weight, repeated ones are fine since GHS breaks ties*/
+		weight_t weight = random_weight((num_nodes)*(num_nodes));
 
-		/*update graph and unique weight flag map*/
-		weights[weight] = 1;
+		/*update graph*/
 		edges[v1*num_nodes + v2] = weight;
 		edges[v2*num_nodes + v1] = weight;
 		num_edges++;
 	}
 
-	free(weights);
 	return edges;
 }
 
-void print_network(uint16_t *edges, uint32_t *socks, uint8_t num, FILE *stream){
+void cut_connectivity(weight_t *edges, uint8_t num_nodes, uint8_t pieces) {
+	int16_t i, j;
+
+	for (i = 0; i < num_nodes; i++) {
+		for (j = 0; j < num_nodes; j++) {
+			if (worker_of(i, num_nodes, pieces) != worker_of(j, num_nodes, pieces)) {
+				edges[i*num_nodes + j] = 0;
+			}
+		}
+	}
+}
+
+uint8_t run_partitioned(weight_t *edges, uint8_t num_nodes,
+                        struct options *opts, FILE *globallog) {
+	struct worker_stats *stats;
+	uint32_t *sockets;
+	uint8_t workers = opts->workers;
+	uint8_t *owners = opts->owners;
+	int fd_pair[2];
+	int32_t k, pid = -1, results[2];
+	uint8_t ret = 1;
+	char logmsg[60];
+
+	print_network(edges, NULL, num_nodes, globallog);
+
+	/*unless the nodes were placed, workers get contiguous slices of them*/
+	if (owners == NULL) {
+		owners = place_slices(num_nodes, workers);
+	}
+
+	/*workers contract their own nodes before GHS starts, so tell how much of
+	the MST they'll have found already*/
+	if (opts->algo_opts & GHS_CONTRACT) {
+		print_contraction(edges, num_nodes, owners, workers, opts->trees, stdout);
+		fflush(stdout);
+	}
+
+	/*each worker gets a single inbound socket for messages from other workers*/
+	sockets = calloc(2*workers, sizeof(uint32_t));
+	for (k = 0; k < workers; k++) {
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fd_pair) == -1) {
+			fprintf(stderr, "Error when creating socket pair!\n");
+			free(sockets);
+			return 0;
+		}
+		sockets[2*k] = fd_pair[0];
+		sockets[2*k + 1] = fd_pair[1];
+	}
+
+	/*workers count their messages in memory we can read once they're done*/
+	stats = mmap(NULL, workers*sizeof(struct worker_stats),
+	             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (stats == MAP_FAILED) {
+		fprintf(stderr, "Could not map worker statistics!\n");
+		free(sockets);
+		return 0;
+	}
+	memset(stats, 0, workers*sizeof(struct worker_stats));
+
+	/*and their nodes report their results through a pipe*/
+	if (pipe(results) == -1) {
+		fprintf(stderr, "Could not create results pipe!\n");
+		free(sockets);
+		return 0;
+	}
+	double start = mono_time();
+
+	for (k = 0; k < workers; k++) {
+		if ((pid = fork()) == 0) {
+			if (opts->place && !pin_to_core(k)) {
+				fprintf(stderr, "Could not pin worker %d to a core!\n", k);
+			}
+			ret = run_worker(k, workers, edges, num_nodes, owners, sockets, stats,
+			                    globallog, results[1], opts->fun, opts->algo_opts);
+			break;
+		}
+	}
+
+	/*parent collects the results, waits for the workers, then reports where the
+	traffic went*/
+	if (pid != 0) {
+		uint64_t local = 0, total = 0;
+		int32_t status = 0;
+		close(results[1]);
+		if (opts->updates != NULL) {
+			run_updates(opts->updates, results[0], edges, num_nodes, sockets,
+			                                  workers, owners, stats, globallog);
+			if (opts->updates != stdin) {
+				fclose(opts->updates);
+			}
+		}
+		finish_results(results[0], num_nodes, start, opts, globallog);
+		while(wait(&status) > 0) {}
+
+		for (k = 0; k < workers; k++) {
+			local += stats[k].local;
+			total += stats[k].local + stats[k].remote;
+		}
+		snprintf(logmsg, 60, "%lu of %lu messages (%.1f%%) stayed local", local,
+		                     total, total ? (100.0 * local) / total : 0.0);
+		log_msg(logmsg, globallog);
+		printf("%d workers: %s\n", workers, logmsg);
+	}
+
+	for (k = 0; k < 2*workers; k++) {
+		close(sockets[k]);
+	}
+	munmap(stats, workers*sizeof(struct worker_stats));
+	free(sockets);
+	free(owners);
+	free(edges);
+	free(opts->labels);
+	free(opts->comp);
+	fclose(globallog);
+	return ret;
+}
+
+uint8_t run_synchronous(weight_t *edges, uint8_t num_nodes,
+                        struct options *opts, FILE *globallog) {
+	struct bsp_engine *engine;
+	struct boruvka *bor;
+	int32_t results[2];
+	char logmsg[60];
+
+	print_network(edges, NULL, num_nodes, globallog);
+
+	/*vertices report their results the way nodes do. Nobody reads them until
+	the engine is done, but that's a couple of records per vertex, far less
+	than what the pipe holds*/
+	if (pipe(results) == -1) {
+		fprintf(stderr, "Could not create results pipe!\n");
+		free(edges);
+		return 0;
+	}
+	engine = init_bsp(edges, num_nodes, opts->workers, &boruvka_step, NULL);
+	bor = init_boruvka(engine, results[1], globallog);
+	engine->algo = bor;
+
+	double start = mono_time();
+	run_bsp(engine);
+	close(results[1]);
+	finish_results(results[0], num_nodes, start, opts, globallog);
+
+	snprintf(logmsg, 60, "BSP engine took %u rounds (%.3fs)", engine->rounds,
+	                                                                 engine->secs);
+	log_msg(logmsg, globallog);
+	print_bsp_stats(engine, stdout);
+
+	free_boruvka(bor, engine);
+	free_bsp(engine);
+	free(edges);
+	free(opts->labels);
+	free(opts->comp);
+	fclose(globallog);
+	return 1;
+}
+
+void usage() {
+	fprintf(stderr, "Usage: ./ghs [options] <number nodes> <connectivity flag>\n");
+	fprintf(stderr, "       ./ghs [options] -b <graphs file>\n");
+	fprintf(stderr, "Use flag as anything but 0 for dense network.\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "  -t edge|mux|tcp|part|bsp  transport between nodes, bsp"
+	                " runs Borůvka\n                   in synchronous rounds"
+	                " instead (default: edge)\n");
+	fprintf(stderr, "  -s <seed>        seed for the topology (default: time)\n");
+	fprintf(stderr, "  -w <workers>     number of TCP or partitioned workers, or"
+	                " of BSP threads\n                   (default: 2 for TCP,"
+	                " one per core otherwise)\n");
+	fprintf(stderr, "  -W <worker>      only run the given TCP worker\n");
+	fprintf(stderr, "  -p <port>        port of TCP worker 0, worker k uses"
+	                " port + k (default: %d)\n", TCP_DEFAULT_PORT);
+	fprintf(stderr, "  -H <h0,h1,...>   addresses of the TCP workers"
+	                " (default: 127.0.0.1)\n");
+	fprintf(stderr, "  -o <file>        write the MST edges to file\n");
+	fprintf(stderr, "  -f csv|bin       format of the output file"
+	                " (default: csv)\n");
+	fprintf(stderr, "  -b <file>        batch mode, computes the MST of every"
+	                " graph in file ('-' for\n                   stdin) with a"
+	                " pool of workers (-w, default: one per core)\n");
+	fprintf(stderr, "  -u <file>        keep the MST up to date with the edge"
+	                " insertions and\n                   weight decreases in file"
+	                " ('-' for stdin), needs -t part\n");
+	fprintf(stderr, "  -T <file>        time every phase of every level, and"
+	                " write the timeline of\n                   state changes"
+	                " to file\n");
+	fprintf(stderr, "  -M               print histograms of how long each type"
+	                " of message waits\n                   in the queues and"
+	                " takes to handle\n");
+	fprintf(stderr, "  -r               record the order in which every node"
+	                " handles its messages,\n                   to <id>.rec\n");
+	fprintf(stderr, "  -R <dir>         replay the recordings in dir, with no"
+	                " transport\n");
+	fprintf(stderr, "  -a ghs|lean|spec|boruvka  algorithm each node runs, lean"
+	                " sends fewer\n                   ACCEPTs, spec tests several"
+	                " edges at once, boruvka\n                   runs Borůvka"
+	                " instead of GHS (default: ghs)\n");
+	fprintf(stderr, "  -F <pieces>      cut the network into this many pieces,"
+	                " and compute the\n                   spanning forest"
+	                " (default: 1)\n");
+	fprintf(stderr, "  -K               contract each worker's nodes with Kruskal"
+	                " before GHS starts,\n                   which then starts"
+	                " from the fragments found (part)\n");
+	fprintf(stderr, "  -S               drop the edges the spanning forest of a"
+	                " random half of them\n                   proves heavy,"
+	                " before running the network\n");
+	fprintf(stderr, "  -L               place neighbours in the same worker or on"
+	                " the same core,\n                   and pin them there"
+	                " (edge, mux or part)\n");
+	fprintf(stderr, "  -N bfs|rcm|degree  relabel nodes so neighbours get close"
+	                " IDs, results\n                   keep the old ones\n");
+	fprintf(stderr, "  -P fifo|prio|answers  order GHS nodes handle their"
+	                " messages in, prio\n                   handles INITIATEs"
+	                " first and CONNECTs and TESTs last,\n"
+	                "                   answers handles ACCEPTs and REJECTs"
+	                " first (default: fifo)\n");
+}
+
+void print_network(weight_t *edges, uint32_t *socks, uint8_t num, FILE *stream){
 	int16_t i, j;
 
 	fprintf(stream, "--------------- DEBUG: Network Topology ---------------\n");
 	for (i = 0; i < num; i++) {
 		for (j = 0; j < num; j++) {
-			fprintf(stream, "%d\t", edges[i*num + j]);
+			fprintf(stream, "%" PRIweight "\t", edges[i*num + j]);
 		}
 		fprintf(stream, "\n");
 	}
 	fprintf(stream, "\n\n");
 
+	/*nothing else to print if the caller doesn't own any sockets*/
+	if (socks == NULL) {
+		return;
+	}
+
 	fprintf(stream, "--------------- DEBUG: Socket Pairs Map ---------------\n");
 	for (i = 0; i < num; i++) {
 		for (j = 0; j < num; j++) {
@@ -10,18 +10,83 @@ topology, then launching the processes that represent each node.*/
 #include <stdint.h>     /*standard types are pretty*/
 #include <stdio.h>      /*what's computing without some input?*/
 #include <stdlib.h>     /*because the heap wants to be used and abused*/
+#include <string.h>     /*option names are strings too*/
 #include <sys/socket.h> /*UNIX sockets yay*/
 #include <sys/wait.h>   /*because forks require patience*/
+#include <sys/mman.h>   /*workers share their statistics with us*/
 
 #include "node.h"       /*implementation of a distributed node*/
 #include "algorithm.h"  /*algorithm to be run (GHS in this case)*/
+#include "tcp.h"        /*workers for running nodes over TCP*/
+#include "worker.h"     /*workers for running many nodes per process*/
+#include "results.h"    /*collecting the MST from the nodes*/
+#include "incremental.h" /*keeping the MST up to date afterwards*/
+#include "batch.h"      /*lots of graphs, one after the other*/
+#include "timeline.h"   /*where the time goes*/
+#include "replay.h"     /*and how to make it go there again*/
+#include "boruvka.h"    /*Borůvka, in rounds or on nodes*/
+#include "placement.h"  /*keeping neighbours close*/
+#include "relabel.h"    /*and numbering them close, too*/
+#include "forest.h"     /*networks in pieces*/
+#include "filter.h"     /*and networks with fewer edges*/
+
+/*Options given in the command line, which decide how the network is run.
+  transport   -> how nodes talk to each other
+  workers     -> number of worker processes, for TCP and partitioned modes, or
+                 of threads for the BSP engine
+  tcp         -> where TCP workers live
+  only_worker -> single TCP worker to run, or -1 to run all of them locally
+  seed        -> seed for generating the topology
+  outfile     -> file to write the MST edges to, if any
+  binary      -> whether outfile is binary, rather than CSV
+  updates     -> stream of updates for the incremental mode, if any
+  batch       -> stream of graphs for the batch mode, if any
+  timeline    -> file to write the timeline of the run to, if any
+  place       -> whether to place nodes close to their neighbours, and pin them
+                 to cores (see placement.h)
+  owners      -> group of every node (its worker, or its core), once placed
+  order       -> order to relabel the nodes in, if any (see relabel.h)
+  labels      -> old ID of every node, by new ID, once relabelled
+  pieces      -> number of pieces to cut the network into, 1 to keep it whole
+  trees       -> number of components the network has (see forest.h)
+  comp        -> component of every node, by the IDs it was generated with
+  filter      -> whether to drop the edges a sample of the network proves
+                 heavy before running it (see filter.h)
+  replay      -> directory of the recordings to replay, if any
+  algo_opts   -> GHS_OPTIONS for the nodes: which variant of GHS they run, in
+                 which order they handle messages, and what they measure while
+                 at it
+  fun         -> algorithm that each node runs*/
+struct options {
+  uint8_t transport;
+  uint8_t workers;
+  struct tcp_config tcp;
+  int32_t only_worker;
+  uint32_t seed;
+  char *outfile;
+  uint8_t binary;
+  FILE *updates;
+  FILE *batch;
+  char *timeline;
+  uint8_t place;
+  uint8_t *owners;
+  uint8_t order;
+  uint8_t *labels;
+  uint8_t pieces;
+  uint8_t trees;
+  uint8_t *comp;
+  uint8_t filter;
+  char *replay;
+  uint8_t algo_opts;
+  void (*fun) (struct node *node);
+};
 
 /*computes a connectivity matrix, where edges[i][j] being positive will
 correspond to nodes i and j being neighbours, and the value of the cell itself
 will be the weight of the edge.
 this is the DENSE connectivity version, which computes (n-1)(n-2)/2 + 1 edges,
 guaranteeing a connected undirected graph, for any number of nodes*/
-uint16_t *compute_dense_connectivity(uint8_t num_nodes);
+weight_t *compute_dense_connectivity(uint8_t num_nodes);
 
 /*computes a connectivity matrix, where edges[i][j] being positive will
 correspond to nodes i and j being neighbours, and the value of the cell itself
@@ -29,16 +94,69 @@ will be the weight of the edge.
 this is the SPARSE connectivity version, which computes (n-1) edges in a line
 at first, which connects the graph, then generates a random small additional
 amount of edges, for some added complexity, while keeping the network smallish*/
-uint16_t *compute_sparse_connectivity(uint8_t num_nodes);
+weight_t *compute_sparse_connectivity(uint8_t num_nodes);
+
+/*cuts the network with the given connectivity matrix into the given number of
+pieces, by dropping every edge between different slices of the node IDs (split
+as worker_of() splits them). Pieces of a single node are left with no edges at
+all, and pieces of a dense network may come apart further*/
+void cut_connectivity(weight_t *edges, uint8_t num_nodes, uint8_t pieces);
 
 /*initializes socket pairs for each edge in the graph, essentially creating
 the communication channels between the nodes.
 NOTE: this is not a very efficient way of doing this, since we're going through
 n^2 matrix cells to create not as many sockets, but the number of nodes will
 never be too large anyway, so we're ok with it*/
-uint32_t *init_sockets(uint16_t *edges, uint8_t num_nodes);
+uint32_t *init_sockets(weight_t *edges, uint8_t num_nodes);
+
+/*initializes the channels for the multiplexed transport. Rather than one socket
+pair per edge, each node gets a single datagram socket (returned in inboxes),
+named after its ID (see mux_address()), which it receives on and all its
+neighbours send to. The returned socket map has the same layout as
+init_sockets(), but cell [i][j] holds the ID of node j, so the whole network
+only needs n descriptors*/
+uint32_t *init_mux_sockets(weight_t *edges, uint8_t num_nodes,
+                                                        uint32_t **inboxes);
+
+/*runs the network over the TCP transport. Either forks every worker locally,
+or only runs the worker given in only_worker (when it isn't -1), in which case
+the other workers are expected to be started separately, with the same seed.
+Returns 1 on success, 0 otherwise*/
+uint8_t run_tcp(weight_t *edges, uint8_t num_nodes, struct options *opts,
+                                                              FILE *globallog);
+
+/*runs the network in partitioned mode: forks the given number of workers, each
+of which hosts a slice of the nodes (or the group they were placed in) as
+threads, and reports the fraction of the messages that were delivered within a
+worker. Placed workers are pinned to a core each. Returns 1 on success, 0
+otherwise*/
+uint8_t run_partitioned(weight_t *edges, uint8_t num_nodes,
+                        struct options *opts, FILE *globallog);
+
+/*runs the network on the BSP engine, as synchronous rounds of Borůvka, on the
+given number of threads, then reports the rounds it took along with the MST.
+Returns 1 on success, 0 otherwise*/
+uint8_t run_synchronous(weight_t *edges, uint8_t num_nodes,
+                        struct options *opts, FILE *globallog);
+
+/*returns the highest descriptor in the socket map, the inboxes (if any) and
+the results pipe, which is as far as nodes have to look for descriptors that
+aren't theirs*/
+int32_t max_descriptor(uint32_t *sockets, uint32_t *inboxes, uint8_t num_nodes,
+                                                            int32_t *results);
+
+/*collects the nodes' results from the given pipe, until the last node is done,
+then prints a summary, logs it, and writes the MST edges to the output file, if
+one was given. Relabelled nodes go back to their old IDs first. Networks in
+more than one piece also get a summary of their trees*/
+void finish_results(int32_t fd, uint8_t num_nodes, double start,
+                                      struct options *opts, FILE *globallog);
+
+/*prints usage information to stderr*/
+void usage();
 
-/*prints adjacency matrix and socket map to given stream, for debug purposes*/
-void print_network(uint16_t *edges, uint32_t *socks, uint8_t num, FILE *stream);
+/*prints adjacency matrix and socket map to given stream, for debug purposes.
+The socket map is skipped if socks is NULL*/
+void print_network(weight_t *edges, uint32_t *socks, uint8_t num, FILE *stream);
 
 #endif /* MAIN_H */
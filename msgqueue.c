@@ -1,12 +1,14 @@
 #include "msgqueue.h"
 
-uint32_t dequeue(struct msgqueue *queue, uint8_t *buffer) {
+uint32_t dequeue(struct msgqueue *queue, uint8_t *buffer,
+                                                            uint64_t *stamp) {
   struct msg *aux;
 
   pthread_mutex_lock(&queue->mutex);
 
-  /*let's not segfault shall we? do nothing for empty queues or NULL buffers*/
-  if (queue->front == NULL || buffer == NULL) {
+  /*let's not segfault shall we? do nothing for empty queues*/
+  if (queue->front == NULL) {
+    pthread_mutex_unlock(&queue->mutex);
     return 0;
   }
 
@@ -18,9 +20,14 @@ uint32_t dequeue(struct msgqueue *queue, uint8_t *buffer) {
     queue->back = NULL;
   }
 
-  /*copy message content to buffer*/
+  /*copy message content to buffer, NULL buffers simply drop the message*/
   uint32_t len = aux->len;
-  memcpy(buffer, aux->str, len);
+  if (buffer != NULL) {
+    memcpy(buffer, aux->str, len);
+  }
+  if (stamp != NULL) {
+    *stamp = aux->stamp;
+  }
 
   /*free the message's string pointer, then the struct pointer itself*/
   free(aux->str);
@@ -32,6 +39,18 @@ uint32_t dequeue(struct msgqueue *queue, uint8_t *buffer) {
   return len;
 }
 
+struct msg *dequeue_all(struct msgqueue *queue) {
+  struct msg *all;
+
+  /*the whole list is ours, the queue starts over empty*/
+  pthread_mutex_lock(&queue->mutex);
+  all = queue->front;
+  queue->front = queue->back = NULL;
+  pthread_mutex_unlock(&queue->mutex);
+
+  return all;
+}
+
 void enqueue(struct msgqueue *queue, uint8_t *str, uint32_t len) {
   struct msg *newmsg;
   uint8_t *newstr;
@@ -44,6 +63,8 @@ void enqueue(struct msgqueue *queue, uint8_t *str, uint32_t len) {
   memcpy(newstr, str, len);
   newmsg->str = newstr;
   newmsg->len = len;
+  newmsg->stamp = queue_stamp(queue);
+  newmsg->seq = 0;
   newmsg->next = NULL;
 
   pthread_mutex_lock(&queue->mutex);
@@ -58,22 +79,56 @@ void enqueue(struct msgqueue *queue, uint8_t *str, uint32_t len) {
       queue->back = newmsg;
   }
 
+  pthread_cond_signal(&queue->nonempty);
   pthread_mutex_unlock(&queue->mutex);
 }
 
+uint64_t queue_clock() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+void stamp_queue(struct msgqueue *queue) {
+  struct msg *msg;
+  uint64_t now = queue_clock();
+
+  pthread_mutex_lock(&queue->mutex);
+  queue->stamped = 1;
+  for (msg = queue->front; msg != NULL; msg = msg->next) {
+    msg->stamp = now;
+  }
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+uint64_t queue_stamp(struct msgqueue *queue) {
+  return queue->stamped ? queue_clock() : 0;
+}
+
 uint8_t is_empty(struct msgqueue *queue) {
   return (queue->front == NULL);
 }
 
+void wait_queue(struct msgqueue *queue) {
+  pthread_mutex_lock(&queue->mutex);
+  while (queue->front == NULL) {
+    pthread_cond_wait(&queue->nonempty, &queue->mutex);
+  }
+  pthread_mutex_unlock(&queue->mutex);
+}
+
 struct msgqueue *init_queue() {
   struct msgqueue *newqueue;
 
   /*init memory and initialize pointers as NULL*/
   newqueue = (struct msgqueue*) malloc(sizeof(struct msgqueue));
   newqueue->front = newqueue->back = NULL;
+  newqueue->stamped = 0;
 
-  /*and initialize its mutex variable*/
+  /*and initialize its mutex and condition variables*/
   pthread_mutex_init(&newqueue->mutex, NULL);
+  pthread_cond_init(&newqueue->nonempty, NULL);
 
   return newqueue;
 }
@@ -81,10 +136,11 @@ struct msgqueue *init_queue() {
 void free_queue(struct msgqueue *queue) {
   /*empty queue*/
   while (!is_empty(queue)) {
-    dequeue(queue, NULL);
+    dequeue(queue, NULL, NULL);
   }
 
   /*free its memory and destroy mutual exclusion variable*/
   pthread_mutex_destroy(&queue->mutex);
+  pthread_cond_destroy(&queue->nonempty);
   free(queue);
 }
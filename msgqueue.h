@@ -7,39 +7,75 @@
 #include <string.h>     /*because 'string' sounds better than 'char pointer'*/
 #include <pthread.h>    /*because msgqueues are promiscuous sluts*/
 #include <sys/socket.h> /*because messages need roads to travel through*/
+#include <time.h>       /*because waiting is worth measuring*/
 
 /*Struct that represents a queue of messages. The queue has pointers to its
 first and last members, as well as a mutex variable, to guarantee mutual
 exclusion to all accesses to it, since it will be manipulated by multiple
-threads (one per socket).*/
+threads (one per socket). A condition variable lets the consumer sleep until
+a message arrives, rather than spinning on an empty queue. Messages are only
+stamped with the time they arrive when somebody is measuring how long they
+wait (see stamp_queue()), so nobody else pays for reading the clock.*/
 struct msgqueue {
   struct msg *front, *back;
   pthread_mutex_t mutex;
+  pthread_cond_t nonempty;
+  uint8_t stamped;
 };
 
 /*Struct that represents a single message in the queue. The messages are not
 null-terminated. They have a pointer to their content, as well as their length
-in bytes and a pointer to the next message in the queue.*/
+in bytes, the time they were enqueued at (from queue_clock(), or 0 if the queue
+isn't stamped) and a pointer to the next message in the queue. Whoever takes
+messages out of the queue to sort them (see lanes.h) can number them in seq,
+which the queue itself ignores.*/
 struct msg {
   uint8_t *str;
   uint32_t len;
+  uint64_t stamp;
+  uint32_t seq;
   struct msg *next;
 };
 
 /*Removes the first message from the queue and copies the content of the message
 to the given buffer. Returns the length of the message copied (0 for failure).
+If stamp isn't NULL, it gets the time the message was enqueued at.
 This is all done as an atomic operation, to avoid corrupting the queue.*/
-uint32_t dequeue(struct msgqueue *queue, uint8_t *buffer);
+uint32_t dequeue(struct msgqueue *queue, uint8_t *buffer, uint64_t *stamp);
+
+/*Removes every message from the queue at once, and returns them as a list, in
+the order they were inserted (NULL if the queue was empty). The messages are
+the caller's to free from then on.*/
+struct msg *dequeue_all(struct msgqueue *queue);
 
 /*Inserts a message in the back of the queue. We need to know the message's
 length when inserting, since messages are not null-terminated. Therefore, it's
 up to whoever creates the message (or receives it) to compute its length
-properly before inserting in the queue.*/
+properly before inserting in the queue. In stamped queues, messages are stamped
+with the time they were inserted, so whoever dequeues them knows how long they
+waited. Messages put back in the queue are stamped anew.*/
 void enqueue(struct msgqueue *queue, uint8_t *str, uint32_t len);
 
+/*Returns the time of the clock messages are stamped with, in nanoseconds*/
+uint64_t queue_clock();
+
+/*Starts stamping the messages inserted in the given queue from now on. The ones
+already in it are stamped with the current time, since that's when we started
+measuring how long they wait*/
+void stamp_queue(struct msgqueue *queue);
+
+/*Returns what a message inserted in the given queue right now is stamped with:
+the current time if the queue is stamped, 0 otherwise*/
+uint64_t queue_stamp(struct msgqueue *queue);
+
 /*Returns 1 if the given queue is empty. 0 otherwise.*/
 uint8_t is_empty(struct msgqueue *queue);
 
+/*Blocks the calling thread until the given queue has at least one message.
+Since each queue only has a single consumer, the queue is guaranteed to still
+have a message when this returns.*/
+void wait_queue(struct msgqueue *queue);
+
 /*Initializes an initially empty queue structure, allocating memory and
 initializing its mutual exclusion lock*/
 struct msgqueue *init_queue();
@@ -1,14 +1,17 @@
 #include "neighlist.h"
 
-void add_edge(struct neighbours *neighs, uint32_t weight, uint32_t sock) {
+void add_edge(struct neighbours *neighs, weight_t weight, uint32_t sock,
+																uint32_t neigh) {
 	struct edge *aux, *aux2;
 
 	/*in these cases we need to insert at the head*/
-	if (neighs->head == NULL || neighs->head->weight > weight) {
+	if (neighs->head == NULL || neighs->head->weight > weight ||
+			(neighs->head->weight == weight && neighs->head->neigh > neigh)) {
 		aux = neighs->head;
 		neighs->head = (struct edge*) malloc(sizeof(struct edge));
 		neighs->head->weight = weight;
 		neighs->head->sock = sock;
+		neighs->head->neigh = neigh;
 		neighs->head->next = aux;
 	}
 
@@ -16,7 +19,8 @@ void add_edge(struct neighbours *neighs, uint32_t weight, uint32_t sock) {
 	else {
 		/*find insertion point*/
 		aux = neighs->head;
-		while (aux->next != NULL && aux->next->weight < weight) {
+		while (aux->next != NULL && (aux->next->weight < weight ||
+				(aux->next->weight == weight && aux->next->neigh < neigh))) {
 			aux = aux->next;
 		}
 
@@ -26,6 +30,7 @@ void add_edge(struct neighbours *neighs, uint32_t weight, uint32_t sock) {
 		aux->next = aux2->next;
 		aux->weight = weight;
 		aux->sock = sock;
+		aux->neigh = neigh;
 		aux2->next = aux;
 	}
 
@@ -33,16 +38,55 @@ void add_edge(struct neighbours *neighs, uint32_t weight, uint32_t sock) {
 	neighs->num += 1;
 }
 
+void append_edge(struct neighbours *neighs, weight_t weight, uint32_t sock,
+																uint32_t neigh) {
+	struct edge *aux, *new;
+
+	new = (struct edge*) malloc(sizeof(struct edge));
+	new->weight = weight;
+	new->sock = sock;
+	new->neigh = neigh;
+	new->next = NULL;
+
+	/*find the tail, if there is one*/
+	if (neighs->head == NULL) {
+		neighs->head = new;
+	}
+	else {
+		for (aux = neighs->head; aux->next != NULL; aux = aux->next) {}
+		aux->next = new;
+	}
+
+	neighs->num += 1;
+}
+
+struct edge *find_neigh(struct neighbours *neighs, uint32_t neigh) {
+	struct edge *aux;
+
+	/*plain linear search, lists are never too large anyway*/
+	for (aux = neighs->head; aux != NULL; aux = aux->next) {
+		if (aux->neigh == neigh) {
+			return aux;
+		}
+	}
+
+	return NULL;
+}
+
 void print_edges(struct neighbours *neighs, FILE *stream) {
 	struct edge *aux;
 	uint32_t i;
 
+	if (stream == NULL) {
+		return;
+	}
+
 	fprintf(stream, "Edge list [%u]: ", neighs->num);
 
 	/*iterate over edges and print*/
 	aux = neighs->head;
 	for (i = 0; i < neighs->num; i++) {
-		fprintf(stream, "%u[%u] -> ", aux->weight, aux->sock);
+		fprintf(stream, "%" PRIweight "[%u] -> ", aux->weight, aux->sock);
 		aux = aux->next;
 	}
 	fprintf(stream, "\n");
@@ -7,7 +7,8 @@ communication link between the node and one of its neighbours. Each edge keeps
 track of its own weight, as well as the socket used to communicate through it.
 
 It is important to note that we add edges to the list in an ordered fashion, so
-that the list is always sorted from lowest to highest weight. This is done so
+that the list is always sorted from lowest to highest weight (and by neighbour
+ID, for edges with the same weight). This is done so
 that any algorithm that iterates over the list will do so in an increasing
 weight manner, reducing the complexity of finding lowest weight edge, which
 is important for optimal performance in seveal algorithms. This also implies
@@ -19,13 +20,17 @@ never grow too large.*/
 #include <stdlib.h>	//mallocs, frees and whatnot
 #include <stdint.h>	//portable size types (uint8_t, uint32_t, etc)
 
+#include "weight.h"	//whatever type weights were built with
+
 /*Struct that represents an edge between a node and one of its neighbours. As
 our network model describes, each node knows only the weight of the incoming
 edges. We also keep track of the socket that the node must use to communicate
-through that channel.*/
+through that channel, and the ID of the neighbour on the other end, which lets
+transports that share one socket between several edges tell them apart.*/
 struct edge {
-	uint32_t weight;
+	weight_t weight;
 	uint32_t sock;
+	uint32_t neigh;
 	struct edge *next;
 };
 
@@ -36,12 +41,24 @@ struct neighbours {
 	uint32_t num;
 };
 
-/*Adds a given edge to the node's neighbour list, with the provided weight and
-associated socket. We add edges to the list sorted in-place, to keep the list
-increasing in weight.*/
-void add_edge(struct neighbours *neighs, uint32_t weight, uint32_t sock);
+/*Adds a given edge to the node's neighbour list, with the provided weight,
+associated socket and neighbour ID. We add edges to the list sorted in-place, to
+keep the list increasing in weight, with ties broken by neighbour ID.*/
+void add_edge(struct neighbours *neighs, weight_t weight, uint32_t sock,
+																uint32_t neigh);
+
+/*Adds a given edge to the end of the node's neighbour list, regardless of its
+weight. Only for lists that no longer need to be sorted, since it keeps the
+position of every other edge as it is.*/
+void append_edge(struct neighbours *neighs, weight_t weight, uint32_t sock,
+																uint32_t neigh);
+
+/*Returns the edge that leads to the neighbour with the given ID, or NULL if
+there is no such neighbour in the list*/
+struct edge *find_neigh(struct neighbours *neighs, uint32_t neigh);
 
-/*Prints a node's list of edges. Only for debugging purposes*/
+/*Prints a node's list of edges. Only for debugging purposes, so a NULL stream
+prints nothing*/
 void print_edges(struct neighbours *neighs, FILE *stream);
 
 /*Initializes a list of neighbours. Initially the list has size 0, obviously*/
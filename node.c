@@ -1,7 +1,37 @@
 #include "node.h"
+#include "worker.h"
 
-struct node *init_node(int32_t id, uint16_t *edges, uint32_t *socks, uint8_t num,
-                                                              FILE *globallog) {
+struct node_edge *build_adjacency(weight_t *edges, uint32_t *socks, uint8_t num,
+                                                          uint32_t **offsets) {
+  struct node_edge *adj;
+  uint32_t i, j, count = 0;
+
+  /*count everyone's edges first, so it all fits in a single allocation*/
+  *offsets = malloc((num + 1)*sizeof(uint32_t));
+  for (i = 0; i < (uint32_t) num*num; i++) {
+    count += (edges[i] != 0);
+  }
+  adj = malloc((count ? count : 1)*sizeof(struct node_edge));
+
+  count = 0;
+  for (i = 0; i < num; i++) {
+    (*offsets)[i] = count;
+    for (j = 0; j < num; j++) {
+      if (edges[i*num + j]) {
+        adj[count].neigh = j;
+        adj[count].weight = edges[i*num + j];
+        adj[count].sock = socks[i*num + j];
+        count++;
+      }
+    }
+  }
+  (*offsets)[num] = count;
+
+  return adj;
+}
+
+struct node *init_node(int32_t id, struct node_edge *edges, uint32_t num_edges,
+                        uint8_t transport, uint32_t inbox, FILE *globallog) {
   struct node *newnode;
   char logmsg[60];
 
@@ -9,6 +39,14 @@ struct node *init_node(int32_t id, uint16_t *edges, uint32_t *socks, uint8_t num
   newnode = (struct node*) malloc(sizeof(struct node));
   newnode->globallog = globallog;
   newnode->id = id;
+  newnode->transport = transport;
+  newnode->inbox = inbox;
+  newnode->network = 0;
+  newnode->worker = NULL;
+  newnode->seed = NULL;
+  newnode->results = -1;
+  newnode->delays = 1;
+  newnode->algo_opts = 0;
 
   /*And initialize its message queue*/
   newnode->queue = init_queue();
@@ -18,22 +56,18 @@ struct node *init_node(int32_t id, uint16_t *edges, uint32_t *socks, uint8_t num
   log_msg(logmsg, globallog);
 
   /*allocate and initialize edge list, with proper weight/socket pairs*/
-  uint8_t i;
   newnode->neighs = init_neighs();
-  for (i = 0; i < num; i++) {
-    if(edges[id*num + i]) {
-      uint16_t weight, socket;
-      weight = edges[id*num + i];
-      socket = socks[id*num + i];
-      add_edge(newnode->neighs, weight, socket);
-    }
-  }
+  load_edges(newnode, edges, num_edges);
 
   /*log edge initialization*/
   snprintf(logmsg, 60, "Node %d has finished computing edges!", id);
   log_msg(logmsg, globallog);
 
   /*initialize local log file, named after the node's ID*/
+  newnode->log = NULL;
+  if (globallog == NULL) {
+    return newnode;
+  }
   char logfilename[7];
   memset(logfilename, 0, 7);
   snprintf(logfilename, 7, "%d.log", id);
@@ -43,29 +77,111 @@ struct node *init_node(int32_t id, uint16_t *edges, uint32_t *socks, uint8_t num
   return newnode;
 }
 
+void reset_node(struct node *node, struct node_edge *edges, uint32_t num_edges) {
+  /*whatever is left in the queue belongs to the previous network*/
+  while (!is_empty(node->queue)) {
+    dequeue(node->queue, NULL, NULL);
+  }
+
+  free_neighs(node->neighs);
+  node->neighs = init_neighs();
+  load_edges(node, edges, num_edges);
+}
+
+void load_edges(struct node *node, struct node_edge *edges, uint32_t num_edges) {
+  uint32_t i;
+
+  for (i = 0; i < num_edges; i++) {
+    add_edge(node->neighs, edges[i].weight, edges[i].sock, edges[i].neigh);
+  }
+}
+
+void close_other_fds(struct node *node, int32_t max_fd) {
+  uint8_t *keep = calloc(max_fd + 1, sizeof(uint8_t));
+  struct edge *link;
+  int32_t fd;
+
+  /*only sockets the node actually talks through, partitioned and multiplexed
+  nodes send by ID so their "sockets" aren't descriptors at all*/
+  if (node->transport != TRANSPORT_PART && node->transport != TRANSPORT_MUX) {
+    for (link = node->neighs->head; link != NULL; link = link->next) {
+      if ((int32_t) link->sock <= max_fd) {
+        keep[link->sock] = 1;
+      }
+    }
+  }
+  if (node->transport == TRANSPORT_MUX && (int32_t) node->inbox <= max_fd) {
+    keep[node->inbox] = 1;
+  }
+  if (node->results >= 0 && node->results <= max_fd) {
+    keep[node->results] = 1;
+  }
+  if (node->log != NULL && fileno(node->log) <= max_fd) {
+    keep[fileno(node->log)] = 1;
+  }
+  if (node->globallog != NULL && fileno(node->globallog) <= max_fd) {
+    keep[fileno(node->globallog)] = 1;
+  }
+
+  /*leave stdin, stdout and stderr alone*/
+  for (fd = 3; fd <= max_fd; fd++) {
+    if (!keep[fd]) {
+      close(fd);
+    }
+  }
+
+  free(keep);
+}
+
 void run_node(struct node *node, void(*algo) (struct node *node)) {
   uint32_t num_neighs = node->neighs->num;
-  struct thread_data tdata[num_neighs];
-  pthread_t tids[num_neighs];
+  uint32_t num_threads = num_neighs;
+  /*multiplexed nodes need a thread even when they have no neighbours*/
+  struct thread_data tdata[num_neighs + 1];
+  pthread_t tids[num_neighs + 1];
   uint32_t i;
   char logmsg[60];
 
   srand(time(NULL));
 
-  /*start message-receiving threads for each of the node's sockets*/
-  struct edge *aux = node->neighs->head;
-  for (i = 0; i < num_neighs; i++) {
-    tdata[i].sock = aux->sock;
-    tdata[i].queue = node->queue;
-    pthread_create(&tids[i],NULL,receiver_thread,(void*)&tdata[i]);
+  /*multiplexed nodes only need a single thread, receiving on their inbox*/
+  if (node->transport == TRANSPORT_MUX) {
+    num_threads = 1;
+    tdata[0].sock = node->inbox;
+    tdata[0].queue = node->queue;
+    tdata[0].neighs = node->neighs;
+    pthread_create(&tids[0],NULL,mux_receiver_thread,(void*)&tdata[0]);
     snprintf(logmsg, 60, "Node %d now has thread %li receiving on fd %d",
-                                              node->id, tids[i], tdata[i].sock);
+                                              node->id, tids[0], tdata[0].sock);
     log_msg(logmsg, node->log);
-    aux = aux->next;
+  }
+
+  /*partitioned nodes don't receive anything themselves, their worker fills
+  their queues*/
+  else if (node->transport == TRANSPORT_PART) {
+    num_threads = 0;
+  }
+
+  /*otherwise start message-receiving threads for each of the node's sockets*/
+  else {
+    struct edge *aux = node->neighs->head;
+    for (i = 0; i < num_neighs; i++) {
+      tdata[i].sock = aux->sock;
+      tdata[i].queue = node->queue;
+      tdata[i].neighs = node->neighs;
+      pthread_create(&tids[i], NULL, node->transport == TRANSPORT_TCP ?
+                   stream_receiver_thread : receiver_thread, (void*)&tdata[i]);
+      snprintf(logmsg, 60, "Node %d now has thread %li receiving on fd %d",
+                                              node->id, tids[i], tdata[i].sock);
+      log_msg(logmsg, node->log);
+      aux = aux->next;
+    }
   }
 
   /*sleep for a random amount of time so all nodes don't start simultaneously*/
-  randsleep();
+  if (node->delays) {
+    randsleep();
+  }
 
   /*log beginning of node execution and start algorithm*/
   snprintf(logmsg, 60, "Node %d is beginning algorithm execution!", node->id);
@@ -76,10 +192,11 @@ void run_node(struct node *node, void(*algo) (struct node *node)) {
   /*log node's execution finish*/
   snprintf(logmsg, 50, "Node %d has finished algorithm execution!", node->id);
   log_msg(logmsg, node->log);
+  write_result(node->results, RESULT_DONE, node->id, NULL, 0);
 
   /*terminate all of the node's receiving threads (we can't simply join them
   because they run forever, so we forcibly terminate them first)*/
-  for (i = 0; i < num_neighs; i++) {
+  for (i = 0; i < num_threads; i++) {
     pthread_cancel(tids[i]);
     pthread_join(tids[i], NULL);
   }
@@ -87,10 +204,14 @@ void run_node(struct node *node, void(*algo) (struct node *node)) {
 
 void log_msg(char *msg, FILE *logfile) {
   struct timeval tv;
-  struct tm *tm_info;
+  struct tm *tm_info, tm_buf;
   uint32_t ms;
   char timestamp[15], hms[10];
 
+  if (logfile == NULL) {
+    return;
+  }
+
   /*get time of day in secs and ms/usecs*/
   gettimeofday(&tv, NULL);
 
@@ -101,8 +222,8 @@ void log_msg(char *msg, FILE *logfile) {
     tv.tv_sec++;
   }
 
-  /*convert secs to local time*/
-  tm_info = localtime(&tv.tv_sec);
+  /*convert secs to local time (reentrant, nodes might be sharing a process)*/
+  tm_info = localtime_r(&tv.tv_sec, &tm_buf);
 
   /*concatenate localtime + milliseconds to final timestamp*/
   strftime(hms, 10, "%H:%M:%S", tm_info);
@@ -121,12 +242,80 @@ void free_node(struct node *node) {
   log_msg(logmsg, node->globallog);
 
   /*close its fds and free its memory*/
-  fclose(node->log);
+  if (node->log != NULL) {
+    fclose(node->log);
+  }
   free_neighs(node->neighs);
   free_queue(node->queue);
   free(node);
 }
 
+void send_msg(struct node *node, uint32_t sock, uint8_t *msg, uint32_t len) {
+  uint8_t frame[50 + STREAM_HDR_LEN];
+  struct sockaddr_un addr;
+  socklen_t addr_len;
+
+  /*replayed nodes have nobody to talk to*/
+  if (node->transport == TRANSPORT_NONE) {
+    return;
+  }
+
+  /*partitioned nodes leave the routing to their worker*/
+  if (node->transport == TRANSPORT_PART) {
+    worker_send(node->worker, node->id, sock, msg, len);
+    return;
+  }
+
+  /*per-edge sockets already identify the sender, so send messages as they are*/
+  if (node->transport == TRANSPORT_EDGE) {
+    send(sock, msg, len, 0);
+    return;
+  }
+
+  /*streams don't keep message boundaries, so prepend the length instead. The
+  peer might be a remote worker that went away, don't let that kill us*/
+  if (node->transport == TRANSPORT_TCP) {
+    uint32_t sent = 0;
+    int32_t ret;
+    frame[0] = len;
+    memcpy(frame + STREAM_HDR_LEN, msg, len);
+    while (sent < len + STREAM_HDR_LEN) {
+      ret = send(sock, frame + sent, len + STREAM_HDR_LEN - sent, MSG_NOSIGNAL);
+      if (ret <= 0) {
+        return;
+      }
+      sent += ret;
+    }
+    return;
+  }
+
+  /*multiplexed sockets are shared, but messages carry our ID already, so send
+  them as they are, from our own socket to the one named after the neighbour*/
+  addr_len = mux_address(&addr, node->network, sock);
+  if (sendto(node->inbox, msg, len, 0, (struct sockaddr *) &addr, addr_len) !=
+                                                              (ssize_t) len) {
+    fprintf(stderr, "Node %d could not send to %d!\n", node->id, sock);
+  }
+}
+
+socklen_t mux_address(struct sockaddr_un *addr, uint32_t network, uint8_t id) {
+  memset(addr, 0, sizeof(struct sockaddr_un));
+  addr->sun_family = AF_UNIX;
+
+  /*abstract names start with a null byte, and aren't null terminated*/
+  snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "ghs-%u-%u",
+                                                                network, id);
+  return offsetof(struct sockaddr_un, sun_path) + 1 + strlen(addr->sun_path + 1);
+}
+
+void report_edge(struct node *node, uint32_t neigh, weight_t weight) {
+  struct result_edge edge;
+
+  edge.neigh = neigh;
+  edge.weight = weight;
+  write_result(node->results, RESULT_EDGE, node->id, &edge, sizeof(edge));
+}
+
 void *receiver_thread(void *thread_data) {
   /*retrieve thread data and initialize structures*/
   struct thread_data *data = (struct thread_data *) thread_data;
@@ -147,9 +336,75 @@ void *receiver_thread(void *thread_data) {
   }
 }
 
+void *mux_receiver_thread(void *thread_data) {
+  /*retrieve thread data and initialize structures*/
+  struct thread_data *data = (struct thread_data *) thread_data;
+  struct msgqueue *queue = data->queue;
+  uint32_t sock = data->sock;
+
+  /*message buffers*/
+  uint8_t msg[50];
+  uint16_t sender;
+  int32_t len;
+
+  /*receive messages indefinitely, demultiplex them by sender and queue them.
+  Every message starts with its type and the sender's 16-bit ID*/
+  while (1) {
+    memset(msg, 0, 50);
+    len = recv(sock, msg, 50, 0);
+    if (len < 3) {
+      continue;
+    }
+
+    /*drop anything that didn't come from one of our neighbours*/
+    sender = (msg[1] << 8) | msg[2];
+    if (find_neigh(data->neighs, sender) == NULL) {
+      fprintf(stderr, "Dropping message from unknown sender %d!\n", sender);
+      continue;
+    }
+
+    randsleep();
+    enqueue(queue, msg, len);
+  }
+}
+
+void *stream_receiver_thread(void *thread_data) {
+  /*retrieve thread data and initialize structures*/
+  struct thread_data *data = (struct thread_data *) thread_data;
+  struct msgqueue *queue = data->queue;
+  uint32_t sock = data->sock;
+
+  /*message buffers*/
+  uint8_t msg[50], len;
+
+  /*read the length first, then exactly that many bytes of message*/
+  while (1) {
+    memset(msg, 0, 50);
+    if (recv(sock, &len, STREAM_HDR_LEN, MSG_WAITALL) != STREAM_HDR_LEN) {
+      break;
+    }
+    if (len == 0 || len > 50 || recv(sock, msg, len, MSG_WAITALL) != len) {
+      break;
+    }
+    randsleep();
+    enqueue(queue, msg, len);
+  }
+
+  return NULL;
+}
+
 void randsleep() {
   long long int usec;
 
   usec = rand() % 3500000L;
   usleep(usec);
 }
+
+void backoff(struct node *node) {
+  if (node->delays) {
+    sleep(1);
+  }
+  else {
+    sched_yield();
+  }
+}
@@ -12,12 +12,16 @@ communication, and a message queue from which they dequeue messages in order*/
 #include <time.h>       /*timestamps*/
 #include <unistd.h>     /*sleeps and stuff*/
 #include <math.h>       /*because timestamps require work*/
+#include <sched.h>      /*yielding, when we're in a hurry*/
 
 #include <sys/time.h>   /*BETTER timestamps!*/
 #include <sys/socket.h> /*communication is the staple of a stable relationship*/
+#include <sys/un.h>     /*multiplexed inboxes have names*/
+#include <stddef.h>     /*and names have lengths*/
 
 #include "neighlist.h"  /*implementation of neighbour list*/
 #include "msgqueue.h"   /*implementation of the node's message queue*/
+#include "results.h"    /*reporting results back to the parent*/
 
 /*Struct that represents a given node in the network.
 A node only knows two things: its own unique ID, and which incoming edges it
@@ -27,29 +31,122 @@ through them). A node also keeps track of its own local log file, where it
 outputs local events, and the global log file, which it inherits from the parent
 process.
 Each node also has a general message queue, which contains all the messages it
-receives from its neighbours, in the proper order*/
+receives from its neighbours, in the proper order. Nodes also know which
+transport they were set up with, and for the multiplexed transport they keep
+the socket on which all of their incoming messages arrive, and the network its
+name belongs to (see mux_address()). Partitioned nodes keep a pointer to the
+worker hosting them, which routes their messages, and may start out in a
+fragment their worker put together (NULL otherwise, see contract.h). Nodes may
+be given a descriptor on which to report their results to the parent (negative
+if nobody is collecting them). Nodes normally add artificial delays to simulate
+an asynchronous network, unless told otherwise. Finally, nodes carry options
+for the algorithm they run, as given in the command line, which mean nothing to
+the node itself*/
+struct worker;
+struct seed;
 struct node {
   uint8_t id;
+  uint8_t transport;
+  uint32_t inbox;
+  uint32_t network;
+  struct worker *worker;
+  struct seed *seed;
+  int32_t results;
+  uint8_t delays;
+  uint8_t algo_opts;
   FILE *log;
   FILE *globallog;
   struct neighbours *neighs;
   struct msgqueue *queue;
 };
 
+/*Transports that can carry messages between nodes. With TRANSPORT_EDGE every
+edge is a socket pair of its own, so nodes hold one descriptor per edge and
+messages go out as they are. With TRANSPORT_MUX every node owns a single
+datagram socket, named after its ID, that all of its neighbours send to from
+their own. Messages go out as they are, since every message already carries the
+sender's ID (see create_msg()), which tells the receiver which edge it came
+through. Edges then simply store the neighbour's ID.
+TRANSPORT_TCP is used when nodes are spread over several worker processes, which
+may live on different hosts. Every edge is still a socket of its own, but they
+are stream sockets (TCP across workers, UNIX within a worker), so each message
+is prefixed with its length to keep message boundaries.
+TRANSPORT_PART is used when many nodes share a worker process, each running in
+its own thread. Edges then store the neighbour's ID, and the worker delivers
+messages straight to the neighbour's queue when it lives in the same worker, or
+forwards them to the worker that owns it otherwise.
+TRANSPORT_NONE is only used when replaying a recorded run, where every message a
+node gets comes from the recording, so whatever it sends is simply dropped.
+TRANSPORT_BSP doesn't set up any nodes at all: the network runs as vertices of
+the synchronous-round engine instead (see bsp.h), which has no queues.*/
+enum TRANSPORTS {
+  TRANSPORT_EDGE = 0,
+  TRANSPORT_MUX,
+  TRANSPORT_TCP,
+  TRANSPORT_PART,
+  TRANSPORT_NONE,
+  TRANSPORT_BSP
+};
+
+/*Length of the header prepended to stream messages (message length)*/
+#define STREAM_HDR_LEN 1
+
+/*An edge as handed over to a node: the neighbour on the other end, the edge's
+weight, and the socket the node uses to talk through it*/
+struct node_edge {
+  uint32_t neigh;
+  weight_t weight;
+  uint32_t sock;
+};
+
 /*Struct that stores all the data required for a socket-receiving thread to run.
 The threads need to know their respective sockets, as well as a pointer to the
-queue where they need to insert the incoming messages*/
+queue where they need to insert the incoming messages. Multiplexed receivers
+also need the neighbour list, to demultiplex incoming messages by sender*/
 struct thread_data {
   struct msgqueue *queue;
+  struct neighbours *neighs;
   uint32_t sock;
 };
 
+/*Builds the list of edges of every node out of the connectivity matrix and the
+socket map, as a single array in which node i's edges take up positions
+offsets[i] to offsets[i+1] - 1 (offsets is allocated here too). This is what
+nodes are initialized from, so they never need the n^2 matrices themselves*/
+struct node_edge *build_adjacency(weight_t *edges, uint32_t *socks, uint8_t num,
+                                                          uint32_t **offsets);
+
 /*Initializes the structure to represent a node. At this point we compute all
 the information that a node actually has access to, such as its ID, which edges
 it has and their respective weights/associated sockets, the number of neighbours
-they have, and their local log file.*/
-struct node *init_node(int32_t id, uint16_t *edges, uint32_t *socks, uint8_t num,
-              FILE *globallog);
+they have, and their local log file. The node only gets its own edges, as built
+by build_adjacency(). For TRANSPORT_MUX, the edges' sockets are the IDs of the
+neighbours, and inbox is the node's own socket (ignored for TRANSPORT_EDGE).
+Its network is 0 until the caller sets it. Nodes given no global log don't keep
+a local log either, and log nothing at all.*/
+struct node *init_node(int32_t id, struct node_edge *edges, uint32_t num_edges,
+              uint8_t transport, uint32_t inbox, FILE *globallog);
+
+/*Replaces the node's edges with the given ones, so the node can be reused for
+another network. Any messages left in its queue are dropped. Only for nodes
+that aren't running.*/
+void reset_node(struct node *node, struct node_edge *edges, uint32_t num_edges);
+
+/*Adds the given edges to the node's neighbour list*/
+void load_edges(struct node *node, struct node_edge *edges, uint32_t num_edges);
+
+/*Closes every descriptor up to max_fd that the node doesn't use itself, which
+is everything but its edges' sockets, its inbox, its results descriptor and its
+logs. For nodes forked off a parent that holds every channel in the network, so
+each of them ends up holding only O(degree) descriptors (a single one, when
+multiplexed)*/
+void close_other_fds(struct node *node, int32_t max_fd);
+
+/*Fills in the name of the multiplexed socket of the node with the given ID, in
+the given network (the PID of the process that set it up, so several runs
+never share names). Names are abstract, so they need no files and go away with
+their sockets. Returns the length of the address*/
+socklen_t mux_address(struct sockaddr_un *addr, uint32_t network, uint8_t id);
 
 /*Initializes the node's algorithm execution, through function implemented in
 algo*/
@@ -57,7 +154,8 @@ void run_node(struct node *node, void (*algo) (struct node *node));
 
 /*Writes the given log message to given log file. The log file will be either
 the node's own local log, or the global distributed log. The log message will
-be appropriately timestamped, down to millisecond precision (hopefully).*/
+be appropriately timestamped, down to millisecond precision (hopefully). Does
+nothing if the log file is NULL.*/
 void log_msg(char *msg, FILE *logfile);
 
 /*Essentially terminates a node's existence, freeing its memory, closing its
@@ -66,14 +164,38 @@ child processes that run the nodes finish executing they will be deallocated
 automatically anyway, but we do this manually to stop Valgrind being a nag*/
 void free_node(struct node *node);
 
+/*Sends a message to the neighbour at the other end of the edge represented by
+sock, framing it as required by the node's transport. Algorithms should always
+go through this instead of calling send() themselves. Multiplexed messages that
+can't be sent are reported on stderr, since nothing else would notice.*/
+void send_msg(struct node *node, uint32_t sock, uint8_t *msg, uint32_t len);
+
+/*Reports one of the node's MST edges to the parent, as the edge leading to the
+given neighbour, with the given weight*/
+void report_edge(struct node *node, uint32_t neigh, weight_t weight);
+
 /*Receives a socket as input, and waits for incoming messages on the given
 socket, adding them to the node's message queue whenever they arrive. This
 function will be instantiated by several threads in a given node, with each
 thread receiving messages on one socket*/
 void *receiver_thread(void *thread_data);
 
+/*Same as receiver_thread, but for the node's multiplexed inbound socket. A
+single thread per node receives every message, and checks the sender ID the
+message carries is actually one of the node's neighbours before queueing it*/
+void *mux_receiver_thread(void *thread_data);
+
+/*Same as receiver_thread, but for stream sockets. Reads one length-prefixed
+frame at a time, and exits once the other end of the connection goes away*/
+void *stream_receiver_thread(void *thread_data);
+
 /*Sleeps for a random amount of time, between 0-3500ms, to add asynchrony to
 the network*/
 void randsleep();
 
+/*Called by algorithms after putting a message they can't handle yet back into
+the queue. Sleeps for a second, to avoid spinning on the message, unless the
+node runs without delays, in which case it only yields the processor*/
+void backoff(struct node *node);
+
 #endif /* NODE_H */
@@ -0,0 +1,147 @@
+#include "placement.h"
+
+uint8_t *place_slices(uint8_t num_nodes, uint8_t groups) {
+  uint8_t *owners = malloc(num_nodes*sizeof(uint8_t));
+  uint16_t i;
+
+  for (i = 0; i < num_nodes; i++) {
+    owners[i] = worker_of(i, num_nodes, groups);
+  }
+
+  return owners;
+}
+
+uint8_t *place_nodes(weight_t *edges, uint8_t num_nodes, uint8_t groups) {
+  uint8_t *owners = malloc(num_nodes*sizeof(uint8_t));
+  uint8_t *gains = malloc(num_nodes*sizeof(uint8_t));
+  weight_t *lightest = malloc(num_nodes*sizeof(weight_t));
+  uint8_t *left = calloc(num_nodes, sizeof(uint8_t));
+  uint8_t *slices = place_slices(num_nodes, groups);
+  uint16_t i, j, k, size, placed;
+
+  memset(owners, PLACE_NONE, num_nodes);
+  for (i = 0; i < num_nodes; i++) {
+    for (j = 0; j < num_nodes; j++) {
+      left[i] += (edges[i*num_nodes + j] != 0);
+    }
+  }
+
+  for (k = 0; k < groups; k++) {
+    /*same size as the slice would be*/
+    for (size = 0, i = 0; i < num_nodes; i++) {
+      size += (slices[i] == k);
+    }
+
+    memset(gains, 0, num_nodes);
+    for (i = 0; i < num_nodes; i++) {
+      lightest[i] = WEIGHT_MAX;
+    }
+    for (placed = 0; placed < size; placed++) {
+      i = next_placed(owners, gains, left, lightest, num_nodes);
+      if (i == PLACE_NONE) {
+        break;
+      }
+
+      /*its neighbours have one more edge into the group, and one less left*/
+      owners[i] = k;
+      for (j = 0; j < num_nodes; j++) {
+        weight_t weight = edges[i*num_nodes + j];
+        if (weight != 0) {
+          gains[j]++;
+          left[j]--;
+          lightest[j] = (weight < lightest[j]) ? weight : lightest[j];
+        }
+      }
+    }
+  }
+
+  free(gains);
+  free(lightest);
+  free(left);
+  free(slices);
+  return owners;
+}
+
+uint8_t next_placed(uint8_t *owners, uint8_t *gains, uint8_t *left,
+                                        weight_t *lightest, uint8_t num_nodes) {
+  uint16_t i, best = PLACE_NONE;
+
+  /*a node with no edges into the group only wins if no other node has any,
+  which starts the group (or carries on past the end of a component)*/
+  for (i = 0; i < num_nodes; i++) {
+    if (owners[i] != PLACE_NONE) {
+      continue;
+    }
+    if (best == PLACE_NONE || gains[i] > gains[best] ||
+        (gains[i] == gains[best] && (left[i] < left[best] ||
+        (left[i] == left[best] && lightest[i] < lightest[best])))) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+uint32_t cut_edges(weight_t *edges, uint8_t *owners, uint8_t num_nodes) {
+  uint32_t cut = 0;
+  uint16_t i, j;
+
+  for (i = 0; i < num_nodes; i++) {
+    for (j = i + 1; j < num_nodes; j++) {
+      cut += (edges[i*num_nodes + j] != 0 && owners[i] != owners[j]);
+    }
+  }
+
+  return cut;
+}
+
+void print_placement(weight_t *edges, uint8_t *owners, uint8_t num_nodes,
+                                                uint8_t groups, FILE *stream) {
+  uint8_t *slices = place_slices(num_nodes, groups);
+  uint32_t total = 0;
+  uint16_t i, j;
+
+  for (i = 0; i < num_nodes; i++) {
+    for (j = i + 1; j < num_nodes; j++) {
+      total += (edges[i*num_nodes + j] != 0);
+    }
+  }
+
+  fprintf(stream, "Placement: %u of %u edges between %u groups (%u with "
+                  "slices)\n", cut_edges(edges, owners, num_nodes), total,
+                  groups, cut_edges(edges, slices, num_nodes));
+  free(slices);
+}
+
+uint8_t count_cores() {
+  cpu_set_t allowed;
+  int32_t count;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+    return 1;
+  }
+  count = CPU_COUNT(&allowed);
+
+  return (count < 1) ? 1 : (count > 255) ? 255 : count;
+}
+
+uint8_t pin_to_core(uint8_t group) {
+  cpu_set_t allowed, core;
+  int32_t cpu, nth;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+    return 0;
+  }
+
+  /*the group-th core we're allowed on, going around if there are fewer*/
+  nth = group % CPU_COUNT(&allowed);
+  for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed) && nth-- == 0) {
+      break;
+    }
+  }
+
+  CPU_ZERO(&core);
+  CPU_SET(cpu, &core);
+  return sched_setaffinity(0, sizeof(core), &core) == 0;
+}
@@ -0,0 +1,69 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+/*This file implements placing nodes close to the neighbours they talk to. By
+default, partitioned workers host contiguous slices of the node IDs, and node
+processes run wherever the scheduler puts them, so neighbours that keep sending
+each other messages are as likely as not to sit on different workers, or
+different cores. With '-L', the parent first splits the network into groups of
+(almost) the same sizes as the slices, with as few edges between groups as it
+can manage, and then every group runs on a core of its own: each partitioned
+worker hosts a group, and is pinned to a core, or, when every node is a process
+of its own, each node process is pinned to its group's core.
+Groups are grown one at a time, breadth first: a group starts from the node
+with the fewest neighbours left to place, and keeps taking whichever node has
+the most edges into it, until it's as big as it should be. Ties go to the node
+that leaves the fewest of its edges to be cut later, then to the one with the
+lightest edge into the group (which GHS will send the most messages through),
+then to the lowest ID.*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /*CPU sets, for pinning*/
+#endif
+
+#include <stdio.h>      /*reporting the cut*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*memsets*/
+#include <sched.h>      /*affinities*/
+
+#include "weight.h"     /*the adjacency matrix holds weights*/
+#include "worker.h"     /*how workers slice the nodes otherwise*/
+
+/*Group of nodes nobody has placed yet*/
+#define PLACE_NONE 0xFF
+
+/*Returns the group of each node when the nodes are split into the given number
+of contiguous slices, as worker_of() splits them*/
+uint8_t *place_slices(uint8_t num_nodes, uint8_t groups);
+
+/*Returns the group of each node when the network with the given adjacency
+matrix is split into the given number of groups, as described above. Groups
+have the same sizes as the slices*/
+uint8_t *place_nodes(weight_t *edges, uint8_t num_nodes, uint8_t groups);
+
+/*Returns the next node to place in the group being grown, or PLACE_NONE if
+every node is placed already. Gains holds how many edges each node has into the
+group, left how many of its neighbours are still to be placed, and lightest the
+weight of its lightest edge into the group*/
+uint8_t next_placed(uint8_t *owners, uint8_t *gains, uint8_t *left,
+                                        weight_t *lightest, uint8_t num_nodes);
+
+/*Returns how many edges of the network have their endpoints in different
+groups*/
+uint32_t cut_edges(weight_t *edges, uint8_t *owners, uint8_t num_nodes);
+
+/*Prints how many edges the given placement cuts, next to how many the slices
+would*/
+void print_placement(weight_t *edges, uint8_t *owners, uint8_t num_nodes,
+                                                uint8_t groups, FILE *stream);
+
+/*Returns how many cores the process may run on, at most 255*/
+uint8_t count_cores();
+
+/*Pins the calling thread (and any thread it creates afterwards) to the core
+of the given group, going around the cores the process may run on. Returns 1
+on success, 0 otherwise*/
+uint8_t pin_to_core(uint8_t group);
+
+#endif /* PLACEMENT_H */
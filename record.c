@@ -0,0 +1,39 @@
+#include "record.h"
+#include "algorithm.h"
+
+FILE *open_recording(struct node *node) {
+  uint8_t hdr[9], neigh[1 + WEIGHT_LEN];
+  char filename[12];
+  struct edge *link;
+  FILE *rec;
+
+  snprintf(filename, 12, "%d.rec", node->id);
+  if ((rec = fopen(filename, "wb")) == NULL) {
+    fprintf(stderr, "Node %d could not create its recording!\n", node->id);
+    return NULL;
+  }
+
+  /*the header has everything needed to rebuild the node*/
+  memcpy(hdr, REPLAY_MAGIC, 4);
+  hdr[4] = WEIGHT_LEN;
+  hdr[5] = node->id;
+  hdr[6] = node->neighs->num >> 8;
+  hdr[7] = node->neighs->num & 0xFF;
+  hdr[8] = node->algo_opts & GHS_VARIANTS;
+  fwrite(hdr, 1, 9, rec);
+
+  for (link = node->neighs->head; link != NULL; link = link->next) {
+    neigh[0] = link->neigh;
+    put_weight(neigh + 1, link->weight);
+    fwrite(neigh, 1, 1 + WEIGHT_LEN, rec);
+  }
+
+  return rec;
+}
+
+void record_msg(FILE *rec, uint8_t *msg, uint32_t len) {
+  uint8_t len_byte = len;
+
+  fwrite(&len_byte, 1, 1, rec);
+  fwrite(msg, 1, len, rec);
+}
@@ -0,0 +1,49 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+/*This file implements recording the order in which nodes handle their
+messages. Runs are nondeterministic, since they depend on how threads get
+scheduled and on the random delays, so a slow run can't simply be run again.
+But a GHS node is deterministic given the messages it dequeues, in order: that
+alone decides what it sends, and the state it ends up in. So when recording,
+every node writes the messages it dequeues to its own file, and replaying a
+node means feeding its handlers those same messages, in the same order, with no
+transport at all (whatever it sends is dropped). Messages a node puts back in
+its queue aren't put back when replaying, since the recording has the point
+where the node dequeued them again. Nodes record themselves as they run,
+replaying their recordings is up to the command line (see replay.h).
+
+Each node's recording goes to "<id>.rec", next to its log. The file starts with
+a header describing the node (which is all we need to rebuild it):
+  magic        -> the bytes "GHSR"
+  weight_len   -> WEIGHT_LEN of the binary that recorded it
+  id           -> the node's ID
+  num_neighs   -> number of neighbours, as a 16-bit big-endian integer
+  variant      -> the GHS_VARIANTS bits of the node's options, since a node
+                  only behaves the same if it runs the same variant
+  neighbours   -> each neighbour's ID (one byte) and edge weight (WEIGHT_LEN
+                  bytes, as written by put_weight)
+Followed by a record per message dequeued: its length (one byte) and then its
+bytes, as they were in the queue.*/
+
+#include <stdio.h>      /*recordings are files*/
+#include <stdint.h>     /*sized integers for the file format*/
+#include <string.h>     /*memcpys*/
+
+#include "node.h"       /*nodes are what we record*/
+#include "weight.h"     /*and their edges have weights*/
+
+/*Bytes at the start of every recording*/
+#define REPLAY_MAGIC "GHSR"
+
+/*Longest message a node can dequeue (the size of its receive buffer)*/
+#define REPLAY_MAX_MSG 50
+
+/*Creates the given node's recording, writing out its header. Returns NULL if
+the file could not be created*/
+FILE *open_recording(struct node *node);
+
+/*Appends a dequeued message to a recording*/
+void record_msg(FILE *rec, uint8_t *msg, uint32_t len);
+
+#endif /* RECORD_H */
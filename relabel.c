@@ -0,0 +1,159 @@
+#include "relabel.h"
+
+uint8_t *order_nodes(weight_t *edges, uint8_t num_nodes, uint8_t order) {
+  uint8_t *labels = malloc(num_nodes*sizeof(uint8_t));
+  uint8_t *degrees = calloc(num_nodes, sizeof(uint8_t));
+  uint8_t *placed = calloc(num_nodes, sizeof(uint8_t));
+  uint16_t i, j, k, start, head, count = 0;
+
+  for (i = 0; i < num_nodes; i++) {
+    for (j = 0; j < num_nodes; j++) {
+      degrees[i] += (edges[i*num_nodes + j] != 0);
+    }
+  }
+
+  /*busiest nodes first, ties going to the lowest old ID*/
+  if (order == ORDER_DEGREE) {
+    for (i = 0; i < num_nodes; i++) {
+      for (j = i; j > 0 && degrees[labels[j-1]] < degrees[i]; j--) {
+        labels[j] = labels[j-1];
+      }
+      labels[j] = i;
+    }
+    count = num_nodes;
+  }
+
+  while (count < num_nodes) {
+    /*every component starts from the unplaced node with the fewest neighbours,
+    which tends to be at its edge*/
+    for (start = num_nodes, i = 0; i < num_nodes; i++) {
+      if (!placed[i] && (start == num_nodes || degrees[i] < degrees[start])) {
+        start = i;
+      }
+    }
+    placed[start] = 1;
+    labels[count++] = start;
+
+    for (head = count - 1; head < count; head++) {
+      /*take the node's unplaced neighbours, by old ID...*/
+      for (k = count, j = 0; j < num_nodes; j++) {
+        if (edges[labels[head]*num_nodes + j] != 0 && !placed[j]) {
+          placed[j] = 1;
+          labels[count++] = j;
+        }
+      }
+
+      /*...or by number of neighbours, fewest first, for Cuthill-McKee*/
+      for (i = k + 1; order == ORDER_RCM && i < count; i++) {
+        uint8_t aux = labels[i];
+        for (j = i; j > k && degrees[labels[j-1]] > degrees[aux]; j--) {
+          labels[j] = labels[j-1];
+        }
+        labels[j] = aux;
+      }
+    }
+  }
+
+  for (i = 0; order == ORDER_RCM && i < num_nodes/2; i++) {
+    uint8_t aux = labels[i];
+    labels[i] = labels[num_nodes - 1 - i];
+    labels[num_nodes - 1 - i] = aux;
+  }
+
+  free(degrees);
+  free(placed);
+  return labels;
+}
+
+weight_t *relabel_edges(weight_t *edges, uint8_t *labels, uint8_t num_nodes) {
+  weight_t *relabelled = malloc(num_nodes*num_nodes*sizeof(weight_t));
+  uint16_t i, j;
+
+  for (i = 0; i < num_nodes; i++) {
+    for (j = 0; j < num_nodes; j++) {
+      relabelled[i*num_nodes + j] = edges[labels[i]*num_nodes + labels[j]];
+    }
+  }
+
+  return relabelled;
+}
+
+void edge_spans(weight_t *edges, uint8_t num_nodes, uint32_t *widest,
+                                                                double *mean) {
+  uint32_t i, j, count = 0, total = 0;
+
+  *widest = 0;
+  for (i = 0; i < num_nodes; i++) {
+    for (j = i + 1; j < num_nodes; j++) {
+      if (edges[i*num_nodes + j] != 0) {
+        *widest = (j - i > *widest) ? j - i : *widest;
+        total += j - i;
+        count++;
+      }
+    }
+  }
+
+  *mean = count ? (double) total/count : 0;
+}
+
+void print_relabelling(weight_t *edges, weight_t *relabelled,
+                                            uint8_t num_nodes, FILE *stream) {
+  uint32_t widest, old_widest;
+  double mean, old_mean;
+
+  edge_spans(edges, num_nodes, &old_widest, &old_mean);
+  edge_spans(relabelled, num_nodes, &widest, &mean);
+  fprintf(stream, "Relabelling: band of %u, mean gap %.1f (was %u, %.1f)\n",
+                                          widest, mean, old_widest, old_mean);
+}
+
+void print_labels(uint8_t *labels, uint8_t num_nodes, FILE *stream) {
+  uint16_t i;
+
+  fprintf(stream, "--------------- DEBUG: Node Labels ---------------\n");
+  for (i = 0; i < num_nodes; i++) {
+    fprintf(stream, "%d\t", labels[i]);
+  }
+  fprintf(stream, "\n\n\n");
+}
+
+void unlabel_results(struct mst_result *res, uint8_t *labels) {
+  double *finished = calloc(res->num_nodes, sizeof(double));
+  uint32_t i, aux;
+
+  for (i = 0; i < res->num_nodes; i++) {
+    finished[labels[i]] = res->finished[i];
+  }
+  free(res->finished);
+  res->finished = finished;
+
+  for (i = 0; i < res->num_edges; i++) {
+    struct mst_edge *edge = &res->edges[i];
+    edge->u = labels[edge->u];
+    edge->v = labels[edge->v];
+    if (edge->u > edge->v) {
+      aux = edge->u;
+      edge->u = edge->v;
+      edge->v = aux;
+    }
+  }
+  sort_edges(res->edges, res->num_edges);
+
+  /*fragments are named after their core edge, lowest endpoint first. Nodes
+  that haven't joined one yet have no endpoints to turn back (both are 0)*/
+  for (i = 0; i < res->num_phases; i++) {
+    struct result_phase *phase = &res->phases[i];
+    if (phase->node < res->num_nodes) {
+      phase->node = labels[phase->node];
+    }
+    if (phase->frag_lo != phase->frag_hi && phase->frag_hi < res->num_nodes) {
+      phase->frag_lo = labels[phase->frag_lo];
+      phase->frag_hi = labels[phase->frag_hi];
+      if (phase->frag_lo > phase->frag_hi) {
+        aux = phase->frag_lo;
+        phase->frag_lo = phase->frag_hi;
+        phase->frag_hi = aux;
+      }
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef RELABEL_H
+#define RELABEL_H
+
+/*This file implements relabelling the nodes of a network, so that neighbours
+end up with IDs close to each other. The generators hand out IDs with no regard
+for who's adjacent to whom (past the sparse networks' backbone), so a node's
+row of the adjacency and socket maps points all over them, and so do the
+workers' node tables, and contiguous slices of the IDs split neighbours up.
+With '-N', the parent numbers the nodes again right after generating the
+network, and runs that one instead:
+  bfs    -> breadth first, starting from a node with the fewest neighbours, and
+            taking each node's neighbours in order of their old IDs
+  rcm    -> reverse Cuthill-McKee: breadth first as well, but taking neighbours
+            with the fewest neighbours first, then reversing the whole order,
+            which keeps the band of the matrix narrow
+  degree -> by number of neighbours, most first, so the busiest nodes sit
+            together
+Networks with more than one component start again from one of the nodes left.
+The parent keeps each node's old ID, so the MST edges and timelines it reports
+use the IDs the network was generated with. Everything else, from the global
+log to what nodes log, uses the new ones. GHS breaks ties between edges of the
+same weight by their endpoints' IDs, so when weights repeat, the MST may take a
+different edge of the same weight.*/
+
+#include <stdio.h>      /*reporting the band*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs and frees*/
+
+#include "weight.h"     /*the adjacency matrix holds weights*/
+#include "results.h"    /*results go back to the old IDs*/
+
+/*Orders nodes can be relabelled in*/
+enum NODE_ORDERS {
+  ORDER_NONE = 0,
+  ORDER_BFS,
+  ORDER_RCM,
+  ORDER_DEGREE
+};
+
+/*Returns the old ID of every node, by new ID, when the network with the given
+adjacency matrix is relabelled in the given order*/
+uint8_t *order_nodes(weight_t *edges, uint8_t num_nodes, uint8_t order);
+
+/*Returns the adjacency matrix of the network once relabelled, where labels
+holds the old ID of every node by new ID*/
+weight_t *relabel_edges(weight_t *edges, uint8_t *labels, uint8_t num_nodes);
+
+/*Computes the widest gap between the IDs of two neighbours (the band of the
+matrix), and the mean gap*/
+void edge_spans(weight_t *edges, uint8_t num_nodes, uint32_t *widest,
+                                                                double *mean);
+
+/*Prints the band and mean gap of the relabelled network, next to those of the
+network as generated*/
+void print_relabelling(weight_t *edges, weight_t *relabelled,
+                                            uint8_t num_nodes, FILE *stream);
+
+/*Prints the old ID of every node, by new ID, under a header of its own, so the
+output (which has the old IDs) can be checked against the relabelled network
+the global log holds (see check.py)*/
+void print_labels(uint8_t *labels, uint8_t num_nodes, FILE *stream);
+
+/*Turns every node ID in the results back into the old one, keeping the MST
+edges sorted*/
+void unlabel_results(struct mst_result *res, uint8_t *labels);
+
+#endif /* RELABEL_H */
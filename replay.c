@@ -0,0 +1,123 @@
+#include "replay.h"
+#include "algorithm.h"
+
+struct node *load_recording(char *filename, uint32_t *num_msgs) {
+  uint8_t hdr[9], msg[REPLAY_MAX_MSG], len;
+  struct node_edge *edges;
+  struct node *node;
+  uint16_t num, i;
+  FILE *rec;
+
+  if ((rec = fopen(filename, "rb")) == NULL) {
+    fprintf(stderr, "Could not open recording '%s'!\n", filename);
+    return NULL;
+  }
+
+  /*weights are only readable by a binary with the same weight type*/
+  if (fread(hdr, 1, 9, rec) != 9 || memcmp(hdr, REPLAY_MAGIC, 4) ||
+                                                      hdr[4] != WEIGHT_LEN) {
+    fprintf(stderr, "'%s' is not a recording of this weight type!\n", filename);
+    fclose(rec);
+    return NULL;
+  }
+
+  /*rebuild the node's edges, there's nobody at the other end of them*/
+  num = (hdr[6] << 8) | hdr[7];
+  edges = malloc(num*sizeof(struct node_edge));
+  for (i = 0; i < num; i++) {
+    if (fread(msg, 1, 1 + WEIGHT_LEN, rec) != 1 + WEIGHT_LEN) {
+      fprintf(stderr, "Recording '%s' is truncated!\n", filename);
+      free(edges);
+      fclose(rec);
+      return NULL;
+    }
+    edges[i].neigh = msg[0];
+    edges[i].weight = get_weight(msg + 1);
+    edges[i].sock = 0;
+  }
+  node = init_node(hdr[5], edges, num, TRANSPORT_NONE, 0, NULL);
+  node->delays = 0;
+  node->algo_opts = hdr[8];
+  free(edges);
+
+  /*then queue up every message, a node that died halfway through its last
+  write still gets the ones before it*/
+  *num_msgs = 0;
+  while (fread(&len, 1, 1, rec) == 1) {
+    if (len > REPLAY_MAX_MSG || fread(msg, 1, len, rec) != len) {
+      fprintf(stderr, "Recording '%s' is truncated!\n", filename);
+      break;
+    }
+    enqueue(node->queue, msg, len);
+    (*num_msgs)++;
+  }
+
+  fclose(rec);
+  return node;
+}
+
+uint8_t run_replay(char *dir, FILE *globallog) {
+  struct node *nodes[256];
+  struct node_data *ndata;
+  uint32_t num_nodes, msgs, total_msgs = 0, num_edges = 0, i, j;
+  weight_sum_t total = 0;
+  char filename[256], logmsg[60];
+  struct edge *link;
+  double start, secs;
+
+  /*load everything beforehand, so the replay itself only runs the handlers*/
+  for (num_nodes = 0; num_nodes < 256; num_nodes++) {
+    snprintf(filename, 256, "%s/%u.rec", dir, num_nodes);
+    if (access(filename, R_OK) != 0) {
+      break;
+    }
+    if ((nodes[num_nodes] = load_recording(filename, &msgs)) == NULL) {
+      for (i = 0; i < num_nodes; i++) {
+        free_node(nodes[i]);
+      }
+      return 0;
+    }
+    total_msgs += msgs;
+  }
+  if (num_nodes == 0) {
+    fprintf(stderr, "No recordings found in '%s'!\n", dir);
+    return 0;
+  }
+
+  /*nodes never wait on each other here, so they can simply go one by one*/
+  ndata = malloc(num_nodes*sizeof(struct node_data));
+  start = mono_time();
+  for (i = 0; i < num_nodes; i++) {
+    ndata[i].options = nodes[i]->algo_opts;
+    ndata[i].replay = 1;
+    find_mst(nodes[i], &ndata[i]);
+  }
+  secs = mono_time() - start;
+
+  /*every MST edge is counted by its lowest endpoint*/
+  for (i = 0; i < num_nodes; i++) {
+    link = nodes[i]->neighs->head;
+    for (j = 0; j < ndata[i].num_neighs; j++, link = link->next) {
+      if (ndata[i].edge_status[j] == EDGE_BRANCH && link->neigh > i) {
+        num_edges++;
+        total += link->weight;
+      }
+    }
+    if (!is_empty(nodes[i]->queue)) {
+      fprintf(stderr, "Node %u did not replay all of its messages!\n", i);
+    }
+  }
+
+  printf("Replayed %u nodes, %u messages in %.3fs (%.0f messages/s)\n",
+              num_nodes, total_msgs, secs, secs > 0 ? total_msgs / secs : 0);
+  printf("MST: %u edges, total weight %" PRIsum "\n", num_edges, total);
+  snprintf(logmsg, 60, "Replayed %u nodes in %.3fs", num_nodes, secs);
+  log_msg(logmsg, globallog);
+
+  for (i = 0; i < num_nodes; i++) {
+    output(nodes[i], &ndata[i]);
+    free_node(nodes[i]);
+  }
+  free(ndata);
+  return 1;
+}
@@ -0,0 +1,30 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/*This file implements replaying the recordings nodes make of the order in which
+they handle their messages (see record.h). Replaying a node means feeding its
+handlers the messages it recorded, in the same order, with no transport at all
+(whatever it sends is dropped).*/
+
+#include <stdio.h>      /*recordings are files*/
+#include <stdint.h>     /*sized integers for the file format*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*memcmps*/
+
+#include "node.h"       /*nodes are what we replay*/
+#include "weight.h"     /*and their edges have weights*/
+#include "record.h"     /*out of their recordings*/
+
+/*Rebuilds a node out of the recording in the given file, with every recorded
+message already in its queue, in order, and no transport. The number of
+messages is stored in num_msgs. Returns NULL if the file isn't a recording this
+binary can replay*/
+struct node *load_recording(char *filename, uint32_t *num_msgs);
+
+/*Runs the replay mode: rebuilds every node recorded in the given directory
+(from "0.rec" up to the first missing ID), then runs the GHS variant they
+recorded on each of them in turn, fed with its recording, and reports how long it took and the MST they
+ended up with. Returns 1 on success, 0 otherwise*/
+uint8_t run_replay(char *dir, FILE *globallog);
+
+#endif /* REPLAY_H */
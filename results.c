@@ -0,0 +1,243 @@
+#include "results.h"
+
+double mono_time() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void write_result(int32_t fd, uint8_t kind, uint8_t node, void *payload,
+                                                                uint16_t len) {
+  uint8_t record[sizeof(struct result_hdr) + len];
+  struct result_hdr hdr;
+
+  if (fd < 0) {
+    return;
+  }
+
+  /*header and payload must go out in a single write, to stay atomic*/
+  hdr.kind = kind;
+  hdr.node = node;
+  hdr.len = len;
+  memcpy(record, &hdr, sizeof(hdr));
+  memcpy(record + sizeof(hdr), payload, len);
+  if (write(fd, record, sizeof(record)) != (ssize_t) sizeof(record)) {
+    fprintf(stderr, "Node %d could not write its results!\n", node);
+  }
+}
+
+uint8_t read_full(int32_t fd, void *buffer, uint32_t len) {
+  uint32_t got = 0;
+  ssize_t ret;
+
+  while (got < len) {
+    ret = read(fd, (uint8_t*) buffer + got, len - got);
+    if (ret <= 0) {
+      return 0;
+    }
+    got += ret;
+  }
+
+  return 1;
+}
+
+uint8_t write_full(int32_t fd, void *buffer, uint32_t len) {
+  uint32_t sent = 0;
+  ssize_t ret;
+
+  while (sent < len) {
+    ret = send(fd, (uint8_t*) buffer + sent, len - sent, MSG_NOSIGNAL);
+    if (ret <= 0) {
+      return 0;
+    }
+    sent += ret;
+  }
+
+  return 1;
+}
+
+uint8_t collect_results(int32_t fd, uint32_t num_nodes, double start,
+                                                      struct mst_result *res) {
+  struct result_hdr hdr;
+  uint8_t payload[1 << 16];
+  uint32_t *seen;
+  uint32_t u, v;
+
+  /*seen[u][v] (u < v) keeps a bit for each endpoint that reported the edge*/
+  seen = calloc(num_nodes*num_nodes, sizeof(uint32_t));
+  memset(res, 0, sizeof(*res));
+  res->num_nodes = num_nodes;
+  res->trees = 1;
+  res->start = start;
+  res->finished = calloc(num_nodes, sizeof(double));
+
+  while (res->done < num_nodes && read_full(fd, &hdr, sizeof(hdr))) {
+    if (!read_full(fd, payload, hdr.len)) {
+      break;
+    }
+
+    switch (hdr.kind) {
+      case RESULT_EDGE: {
+        struct result_edge *edge = (struct result_edge*) payload;
+        if (edge->neigh >= num_nodes || hdr.node >= num_nodes) {
+          break;
+        }
+        u = (hdr.node < edge->neigh) ? hdr.node : edge->neigh;
+        v = (hdr.node < edge->neigh) ? edge->neigh : hdr.node;
+        if (seen[u*num_nodes + v] == 0) {
+          res->edges = realloc(res->edges,
+                                  (res->num_edges + 1)*sizeof(struct mst_edge));
+          res->edges[res->num_edges].u = u;
+          res->edges[res->num_edges].v = v;
+          res->edges[res->num_edges].weight = edge->weight;
+          res->num_edges++;
+        }
+        seen[u*num_nodes + v] |= (hdr.node == u) ? 1 : 2;
+        break;
+      }
+      case RESULT_DONE: {
+        res->done++;
+        if (hdr.node < num_nodes) {
+          res->finished[hdr.node] = mono_time() - start;
+        }
+        break;
+      }
+      /*timelines are a few records per node per level, so grow by doubling*/
+      case RESULT_PHASE: {
+        if ((res->num_phases & (res->num_phases - 1)) == 0) {
+          u = res->num_phases ? 2*res->num_phases : 1;
+          res->phases = realloc(res->phases, u*sizeof(struct result_phase));
+        }
+        memcpy(&res->phases[res->num_phases++], payload,
+                                                  sizeof(struct result_phase));
+        break;
+      }
+      /*the nodes' histograms all add up to one per metric and message type*/
+      case RESULT_HISTOGRAM: {
+        struct result_histogram rec;
+        memcpy(&rec, payload, sizeof(rec));
+        if (rec.metric >= HIST_METRICS || rec.type >= HIST_TYPES) {
+          break;
+        }
+        if (res->hists == NULL) {
+          res->hists = calloc(HIST_METRICS, sizeof(*res->hists));
+        }
+        hist_merge(&res->hists[rec.metric][rec.type], &rec.hist);
+        break;
+      }
+      case RESULT_AVOIDED: {
+        memcpy(&u, payload, sizeof(u));
+        res->avoided += u;
+        break;
+      }
+      case RESULT_DEFERRED: {
+        memcpy(&u, payload, sizeof(u));
+        res->deferred += u;
+        break;
+      }
+      default: {
+        fprintf(stderr, "Unknown result record %d from node %d!\n", hdr.kind,
+                                                                      hdr.node);
+        break;
+      }
+    }
+  }
+
+  /*every node is done, or gone*/
+  res->secs = mono_time() - start;
+
+  /*both ends of an MST edge should agree it's a BRANCH*/
+  for (u = 0; u < res->num_edges; u++) {
+    struct mst_edge *edge = &res->edges[u];
+    if (seen[edge->u*num_nodes + edge->v] != 3) {
+      res->mismatched++;
+    }
+    res->total += edge->weight;
+  }
+
+  /*keep the edge list in a predictable order, sorted by endpoints*/
+  sort_edges(res->edges, res->num_edges);
+
+  free(seen);
+  return 1;
+}
+
+void sort_edges(struct mst_edge *edges, uint32_t num_edges) {
+  uint32_t i, j;
+
+  for (i = 1; i < num_edges; i++) {
+    struct mst_edge aux = edges[i];
+    for (j = i; j > 0 && (edges[j-1].u > aux.u ||
+         (edges[j-1].u == aux.u && edges[j-1].v > aux.v)); j--) {
+      edges[j] = edges[j-1];
+    }
+    edges[j] = aux;
+  }
+}
+
+uint8_t write_results(struct mst_result *res, char *filename, uint8_t binary) {
+  FILE *out;
+  uint32_t i;
+
+  if ((out = fopen(filename, binary ? "wb" : "w")) == NULL) {
+    fprintf(stderr, "Could not open %s for writing!\n", filename);
+    return 0;
+  }
+
+  if (binary) {
+    fwrite(&res->num_edges, sizeof(uint32_t), 1, out);
+    for (i = 0; i < res->num_edges; i++) {
+      fwrite(&res->edges[i].u, sizeof(uint32_t), 1, out);
+      fwrite(&res->edges[i].v, sizeof(uint32_t), 1, out);
+      fwrite(&res->edges[i].weight, sizeof(weight_t), 1, out);
+    }
+  }
+  else {
+    fprintf(out, "u,v,weight\n");
+    for (i = 0; i < res->num_edges; i++) {
+      fprintf(out, "%u,%u,%" PRIweight "\n", res->edges[i].u, res->edges[i].v,
+                                                        res->edges[i].weight);
+    }
+  }
+
+  fclose(out);
+  return 1;
+}
+
+void print_results(struct mst_result *res, FILE *stream) {
+  fprintf(stream, "MST: %u edges, total weight %" PRIsum ", %u/%u nodes done, "
+                  "%.3fs\n",
+                  res->num_edges, res->total, res->done, res->num_nodes,
+                  res->secs);
+
+  /*a spanning tree has exactly n-1 edges, and both ends agree on all of them.
+  A forest has one edge less per tree*/
+  if (res->mismatched || res->num_edges + res->trees != res->num_nodes) {
+    fprintf(stream, "WARNING: %u edges reported by a single endpoint, %u edges "
+                    "for %u nodes!\n", res->mismatched, res->num_edges,
+                    res->num_nodes);
+  }
+
+  if (res->avoided) {
+    fprintf(stream, "%u TESTs avoided, the neighbours were known to be in the "
+                    "same fragment\n", res->avoided);
+  }
+  if (res->deferred) {
+    fprintf(stream, "%u messages deferred, the nodes couldn't act on them "
+                    "yet\n", res->deferred);
+  }
+}
+
+void free_results(struct mst_result *res) {
+  free(res->edges);
+  res->edges = NULL;
+  res->num_edges = 0;
+  free(res->phases);
+  res->phases = NULL;
+  res->num_phases = 0;
+  free(res->hists);
+  res->hists = NULL;
+  free(res->finished);
+  res->finished = NULL;
+}
@@ -0,0 +1,175 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+/*This file implements the collection of results from the nodes. Rather than
+having every node print its BRANCH edges to the global log, and then scraping
+them back out of it, nodes write small binary records to a pipe they inherit
+from the parent. Records are always smaller than PIPE_BUF, so writes from
+different nodes never get interleaved. The parent reads the records as they
+arrive, and merges both ends' view of each edge into a single MST edge list.*/
+
+#include <stdio.h>      /*writing out results*/
+#include <stdint.h>     /*records have fixed layouts*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*memcpys*/
+#include <time.h>       /*monotonic timestamps for timing the run*/
+#include <unistd.h>     /*pipes, reads and writes*/
+#include <sys/socket.h> /*sends that don't raise SIGPIPE*/
+
+#include "weight.h"     /*edges have weights, of whatever type*/
+#include "histogram.h"  /*some records are whole histograms*/
+
+/*Kinds of records a node can send to the parent*/
+enum RESULT_KINDS {
+  RESULT_EDGE = 0,
+  RESULT_DONE,
+  RESULT_READY,
+  RESULT_UPDATE,
+  RESULT_PHASE,
+  RESULT_HISTOGRAM,
+  RESULT_AVOIDED,
+  RESULT_DEFERRED
+};
+
+/*State changes a node reports in a RESULT_PHASE record, when the parent wants
+a timeline of the run*/
+enum PHASE_EVENTS {
+  PHASE_INITIATE = 0,
+  PHASE_REPORT,
+  PHASE_CHGROOT,
+  PHASE_CONNECT,
+  PHASE_DONE
+};
+
+/*Every record starts with this header: the record's kind, the ID of the node
+that sent it, and the length of the payload that follows*/
+struct result_hdr {
+  uint8_t kind;
+  uint8_t node;
+  uint16_t len;
+};
+
+/*Payload of a RESULT_EDGE record, one of the sender's BRANCH edges*/
+struct result_edge {
+  uint32_t neigh;
+  weight_t weight;
+};
+
+/*Payload of a RESULT_PHASE record: the node's state right after one of the
+PHASE_EVENTS, and when it happened.
+  time    -> monotonic timestamp of the event
+  frag    -> weight of the fragment's core edge
+  frag_lo -> lowest endpoint of the fragment's core edge
+  frag_hi -> highest endpoint of the fragment's core edge
+  node    -> the node the event happened at
+  event   -> which of the PHASE_EVENTS it was
+  level   -> the node's fragment level
+  state   -> the node's state (FIND or FOUND)*/
+struct result_phase {
+  double time;
+  weight_t frag;
+  uint8_t frag_lo;
+  uint8_t frag_hi;
+  uint8_t node;
+  uint8_t event;
+  uint8_t level;
+  uint8_t state;
+};
+
+/*Payload of a RESULT_HISTOGRAM record, one of the histograms kept by a node,
+for one of the HIST_METRICS and one message type. At a bit over a kilobyte, it
+still fits in a single atomic write*/
+struct result_histogram {
+  uint8_t metric;
+  uint8_t type;
+  struct histogram hist;
+};
+
+/*The payload of a RESULT_AVOIDED record is the number of TESTs the sender
+didn't need to send, as a uint32_t. Same for RESULT_DEFERRED, with the number
+of times the sender deferred a message*/
+
+/*A single edge of the final MST, with u < v*/
+struct mst_edge {
+  uint32_t u;
+  uint32_t v;
+  weight_t weight;
+};
+
+/*The parent's view of a run.
+  num_nodes  -> number of nodes in the network
+  trees      -> number of trees the MST should come out as, one per component
+                of the network (collect_results() takes it to be 1)
+  num_edges  -> number of MST edges collected
+  edges      -> the MST edges themselves, sorted by (u, v)
+  total      -> total weight of the MST
+  done       -> how many nodes reported they were done
+  finished   -> when each node reported it was done, in seconds since start
+                (0 if it never did)
+  mismatched -> edges only one of the endpoints reported as BRANCH
+  start      -> time the nodes were started
+  secs       -> time from starting the nodes to the last one being done
+  phases     -> RESULT_PHASE records, in the order they arrived
+  num_phases -> number of RESULT_PHASE records
+  hists      -> every node's RESULT_HISTOGRAM records, merged by HIST_METRICS
+                and message type (NULL if no node sent any)
+  avoided    -> TESTs the nodes didn't need to send, from RESULT_AVOIDED
+  deferred   -> messages the nodes deferred, from RESULT_DEFERRED*/
+struct mst_result {
+  uint32_t num_nodes;
+  uint32_t trees;
+  uint32_t num_edges;
+  struct mst_edge *edges;
+  weight_sum_t total;
+  uint32_t done;
+  double *finished;
+  uint32_t mismatched;
+  double start;
+  double secs;
+  struct result_phase *phases;
+  uint32_t num_phases;
+  struct histogram (*hists)[HIST_TYPES];
+  uint32_t avoided;
+  uint32_t deferred;
+};
+
+/*Returns the current time of the monotonic clock, in seconds*/
+double mono_time();
+
+/*Writes a single record to the given results descriptor. Does nothing if the
+descriptor is negative (results are not being collected)*/
+void write_result(int32_t fd, uint8_t kind, uint8_t node, void *payload,
+                                                                uint16_t len);
+
+/*Reads exactly len bytes from the given descriptor into buffer. Returns 0 if
+the descriptor was closed (or failed) before that, 1 otherwise*/
+uint8_t read_full(int32_t fd, void *buffer, uint32_t len);
+
+/*Writes exactly len bytes from buffer to the given socket. A socket whose other
+end is gone makes it fail rather than raise SIGPIPE. Returns 0 if it failed
+before that, 1 otherwise*/
+uint8_t write_full(int32_t fd, void *buffer, uint32_t len);
+
+/*Reads records from the given descriptor until every node reported it is done
+(or every writer has closed it), then builds the MST edge list. start is the
+time the nodes were started, from which the total run time is computed. Returns
+1 on success, 0 otherwise*/
+uint8_t collect_results(int32_t fd, uint32_t num_nodes, double start,
+                                                      struct mst_result *res);
+
+/*Sorts the given MST edges by (u, v)*/
+void sort_edges(struct mst_edge *edges, uint32_t num_edges);
+
+/*Writes the MST edges to the given file, either as CSV ("u,v,weight" lines) or
+as binary (the number of edges, then u, v and weight for each edge, the IDs as
+native 32-bit integers and the weight as a native weight_t). Returns 1 on
+success, 0 otherwise*/
+uint8_t write_results(struct mst_result *res, char *filename, uint8_t binary);
+
+/*Prints a short summary of the results to the given stream*/
+void print_results(struct mst_result *res, FILE *stream);
+
+/*Frees the memory allocated for the results*/
+void free_results(struct mst_result *res);
+
+#endif /* RESULTS_H */
@@ -0,0 +1,262 @@
+#include "tcp.h"
+
+uint8_t tcp_parse_hosts(struct tcp_config *config, char *list) {
+  uint8_t i;
+  char *host = NULL, *save = NULL;
+
+  config->hosts = calloc(config->workers, sizeof(char*));
+
+  /*take as many addresses as we are given, the rest are local*/
+  if (list != NULL) {
+    host = strtok_r(list, ",", &save);
+  }
+  for (i = 0; i < config->workers; i++) {
+    config->hosts[i] = strdup(host ? host : "127.0.0.1");
+    if (host != NULL) {
+      host = strtok_r(NULL, ",", &save);
+    }
+  }
+
+  /*more addresses than workers is most likely a typo*/
+  if (host != NULL) {
+    fprintf(stderr, "More hosts than workers!\n");
+    return 0;
+  }
+
+  return 1;
+}
+
+void tcp_free_hosts(struct tcp_config *config) {
+  uint8_t i;
+
+  if (config->hosts == NULL) {
+    return;
+  }
+  for (i = 0; i < config->workers; i++) {
+    free(config->hosts[i]);
+  }
+  free(config->hosts);
+  config->hosts = NULL;
+}
+
+int32_t tcp_listen(uint16_t port) {
+  struct sockaddr_in addr;
+  int32_t sock, one = 1;
+
+  if ((sock = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+    return -1;
+  }
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+
+  if (bind(sock, (struct sockaddr*) &addr, sizeof(addr)) == -1 ||
+      listen(sock, SOMAXCONN) == -1) {
+    close(sock);
+    return -1;
+  }
+
+  return sock;
+}
+
+int32_t tcp_connect(char *host, uint16_t port) {
+  struct addrinfo hints, *res;
+  char portstr[8];
+  int32_t sock, one = 1;
+  uint32_t tries;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  snprintf(portstr, 8, "%u", port);
+  if (getaddrinfo(host, portstr, &hints, &res) != 0) {
+    fprintf(stderr, "Could not resolve worker address %s!\n", host);
+    return -1;
+  }
+
+  for (tries = 0; tries < TCP_CONNECT_RETRIES; tries++) {
+    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+      break;
+    }
+    if (connect(sock, res->ai_addr, res->ai_addrlen) == 0) {
+      setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      freeaddrinfo(res);
+      return sock;
+    }
+    close(sock);
+
+    /*anything but the peer not being up yet is a real problem*/
+    if (errno != ECONNREFUSED && errno != ETIMEDOUT) {
+      break;
+    }
+    usleep(TCP_CONNECT_WAIT);
+  }
+
+  freeaddrinfo(res);
+  fprintf(stderr, "Could not connect to worker at %s:%u!\n", host, port);
+  return -1;
+}
+
+void tcp_close_channels(uint32_t *sockets, uint32_t count) {
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    if (sockets[i]) {
+      close(sockets[i]);
+    }
+  }
+  free(sockets);
+}
+
+uint8_t run_tcp_worker(uint8_t worker, weight_t *edges, uint8_t num_nodes,
+                          struct tcp_config *config, FILE *globallog,
+                          int32_t results, void (*algo) (struct node *node),
+                          uint8_t algo_opts) {
+  uint32_t *sockets;
+  uint32_t expected = 0;
+  int32_t listener, fd_pair[2], left;
+  int16_t i, j;
+  char logmsg[60];
+
+  /*same socket map layout as every other transport, but we only fill out the
+  rows of the nodes we own*/
+  sockets = calloc(num_nodes*num_nodes, sizeof(uint32_t));
+
+  /*start listening before anything else, so peers can connect to us while we
+  connect to them*/
+  listener = tcp_listen(config->port + worker);
+  if (listener == -1) {
+    fprintf(stderr, "Worker %d could not listen on port %d!\n", worker,
+                                                      config->port + worker);
+    free(sockets);
+    return 0;
+  }
+
+  for (i = 0; i < num_nodes; i++) {
+    if (worker_of(i, num_nodes, config->workers) != worker) {
+      continue;
+    }
+
+    for (j = 0; j < num_nodes; j++) {
+      uint8_t peer = worker_of(j, num_nodes, config->workers);
+      if (!edges[i*num_nodes + j]) {
+        continue;
+      }
+
+      /*both ends are ours, a local stream socket will do (once per edge)*/
+      if (peer == worker) {
+        if (j > i) {
+          if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd_pair) == -1) {
+            fprintf(stderr, "Error when creating socket pair!\n");
+            close(listener);
+            tcp_close_channels(sockets, num_nodes*num_nodes);
+            return 0;
+          }
+          sockets[i*num_nodes + j] = fd_pair[0];
+          sockets[j*num_nodes + i] = fd_pair[1];
+        }
+      }
+
+      /*the lower worker always connects, the higher one accepts. The first
+      two bytes on a new connection tell the other end which edge it is*/
+      else if (peer > worker) {
+        uint8_t hello[2] = {i, j};
+        int32_t sock = tcp_connect(config->hosts[peer], config->port + peer);
+        if (sock == -1 || send(sock, hello, 2, 0) != 2) {
+          if (sock != -1) {
+            close(sock);
+          }
+          close(listener);
+          tcp_close_channels(sockets, num_nodes*num_nodes);
+          return 0;
+        }
+        sockets[i*num_nodes + j] = sock;
+      }
+      else {
+        expected++;
+      }
+    }
+  }
+
+  /*now wait for every worker below us to connect their edges, but a worker
+  that never shows up fails the whole run rather than leave us hanging*/
+  double deadline = mono_time() + TCP_ACCEPT_TIMEOUT / 1000.0;
+  while (expected > 0) {
+    struct pollfd pfd = {listener, POLLIN, 0};
+    uint8_t hello[2];
+    int32_t sock, one = 1;
+
+    left = (int32_t) ((deadline - mono_time())*1000);
+    if (left <= 0 || poll(&pfd, 1, left) == 0) {
+      fprintf(stderr, "Worker %d gave up waiting for %u edges!\n", worker,
+                                                                    expected);
+      close(listener);
+      tcp_close_channels(sockets, num_nodes*num_nodes);
+      return 0;
+    }
+    if (!(pfd.revents & POLLIN) ||
+                            (sock = accept(listener, NULL, NULL)) == -1) {
+      continue;
+    }
+    if (recv(sock, hello, 2, MSG_WAITALL) != 2 || hello[1] >= num_nodes ||
+        hello[0] >= num_nodes || !edges[hello[1]*num_nodes + hello[0]]) {
+      fprintf(stderr, "Worker %d got a bogus connection!\n", worker);
+      close(sock);
+      continue;
+    }
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockets[hello[1]*num_nodes + hello[0]] = sock;
+    expected--;
+  }
+  close(listener);
+
+  snprintf(logmsg, 60, "Worker %d has set up all of its channels!", worker);
+  log_msg(logmsg, globallog);
+
+  /*only our nodes' rows are filled out, so that's all the adjacency holds*/
+  uint32_t *offsets;
+  struct node_edge *adj = build_adjacency(edges, sockets, num_nodes, &offsets);
+  int32_t max_fd = results;
+  for (i = 0; i < num_nodes*num_nodes; i++) {
+    max_fd = ((int32_t) sockets[i] > max_fd) ? (int32_t) sockets[i] : max_fd;
+  }
+
+  /*from here on it's business as usual: fork a process for each of our nodes*/
+  for (i = 0; i < num_nodes; i++) {
+    if (worker_of(i, num_nodes, config->workers) != worker) {
+      continue;
+    }
+
+    if (fork() == 0) {
+      struct node *newnode;
+      newnode = init_node(i, &adj[offsets[i]], offsets[i+1] - offsets[i],
+                                            TRANSPORT_TCP, 0, globallog);
+      newnode->results = results;
+      newnode->algo_opts = algo_opts;
+
+      /*our siblings' channels are none of our business*/
+      close_other_fds(newnode, max_fd);
+      free(adj);
+      free(offsets);
+      free(sockets);
+      free(edges);
+
+      run_node(newnode, algo);
+      free_node(newnode);
+      exit(1);
+    }
+  }
+
+  /*the worker itself doesn't need any of the channels anymore*/
+  tcp_close_channels(sockets, num_nodes*num_nodes);
+  free(adj);
+  free(offsets);
+
+  int32_t status = 0;
+  while(wait(&status) > 0) {}
+
+  return 1;
+}
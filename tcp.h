@@ -0,0 +1,88 @@
+#ifndef TCP_H
+#define TCP_H
+
+/*This file implements the worker processes for the TCP transport. Rather than
+forking every node from a single parent, which requires every socket to be
+inherited through fork(), the network is split among several worker processes.
+Each worker owns a contiguous slice of the nodes, creates UNIX stream sockets for
+the edges between its own nodes, and TCP connections for the edges that cross
+over to other workers. Workers only need to agree on the topology (which they
+can compute from the same seed) and on each other's addresses, so they can run
+on different hosts. Once all channels are up, each worker forks its own nodes
+as usual, so nodes and algorithms don't care where their neighbours live.*/
+
+#include <stdio.h>       /*printing is still fun*/
+#include <stdint.h>      /*so are fixed-size integers*/
+#include <stdlib.h>      /*mallocs and frees*/
+#include <string.h>      /*memsets and string juggling*/
+#include <errno.h>       /*connect() likes to fail while peers boot up*/
+#include <unistd.h>      /*forks and closes*/
+#include <poll.h>        /*peers only get so long to connect*/
+#include <netdb.h>       /*resolving worker hostnames*/
+#include <sys/wait.h>    /*workers wait for their nodes too*/
+#include <sys/socket.h>  /*sockets, obviously*/
+#include <netinet/in.h>  /*internet addresses*/
+#include <netinet/tcp.h> /*TCP_NODELAY, our messages are tiny*/
+#include <arpa/inet.h>   /*address conversions*/
+
+#include "node.h"        /*workers run nodes*/
+#include "worker.h"      /*and split them the same way partitioned ones do*/
+
+/*Default port for worker 0, worker k listens on port + k*/
+#define TCP_DEFAULT_PORT 47000
+
+/*How many times a worker retries connecting to a peer that isn't listening
+yet, and how long it waits between attempts (in microseconds)*/
+#define TCP_CONNECT_RETRIES 300
+#define TCP_CONNECT_WAIT 100000
+
+/*How long a worker waits for the workers below it to connect all of their
+edges before giving up on the run (in milliseconds), about as long as they
+keep retrying to reach it*/
+#define TCP_ACCEPT_TIMEOUT 30000
+
+/*Struct that describes how the workers are laid out. Every worker needs the
+same configuration, so they all agree on who owns which node and where to
+connect for each of them.
+  workers -> number of worker processes the network is split among
+  port    -> port worker 0 listens on, worker k listens on port + k
+  hosts   -> address of each worker*/
+struct tcp_config {
+  uint8_t workers;
+  uint16_t port;
+  char **hosts;
+};
+
+/*Parses a comma-separated list of worker addresses into the configuration.
+Missing addresses default to the loopback interface. Returns 0 on failure*/
+uint8_t tcp_parse_hosts(struct tcp_config *config, char *list);
+
+/*Frees the host list of a configuration*/
+void tcp_free_hosts(struct tcp_config *config);
+
+/*Opens a worker's listening socket on the given port, on all interfaces.
+Returns the socket, or -1 on failure*/
+int32_t tcp_listen(uint16_t port);
+
+/*Connects to the worker listening on the given host and port, retrying for a
+while since it might not be listening yet. Returns the connected socket, or -1
+if we gave up*/
+int32_t tcp_connect(char *host, uint16_t port);
+
+/*Closes every channel in the given socket map (count entries, 0 for none) and
+frees it*/
+void tcp_close_channels(uint32_t *sockets, uint32_t count);
+
+/*Runs the given worker: sets up its local channels and TCP connections to
+every other worker it shares an edge with, then forks its nodes, running algo
+(with the given options) on each of them, and waits for them to finish. The
+topology is the usual connectivity matrix, and nodes report their results on the
+results descriptor (-1 for none). Returns 1 on success and 0 if the channels
+could not be set up, including when the workers below us didn't connect all of
+their edges within TCP_ACCEPT_TIMEOUT*/
+uint8_t run_tcp_worker(uint8_t worker, weight_t *edges, uint8_t num_nodes,
+                          struct tcp_config *config, FILE *globallog,
+                          int32_t results, void (*algo) (struct node *node),
+                          uint8_t algo_opts);
+
+#endif /* TCP_H */
@@ -0,0 +1,224 @@
+#include "timeline.h"
+
+/*names of the phases and events, for printing*/
+char *phase_names[TIMELINE_PHASES] = {"level", "find", "wait", "chgroot",
+                                                                      "merge"};
+char *event_names[] = {"initiate", "report", "chgroot", "connect", "done"};
+
+void compute_phases(struct result_phase *phases, uint32_t num,
+              struct phase_samples samples[TIMELINE_PHASES][TIMELINE_LEVELS]) {
+  struct result_phase *sorted, *init = NULL, *report = NULL, *connect = NULL;
+  uint32_t i, offsets[257];
+
+  memset(samples, 0, TIMELINE_PHASES*TIMELINE_LEVELS*sizeof(**samples));
+  if (num == 0) {
+    return;
+  }
+
+  /*go through each node's events in the order they happened to it. A node's
+  records arrive in the order it wrote them, so a stable counting sort by node
+  keeps them that way, even when two of them have the same timestamp*/
+  sorted = malloc(num*sizeof(struct result_phase));
+  memset(offsets, 0, sizeof(offsets));
+  for (i = 0; i < num; i++) {
+    offsets[phases[i].node + 1]++;
+  }
+  for (i = 1; i < 257; i++) {
+    offsets[i] += offsets[i-1];
+  }
+  for (i = 0; i < num; i++) {
+    sorted[offsets[phases[i].node]++] = phases[i];
+  }
+
+  for (i = 0; i < num; i++) {
+    struct result_phase *ev = &sorted[i];
+
+    /*a new node, nothing is pending anymore*/
+    if (i == 0 || ev->node != sorted[i-1].node) {
+      init = report = connect = NULL;
+    }
+
+    /*whatever follows a REPORT is the end of the wait*/
+    if (report != NULL) {
+      add_sample(samples, TIMELINE_WAIT, report->level, ev->time-report->time);
+      report = NULL;
+    }
+
+    switch (ev->event) {
+      case PHASE_INITIATE: {
+        if (init != NULL) {
+          add_sample(samples, TIMELINE_LEVEL, init->level, ev->time-init->time);
+        }
+        if (connect != NULL) {
+          add_sample(samples, TIMELINE_MERGE, connect->level,
+                                                  ev->time - connect->time);
+          connect = NULL;
+        }
+        init = ev;
+        break;
+      }
+      case PHASE_REPORT: {
+        /*absorbed nodes that start out FOUND never searched at all*/
+        if (init != NULL && init->state == NODE_FIND) {
+          add_sample(samples, TIMELINE_FIND, init->level, ev->time-init->time);
+        }
+        report = ev;
+        break;
+      }
+      case PHASE_CONNECT: {
+        connect = ev;
+        break;
+      }
+      case PHASE_DONE: {
+        if (init != NULL) {
+          add_sample(samples, TIMELINE_LEVEL, init->level, ev->time-init->time);
+        }
+        break;
+      }
+    }
+  }
+
+  /*a fragment's CONNECT ends the CHANGEROOT that started at its core, which
+  is the earliest CHANGEROOT in the same fragment and level. Sorted by fragment
+  and level, then by time, that's the first CHANGEROOT of its group*/
+  struct result_phase *chgroot = NULL;
+  qsort(sorted, num, sizeof(struct result_phase), compare_phase_frag);
+  for (i = 0; i < num; i++) {
+    struct result_phase *ev = &sorted[i];
+
+    if (i == 0 || compare_frags(ev, &sorted[i-1]) != 0) {
+      chgroot = NULL;
+    }
+    if (ev->event == PHASE_CHGROOT && chgroot == NULL) {
+      chgroot = ev;
+    }
+    if (ev->event == PHASE_CONNECT && ev->level > 0 && chgroot != NULL) {
+      add_sample(samples, TIMELINE_CHGROOT, ev->level,
+                                                  ev->time - chgroot->time);
+    }
+  }
+
+  free(sorted);
+}
+
+void add_sample(struct phase_samples samples[TIMELINE_PHASES][TIMELINE_LEVELS],
+                                    uint8_t phase, uint8_t level, double secs) {
+  struct phase_samples *s;
+
+  level = (level >= TIMELINE_LEVELS) ? TIMELINE_LEVELS - 1 : level;
+  s = &samples[phase][level];
+
+  /*grow by doubling, like the records themselves*/
+  if ((s->num & (s->num - 1)) == 0) {
+    s->secs = realloc(s->secs, (s->num ? 2*s->num : 1)*sizeof(double));
+  }
+  s->secs[s->num++] = secs;
+}
+
+void free_samples(
+              struct phase_samples samples[TIMELINE_PHASES][TIMELINE_LEVELS]) {
+  uint8_t i, j;
+
+  for (i = 0; i < TIMELINE_PHASES; i++) {
+    for (j = 0; j < TIMELINE_LEVELS; j++) {
+      free(samples[i][j].secs);
+      samples[i][j].secs = NULL;
+      samples[i][j].num = 0;
+    }
+  }
+}
+
+void print_timeline(struct mst_result *res, FILE *stream) {
+  struct phase_samples samples[TIMELINE_PHASES][TIMELINE_LEVELS];
+  uint8_t i, j;
+
+  compute_phases(res->phases, res->num_phases, samples);
+
+  fprintf(stream, "Timeline: %u events (times in ms)\n", res->num_phases);
+  fprintf(stream, "  lvl phase        n      min      med      p90      max\n");
+  for (j = 0; j < TIMELINE_LEVELS; j++) {
+    for (i = 0; i < TIMELINE_PHASES; i++) {
+      struct phase_samples *s = &samples[i][j];
+      if (s->num == 0) {
+        continue;
+      }
+
+      qsort(s->secs, s->num, sizeof(double), compare_secs);
+      fprintf(stream, "  %3u %-7s %6u %8.3f %8.3f %8.3f %8.3f\n", j,
+              phase_names[i], s->num, 1000*s->secs[0],
+              1000*s->secs[(s->num - 1)/2], 1000*s->secs[9*(s->num - 1)/10],
+              1000*s->secs[s->num - 1]);
+    }
+  }
+
+  free_samples(samples);
+}
+
+uint8_t write_timeline(struct mst_result *res, char *filename) {
+  struct result_phase *sorted;
+  FILE *out;
+  uint32_t i;
+
+  if ((out = fopen(filename, "w")) == NULL) {
+    fprintf(stderr, "Could not open %s for writing!\n", filename);
+    return 0;
+  }
+
+  sorted = malloc((res->num_phases ? res->num_phases : 1)*
+                                                  sizeof(struct result_phase));
+  memcpy(sorted, res->phases, res->num_phases*sizeof(struct result_phase));
+  qsort(sorted, res->num_phases, sizeof(struct result_phase),
+                                                          compare_phase_time);
+
+  fprintf(out, "time,node,event,level,state,frag,frag_lo,frag_hi\n");
+  for (i = 0; i < res->num_phases; i++) {
+    struct result_phase *ev = &sorted[i];
+    fprintf(out, "%.6f,%u,%s,%u,%s,%" PRIweight ",%u,%u\n",
+            ev->time - res->start, ev->node, event_names[ev->event], ev->level,
+            ev->state == NODE_FIND ? "find" : "found", ev->frag, ev->frag_lo,
+            ev->frag_hi);
+  }
+
+  free(sorted);
+  fclose(out);
+  return 1;
+}
+
+int compare_phase_time(const void *a, const void *b) {
+  const struct result_phase *p = a, *q = b;
+
+  return (p->time > q->time) - (p->time < q->time);
+}
+
+int compare_frags(const struct result_phase *p, const struct result_phase *q) {
+  if (p->level != q->level) {
+    return (p->level > q->level) - (p->level < q->level);
+  }
+  if (p->frag != q->frag) {
+    return (p->frag > q->frag) - (p->frag < q->frag);
+  }
+  if (p->frag_lo != q->frag_lo) {
+    return (p->frag_lo > q->frag_lo) - (p->frag_lo < q->frag_lo);
+  }
+  return (p->frag_hi > q->frag_hi) - (p->frag_hi < q->frag_hi);
+}
+
+int compare_phase_frag(const void *a, const void *b) {
+  const struct result_phase *p = a, *q = b;
+  int order = compare_frags(p, q);
+
+  /*a CONNECT at the same time as the CHANGEROOT still follows it*/
+  if (order == 0) {
+    order = compare_phase_time(a, b);
+  }
+  if (order == 0) {
+    order = (p->event == PHASE_CONNECT) - (q->event == PHASE_CONNECT);
+  }
+  return order;
+}
+
+int compare_secs(const void *a, const void *b) {
+  const double *p = a, *q = b;
+
+  return (*p > *q) - (*p < *q);
+}
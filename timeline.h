@@ -0,0 +1,85 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+/*This file turns the RESULT_PHASE records nodes send when running with
+GHS_TIMELINE into something we can reason about. Each node reports when it starts a level
+(INITIATE), finishes its search (REPORT), takes part in a CHANGEROOT, sends a
+CONNECT across its fragment's LWOE and terminates. From those, we get the
+latency of every phase of the algorithm, for every level:
+  level   -> time a node spends at the level, from its INITIATE to the next one
+  find    -> time from a node's INITIATE (in FIND state) to its own REPORT
+  wait    -> time from a node's REPORT to whatever happens to it next, which is
+             how long it waits for the rest of the fragment to report
+  chgroot -> time from the first CHANGEROOT of a fragment to its new root
+             sending the CONNECT
+  merge   -> time from a node sending a CONNECT to its next INITIATE, which is
+             the round trip for merging with (or being absorbed by) the other
+             fragment
+Timestamps come from the monotonic clock, so they can only be compared between
+nodes on the same host.*/
+
+#include <stdio.h>      /*summaries and timeline files*/
+#include <stdint.h>     /*sized integers*/
+#include <stdlib.h>     /*mallocs, frees and qsorts*/
+#include <string.h>     /*memcpys*/
+
+#include "results.h"    /*the records themselves*/
+#include "algorithm.h"  /*and the node states they describe*/
+
+/*Levels we keep separate latencies for, anything above goes in the last one.
+GHS never goes past log2(n) levels, so this is plenty*/
+#define TIMELINE_LEVELS 16
+
+/*The phases we measure, as described above*/
+enum TIMELINE_PHASES {
+  TIMELINE_LEVEL = 0,
+  TIMELINE_FIND,
+  TIMELINE_WAIT,
+  TIMELINE_CHGROOT,
+  TIMELINE_MERGE,
+  TIMELINE_PHASES
+};
+
+/*Latencies measured for one phase at one level, in seconds*/
+struct phase_samples {
+  double *secs;
+  uint32_t num;
+};
+
+/*Computes the latency of every phase at every level from the given records,
+filling in samples, which is indexed by phase and then by level. The sample
+arrays are allocated here, and freed by free_samples()*/
+void compute_phases(struct result_phase *phases, uint32_t num,
+                  struct phase_samples samples[TIMELINE_PHASES][TIMELINE_LEVELS]);
+
+/*Adds a latency to the given phase and level*/
+void add_sample(struct phase_samples samples[TIMELINE_PHASES][TIMELINE_LEVELS],
+                                    uint8_t phase, uint8_t level, double secs);
+
+/*Frees the sample arrays allocated by compute_phases()*/
+void free_samples(
+                struct phase_samples samples[TIMELINE_PHASES][TIMELINE_LEVELS]);
+
+/*Prints the distribution (count, minimum, median, 90th percentile and maximum)
+of every phase at every level to the given stream*/
+void print_timeline(struct mst_result *res, FILE *stream);
+
+/*Writes every record to the given file as CSV, sorted by time, with times in
+seconds since the nodes were started. Returns 1 on success, 0 otherwise*/
+uint8_t write_timeline(struct mst_result *res, char *filename);
+
+/*qsort comparator for records, by time*/
+int compare_phase_time(const void *a, const void *b);
+
+/*Compares the fragments two records were in, by level, then by the fragment's
+core. Returns 0 if they're the same*/
+int compare_frags(const struct result_phase *p, const struct result_phase *q);
+
+/*qsort comparator for records, by fragment (see compare_frags()), then by
+time*/
+int compare_phase_frag(const void *a, const void *b);
+
+/*qsort comparator for latencies*/
+int compare_secs(const void *a, const void *b);
+
+#endif /* TIMELINE_H */
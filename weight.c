@@ -0,0 +1,78 @@
+#include "weight.h"
+
+uint8_t put_weight(uint8_t *buffer, weight_t weight) {
+  uint64_t bits;
+  uint8_t i;
+
+#ifdef WEIGHT_FLOAT
+  memcpy(&bits, &weight, sizeof(bits));
+#else
+  bits = weight;
+#endif
+
+  for (i = 0; i < WEIGHT_LEN; i++) {
+    buffer[i] = (bits >> 8*(WEIGHT_LEN - 1 - i)) & 0xFF;
+  }
+  return WEIGHT_LEN;
+}
+
+weight_t get_weight(uint8_t *buffer) {
+  uint64_t bits = 0;
+  weight_t weight;
+  uint8_t i;
+
+  for (i = 0; i < WEIGHT_LEN; i++) {
+    bits = (bits << 8) | buffer[i];
+  }
+
+#ifdef WEIGHT_FLOAT
+  memcpy(&weight, &bits, sizeof(weight));
+#else
+  weight = bits;
+#endif
+  return weight;
+}
+
+uint8_t valid_weight(weight_t weight) {
+  /*also takes care of NaNs, which compare false to everything*/
+  return weight > 0 && weight < WEIGHT_MAX;
+}
+
+uint8_t parse_weight(char *str, weight_t *weight) {
+  char *end;
+
+#ifdef WEIGHT_FLOAT
+  double value;
+
+  errno = 0;
+  value = strtod(str, &end);
+#else
+  unsigned long long value;
+
+  /*strtoull happily negates negative numbers, so don't let it see any*/
+  if (str[0] == '-') {
+    return 0;
+  }
+  errno = 0;
+  value = strtoull(str, &end, 10);
+  if (value >= WEIGHT_MAX) {
+    return 0;
+  }
+#endif
+
+  if (errno || end == str || *end != '\0' || !valid_weight(value)) {
+    return 0;
+  }
+  *weight = value;
+  return 1;
+}
+
+weight_t random_weight(uint32_t range) {
+  weight_t weight = 1 + rand()%(range - 1);
+
+#ifdef WEIGHT_FLOAT
+  /*a fraction in [0, 1) keeps it below range*/
+  weight += (double) rand()/((double) RAND_MAX + 1);
+#endif
+  return weight;
+}
@@ -0,0 +1,86 @@
+#ifndef WEIGHT_H
+#define WEIGHT_H
+
+/*This file picks the type of edge weights, which is fixed at compile time, so
+that no code path has to pay for a type wider than the one it was built for.
+By default weights are 16-bit integers, which is plenty for the graphs we
+generate ourselves. Building with -DWEIGHT_U32, -DWEIGHT_U64 or -DWEIGHT_F64
+gives 32-bit or 64-bit integer weights, or double precision floating point ones
+(for latency-weighted networks and such). The Makefile builds a separate binary
+for each of them.
+
+Weights are always positive, and the largest value of the type is reserved to
+mean "no edge", so it can't be the weight of an actual edge either.*/
+
+#include <stdint.h>     /*the integer weight types*/
+#include <inttypes.h>   /*and how to print and scan them*/
+#include <string.h>     /*memcpys for floating point weights*/
+#include <stdlib.h>     /*rands*/
+#include <math.h>       /*HUGE_VAL*/
+#include <errno.h>      /*out of range weights*/
+
+/*For each type we define:
+  weight_t      -> the type itself
+  weight_sum_t  -> a type for adding up weights, such as the MST's total
+  WEIGHT_MAX    -> the reserved maximum weight
+  WEIGHT_DIGITS -> how many characters a weight can take up when printed
+  PRIweight     -> printf conversion for weights, after the '%'
+  PRIsum        -> printf conversion for sums of weights, after the '%'
+  WEIGHT_FLOAT  -> defined if weights are floating point*/
+#if defined(WEIGHT_U32)
+typedef uint32_t weight_t;
+typedef uint64_t weight_sum_t;
+#define WEIGHT_MAX UINT32_MAX
+#define WEIGHT_DIGITS 10
+#define PRIweight PRIu32
+#define PRIsum PRIu64
+
+#elif defined(WEIGHT_U64)
+typedef uint64_t weight_t;
+typedef uint64_t weight_sum_t;
+#define WEIGHT_MAX UINT64_MAX
+#define WEIGHT_DIGITS 20
+#define PRIweight PRIu64
+#define PRIsum PRIu64
+
+#elif defined(WEIGHT_F64)
+typedef double weight_t;
+typedef double weight_sum_t;
+#define WEIGHT_MAX HUGE_VAL
+#define WEIGHT_DIGITS 22
+#define PRIweight ".15g"
+#define PRIsum ".15g"
+#define WEIGHT_FLOAT
+
+#else
+typedef uint16_t weight_t;
+typedef uint64_t weight_sum_t;
+#define WEIGHT_MAX UINT16_MAX
+#define WEIGHT_DIGITS 5
+#define PRIweight PRIu16
+#define PRIsum PRIu64
+#endif
+
+/*Length of a weight in a message*/
+#define WEIGHT_LEN ((uint8_t) sizeof(weight_t))
+
+/*Writes a weight into a message buffer, most significant byte first (floating
+point weights as their bit pattern), returning its length*/
+uint8_t put_weight(uint8_t *buffer, weight_t weight);
+
+/*Reads a weight written by put_weight from a message buffer*/
+weight_t get_weight(uint8_t *buffer);
+
+/*Returns 1 if the given weight can be the weight of an edge, 0 otherwise*/
+uint8_t valid_weight(weight_t weight);
+
+/*Reads a weight from the given string, which must hold nothing else. Returns 1
+if it's a valid weight for the type we were built with, 0 otherwise (in which
+case weight is left untouched)*/
+uint8_t parse_weight(char *str, weight_t *weight);
+
+/*Returns a random weight in [1, range). Floating point weights get a random
+fractional part as well*/
+weight_t random_weight(uint32_t range);
+
+#endif /* WEIGHT_H */
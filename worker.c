@@ -0,0 +1,158 @@
+#include "worker.h"
+
+uint8_t worker_of(uint8_t node, uint8_t num_nodes, uint8_t workers) {
+  return (node * workers) / num_nodes;
+}
+
+uint8_t run_worker(uint8_t id, uint8_t workers, weight_t *edges,
+                    uint8_t num_nodes, uint8_t *owners, uint32_t *sockets,
+                    struct worker_stats *stats, FILE *globallog,
+                    int32_t results, void (*algo) (struct node *node),
+                    uint8_t algo_opts) {
+  struct worker worker;
+  struct seed *seeds = NULL;
+  uint32_t *routes, *offsets;
+  struct node_edge *adj;
+  int16_t i, j, count;
+  char logmsg[60];
+
+  /*initialize the worker itself*/
+  worker.id = id;
+  worker.workers = workers;
+  worker.num_nodes = num_nodes;
+  worker.owners = owners;
+  worker.inbox = sockets[2*id];
+  worker.stats = &stats[id];
+  worker.outboxes = malloc(workers*sizeof(uint32_t));
+  for (i = 0; i < workers; i++) {
+    worker.outboxes[i] = sockets[2*i + 1];
+  }
+
+  /*edges of partitioned nodes simply store the neighbour's ID, which is what
+  we route messages by, so that's what we give them as their socket map*/
+  routes = calloc(num_nodes*num_nodes, sizeof(uint32_t));
+  for (i = 0, count = 0; i < num_nodes; i++) {
+    if (owners[i] != id) {
+      continue;
+    }
+    for (j = 0; j < num_nodes; j++) {
+      routes[i*num_nodes + j] = j;
+    }
+    count++;
+  }
+  adj = build_adjacency(edges, routes, num_nodes, &offsets);
+
+  /*initialize our nodes before anyone can send them anything, in the fragments
+  we found for them, if we were asked to*/
+  if (algo_opts & GHS_CONTRACT) {
+    seeds = contract_nodes(edges, num_nodes, owners, id);
+  }
+  worker.nodes = calloc(num_nodes, sizeof(struct node*));
+  for (i = 0; i < num_nodes; i++) {
+    if (owners[i] != id) {
+      continue;
+    }
+    worker.nodes[i] = init_node(i, &adj[offsets[i]], offsets[i+1] - offsets[i],
+                                                  TRANSPORT_PART, 0, globallog);
+    worker.nodes[i]->worker = &worker;
+    worker.nodes[i]->results = results;
+    worker.nodes[i]->algo_opts = algo_opts;
+    worker.nodes[i]->seed = seeds ? &seeds[i] : NULL;
+  }
+  free(routes);
+  free(adj);
+  free(offsets);
+
+  snprintf(logmsg, 60, "Worker %d is hosting %d nodes!", id, count);
+  log_msg(logmsg, globallog);
+
+  /*start listening to the other workers, then start the nodes*/
+  pthread_t dispatcher, tids[count];
+  struct node_thread_data tdata[count];
+  pthread_create(&dispatcher, NULL, dispatcher_thread, (void*)&worker);
+  for (i = 0, j = 0; i < num_nodes; i++) {
+    if (worker.nodes[i] == NULL) {
+      continue;
+    }
+    tdata[j].node = worker.nodes[i];
+    tdata[j].algo = algo;
+    pthread_create(&tids[j], NULL, node_thread, (void*)&tdata[j]);
+    j++;
+  }
+
+  /*wait for all our nodes to be done, then stop listening*/
+  for (j = 0; j < count; j++) {
+    pthread_join(tids[j], NULL);
+  }
+  pthread_cancel(dispatcher);
+  pthread_join(dispatcher, NULL);
+
+  /*only free the nodes once nobody can be sending to them anymore*/
+  for (i = 0; i < num_nodes; i++) {
+    if (worker.nodes[i] != NULL) {
+      free_node(worker.nodes[i]);
+    }
+  }
+  free(worker.nodes);
+  free(worker.outboxes);
+  if (seeds != NULL) {
+    free_seeds(seeds, num_nodes);
+  }
+
+  return 1;
+}
+
+void worker_send(struct worker *worker, uint8_t src, uint32_t dest,
+                                                uint8_t *msg, uint32_t len) {
+  uint8_t frame[50 + WORKER_HDR_LEN];
+
+  /*our own node, skip the sockets altogether*/
+  if (worker->nodes[dest] != NULL) {
+    enqueue(worker->nodes[dest]->queue, msg, len);
+    __sync_fetch_and_add(&worker->stats->local, 1);
+    return;
+  }
+
+  /*otherwise frame it for the worker that hosts the destination*/
+  frame[0] = dest;
+  frame[1] = src;
+  memcpy(frame + WORKER_HDR_LEN, msg, len);
+  send(worker->outboxes[worker->owners[dest]],
+                              frame, len + WORKER_HDR_LEN, MSG_NOSIGNAL);
+  __sync_fetch_and_add(&worker->stats->remote, 1);
+}
+
+void *dispatcher_thread(void *worker) {
+  struct worker *self = (struct worker *) worker;
+  uint8_t frame[50 + WORKER_HDR_LEN];
+  int32_t len;
+
+  /*receive frames indefinitely, and hand them to the node they're meant for*/
+  while (1) {
+    len = recv(self->inbox, frame, 50 + WORKER_HDR_LEN, 0);
+    if (len <= WORKER_HDR_LEN) {
+      continue;
+    }
+
+    /*drop anything that isn't for one of our nodes, from another node or from
+    the parent. Nodes may grow new edges while running (in incremental mode),
+    so their neighbour lists are none of our business*/
+    if (frame[0] >= self->num_nodes || self->nodes[frame[0]] == NULL ||
+        (frame[1] >= self->num_nodes && frame[1] != WORKER_CONTROLLER)) {
+      fprintf(stderr, "Worker %d dropping frame from %d to %d!\n", self->id,
+                                                          frame[1], frame[0]);
+      continue;
+    }
+
+    enqueue(self->nodes[frame[0]]->queue, frame + WORKER_HDR_LEN,
+                                                        len - WORKER_HDR_LEN);
+  }
+}
+
+void *node_thread(void *thread_data) {
+  struct node_thread_data *data = (struct node_thread_data *) thread_data;
+
+  run_node(data->node, data->algo);
+
+  return NULL;
+}
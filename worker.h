@@ -0,0 +1,96 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+/*This file implements the workers for the partitioned mode. Rather than running
+one process per node, the network is split among a few worker processes (one
+per core, usually), each of which hosts a group of the nodes (a contiguous
+slice, unless they were placed, see placement.h), with every node running in
+its own thread. Messages between nodes of the same worker
+never leave the process: they go straight into the neighbour's message queue.
+Only messages to nodes of other workers go through a socket, and each worker
+has a single inbound socket for those, with a dispatcher thread that hands the
+incoming messages to the right node.*/
+
+#include <stdio.h>      /*logs and reports*/
+#include <stdint.h>     /*sized integers, as usual*/
+#include <stdlib.h>     /*mallocs and frees*/
+#include <string.h>     /*memcpys for framing*/
+#include <pthread.h>    /*nodes are threads here*/
+#include <sys/socket.h> /*talking to other workers*/
+
+#include "node.h"       /*workers host nodes*/
+#include "algorithm.h"  /*which may start from fragments*/
+#include "contract.h"   /*the workers put together themselves*/
+
+/*Length of the header prepended to messages between workers, with the IDs of
+the destination and source nodes, in that order*/
+#define WORKER_HDR_LEN 2
+
+/*Source ID for frames sent by the parent itself, rather than by a node*/
+#define WORKER_CONTROLLER 0xFF
+
+/*Message counters for a worker. These live in memory shared with the parent,
+so it can report how much traffic stayed inside the workers*/
+struct worker_stats {
+  uint64_t local;
+  uint64_t remote;
+};
+
+/*Struct that represents a worker process.
+  id        -> the worker's index
+  workers   -> total number of workers
+  num_nodes -> total number of nodes in the network
+  owners    -> the worker that hosts each node
+  inbox     -> socket on which messages from other workers arrive
+  outboxes  -> sockets for sending to each of the workers
+  nodes     -> the worker's nodes, indexed by node ID (NULL if not ours)
+  stats     -> the worker's message counters*/
+struct worker {
+  uint8_t id;
+  uint8_t workers;
+  uint8_t num_nodes;
+  uint8_t *owners;
+  uint32_t inbox;
+  uint32_t *outboxes;
+  struct node **nodes;
+  struct worker_stats *stats;
+};
+
+/*Struct that stores what a node thread needs to run*/
+struct node_thread_data {
+  struct node *node;
+  void (*algo) (struct node *node);
+};
+
+/*Returns the worker that owns the given node, when workers own contiguous
+slices of the nodes, of (almost) equal size. TCP workers always do, partitioned
+ones unless the nodes were placed (see placement.h)*/
+uint8_t worker_of(uint8_t node, uint8_t num_nodes, uint8_t workers);
+
+/*Runs the given worker: initializes the nodes owners says it hosts, then runs
+algo on each of them in its own thread, and waits for all of them to finish.
+Sockets holds a socket pair per worker, with the receiving end first, and stats
+holds the counters of every worker. Nodes report their results on the results
+descriptor (-1 for none), and run algo with the given options. With
+GHS_CONTRACT, nodes start from the fragments the worker contracts them into
+first (see contract.h). Returns 1 on success, 0 otherwise.*/
+uint8_t run_worker(uint8_t id, uint8_t workers, weight_t *edges,
+                    uint8_t num_nodes, uint8_t *owners, uint32_t *sockets,
+                    struct worker_stats *stats, FILE *globallog,
+                    int32_t results, void (*algo) (struct node *node),
+                    uint8_t algo_opts);
+
+/*Sends a message from node src to node dest. If dest is hosted by the same
+worker, the message goes straight into its queue, otherwise it is framed with
+the destination and source IDs and sent to the worker that hosts dest.*/
+void worker_send(struct worker *worker, uint8_t src, uint32_t dest,
+                                                uint8_t *msg, uint32_t len);
+
+/*Receives messages from other workers on the worker's inbound socket, and
+places them in the queue of the node they are addressed to*/
+void *dispatcher_thread(void *worker);
+
+/*Runs a single node's algorithm, for a node hosted by a worker*/
+void *node_thread(void *thread_data);
+
+#endif /* WORKER_H */